@@ -9,51 +9,345 @@
 #include <filesystem>
 #include <iostream>
 #include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "memory_accounting.hpp"
+#include "query_counters.hpp"
 
-extern std::atomic<size_t> gBloomCheckCount;  // declared in algorithm.hpp
-extern std::atomic<size_t> gLeafBloomCheckCount;  // declared in algorithm.hpp
 
 void BloomTree::addLeafNode(BloomFilter&& bv, const std::string& file,
                             const std::string& start, const std::string& end) {
     leafNodes.push_back(new Node(std::move(bv), file, start, end));
 }
 
-void BloomTree::buildLevel(std::vector<Node*>& nodes) {
+Node* BloomTree::makeParent(const std::vector<Node*>& children) const {
+    MemoryTagScope tag(MemoryTag::Hierarchy);
+    // quotient filter nodes carry an empty bit array, never probed
+    bool tables = filterKind == FilterKind::Quotient;
+    Node* parent = new Node(BloomFilter(tables ? 0 : bloomSize, numHashFunctions), "Memory",
+                            children.front()->startKey, children.front()->endKey);
+    parent->bloom.selectKernels(probeMode);
+    if (tables) {
+        parent->qfilter.emplace();
+    }
+    if (textMode != TextFilterMode::None) {
+        parent->textBloom.emplace(bloomSize, numHashFunctions);
+        parent->textBloom->selectKernels(probeMode);
+    }
+
+    for (Node* child : children) {
+        if (parent->startKey > child->startKey) {
+            parent->startKey = child->startKey;
+        }
+        if (parent->endKey < child->endKey) {
+            parent->endKey = child->endKey;
+        }
+        if (parent->qfilter && child->qfilter) {
+            parent->qfilter->merge(*child->qfilter);
+        } else {
+            parent->bloom.merge(child->bloom);
+        }
+        parent->itemCount += child->itemCount;
+        if (child->hasValueRange) {
+            parent->extendValueRange(child->minValue, child->maxValue);
+        }
+        if (parent->textBloom && child->textBloom) {
+            parent->textBloom->merge(*child->textBloom);
+        }
+        parent->children.push_back(child);
+    }
+    parent->indexChildren();
+    return parent;
+}
+
+Node* BloomTree::buildLevel(std::vector<Node*>& nodes) {
+    if (nodes.empty()) return nullptr;
     if (nodes.size() == 1) {
-        root = std::move(nodes.front());
-        return;
+        return nodes.front();
     }
 
     std::vector<Node*> parentLevel;
 
     for (size_t i = 0; i < nodes.size(); i += ratio) {
         size_t end = std::min(i + ratio, nodes.size());
+        parentLevel.push_back(makeParent(
+            std::vector<Node*>(nodes.begin() + i, nodes.begin() + end)));
+    }
+
+    return buildLevel(parentLevel);
+}
+
+void BloomTree::buildTree() {
+    // parents merge the full-size leaves, folding comes after
+    root = buildLevel(leafNodes);
+    foldFilters(subtreeNodes(root));
+    persistLeaves(leafNodes);
+}
+
+std::vector<Node*> BloomTree::subtreeNodes(Node* node) {
+    std::vector<Node*> nodes;
+    if (node) nodes.push_back(node);
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        nodes.insert(nodes.end(), nodes[i]->children.begin(), nodes[i]->children.end());
+    }
+    return nodes;
+}
+
+void BloomTree::persistLeaves(const std::vector<Node*>& leaves) const {
+    for (Node* node : leaves) {
+        std::string path = node->filename + "_" + node->startKey + "_" + node->endKey;
+        if (node->qfilter) {
+            node->qfilter->saveToFile(path);
+        } else {
+            node->bloom.saveToFile(path);
+        }
+    }
+}
+
+void BloomTree::foldFilters(const std::vector<Node*>& nodes) const {
+    if (foldTargetFpr <= 0.0) return;
+    MemoryTagScope tag(MemoryTag::Hierarchy);
+    size_t before = 0, after = 0;
+    for (Node* node : nodes) {
+        before += node->bloom.bitArraySize;
+        node->bloom.foldToTarget(foldTargetFpr);
+        if (node->textBloom) node->textBloom->foldToTarget(foldTargetFpr);
+        after += node->bloom.bitArraySize;
+    }
+    if (before > 0) {
+        spdlog::info("Folded {} filters to {:.1f}% of their bits (target FPR {}).",
+                     nodes.size(), 100.0 * after / before, foldTargetFpr);
+    }
+}
+
+Node* BloomTree::buildSubtree(std::vector<Node*> leaves) {
+    return buildLevel(leaves);
+}
+
+void BloomTree::joinLevelGroups() {
+    leafNodes.clear();
+    std::vector<Node*> groupRoots;
+    for (const auto& group : levelGroups) {
+        leafNodes.insert(leafNodes.end(), group.leaves.begin(), group.leaves.end());
+        if (group.root) groupRoots.push_back(group.root);
+    }
+
+    if (groupRoots.empty()) {
+        root = nullptr;
+        return;
+    }
+    if (groupRoots.size() == 1) {
+        root = groupRoots.front();
+        return;
+    }
+
+    // children stay in level order so searches probe the newest data first
+    root = makeParent(groupRoots);
+}
+
+void BloomTree::setProbeMode(ProbeMode mode) {
+    probeMode = mode;
+    std::vector<Node*> stack;
+    if (root) stack.push_back(root);
+    while (!stack.empty()) {
+        Node* node = stack.back();
+        stack.pop_back();
+        node->bloom.selectKernels(mode);
+        if (node->textBloom) node->textBloom->selectKernels(mode);
+        stack.insert(stack.end(), node->children.begin(), node->children.end());
+    }
+}
+
+static bool pathTo(Node* node, const Node* target, std::vector<Node*>& path) {
+    if (!node) return false;
+    path.push_back(node);
+    if (node == target) return true;
+    for (Node* child : node->children) {
+        if (child->startKey <= target->startKey && child->endKey >= target->endKey &&
+            pathTo(child, target, path)) {
+            return true;
+        }
+    }
+    path.pop_back();
+    return false;
+}
+
+bool BloomTree::removeValue(Node* leaf, const std::string& value) {
+    if (filterKind != FilterKind::Quotient || !leaf->qfilter) return false;
+    std::vector<Node*> path;
+    if (!pathTo(root, leaf, path)) return false;
+    if (!leaf->qfilter->erase(value)) return false;
+    for (Node* node : path) {
+        if (node != leaf && node->qfilter) node->qfilter->erase(value);
+    }
+    if (leaf->itemCount > 0) {
+        for (Node* node : path) --node->itemCount;
+    }
+    return true;
+}
+
+uint64_t BloomTree::subtreeHits(const Node* node) {
+    if (node->children.empty()) {
+        return node->hitCount.load(std::memory_order_relaxed);
+    }
+    uint64_t hits = 0;
+    for (const Node* child : node->children) hits += subtreeHits(child);
+    return hits;
+}
 
-        Node* parent = new Node(BloomFilter(bloomSize, numHashFunctions), "Memory",
-                                nodes[i]->startKey, nodes[end - 1]->endKey);
+// Greedy: seed each group with the hottest unassigned leaf, then add the
+// leaf that co-matched most often with the group so far, falling back to the
+// next hottest. Without any hits this reproduces the key-ordered layout.
+std::vector<std::vector<Node*>> BloomTree::clusterLeaves(
+    const std::vector<Node*>& leaves, const CoMatchStats::Counts& coMatches) const {
+    std::vector<Node*> byHeat(leaves);
+    std::stable_sort(byHeat.begin(), byHeat.end(), [](const Node* a, const Node* b) {
+        return subtreeHits(a) > subtreeHits(b);
+    });
 
-        for (size_t j = i; j < end; ++j) {
-            if (parent->startKey > nodes[j]->startKey) {
-                parent->startKey = nodes[j]->startKey;
+    std::unordered_set<const Node*> remaining(byHeat.begin(), byHeat.end());
+    std::vector<std::vector<Node*>> groups;
+    size_t next = 0;
+
+    auto nextHottest = [&]() -> Node* {
+        while (!remaining.count(byHeat[next])) ++next;
+        return byHeat[next];
+    };
+
+    while (!remaining.empty()) {
+        std::vector<Node*> group;
+        std::unordered_map<const Node*, uint64_t> affinity;
+
+        Node* pick = nextHottest();
+        while (true) {
+            group.push_back(pick);
+            remaining.erase(pick);
+            affinity.erase(pick);
+            if (group.size() == static_cast<size_t>(ratio) || remaining.empty()) break;
+
+            auto row = coMatches.find(pick);
+            if (row != coMatches.end()) {
+                for (const auto& [other, count] : row->second) {
+                    if (remaining.count(other)) affinity[other] += count;
+                }
             }
-            if (parent->endKey < nodes[j]->endKey) {
-                parent->endKey = nodes[j]->endKey;
+
+            pick = nullptr;
+            uint64_t best = 0;
+            for (const auto& [candidate, score] : affinity) {
+                if (score > best) {
+                    best = score;
+                    pick = const_cast<Node*>(candidate);
+                }
             }
-            parent->bloom.merge(nodes[j]->bloom);
-            parent->children.push_back(std::move(nodes[j]));
+            if (!pick) pick = nextHottest();
         }
 
-        parentLevel.push_back(parent);
+        std::stable_sort(group.begin(), group.end(), [](const Node* a, const Node* b) {
+            return subtreeHits(a) > subtreeHits(b);
+        });
+        groups.push_back(std::move(group));
     }
+    return groups;
+}
+
+BloomTree::Restructure BloomTree::planRestructure() const {
+    auto counts = coMatches->snapshot();
+
+    auto buildClustered = [&](const std::vector<Node*>& leaves) -> Node* {
+        if (leaves.empty()) return nullptr;
+        if (leaves.size() == 1) return leaves.front();
 
-    buildLevel(parentLevel);
+        std::vector<Node*> parents;
+        for (const auto& group : clusterLeaves(leaves, counts)) {
+            parents.push_back(makeParent(group));
+        }
+        // upper levels chunk consecutive parents, so hot ones end up together
+        std::stable_sort(parents.begin(), parents.end(), [](const Node* a, const Node* b) {
+            return subtreeHits(a) > subtreeHits(b);
+        });
+        while (parents.size() > 1) {
+            std::vector<Node*> level;
+            for (size_t i = 0; i < parents.size(); i += ratio) {
+                size_t end = std::min(i + ratio, parents.size());
+                level.push_back(makeParent(
+                    std::vector<Node*>(parents.begin() + i, parents.begin() + end)));
+            }
+            parents = std::move(level);
+        }
+        return parents.front();
+    };
+
+    Restructure plan;
+    if (levelGroups.empty()) {
+        plan.root = buildClustered(leafNodes);
+        return plan;
+    }
+
+    // level groups keep their newest-first order under the top node
+    std::vector<Node*> nonEmpty;
+    for (const auto& group : levelGroups) {
+        plan.groupRoots.push_back(buildClustered(group.leaves));
+        if (plan.groupRoots.back()) nonEmpty.push_back(plan.groupRoots.back());
+    }
+    if (nonEmpty.size() == 1) {
+        plan.root = nonEmpty.front();
+    } else if (nonEmpty.size() > 1) {
+        plan.root = makeParent(nonEmpty);
+    }
+    return plan;
 }
 
-void BloomTree::buildTree() {
-    buildLevel(leafNodes);
-    for (Node* node : leafNodes) {
-        node->bloom.saveToFile(node->filename + "_" + node->startKey + "_" + node->endKey);
+void BloomTree::installRestructure(Restructure&& plan) {
+    std::vector<Node*> retired;
+    std::vector<Node*> stack;
+    if (root) stack.push_back(root);
+    while (!stack.empty()) {
+        Node* node = stack.back();
+        stack.pop_back();
+        if (node->children.empty()) continue;
+        retired.push_back(node);
+        stack.insert(stack.end(), node->children.begin(), node->children.end());
     }
+
+    root = plan.root;
+    for (size_t i = 0; i < levelGroups.size() && i < plan.groupRoots.size(); ++i) {
+        levelGroups[i].root = plan.groupRoots[i];
+    }
+    retireNodes(retired);
+
+    coMatches->decay();
+}
+
+void BloomTree::deleteNodes() {
+    std::vector<Node*> stack;
+    if (root && root->filename == "Memory") stack.push_back(root);
+    while (!stack.empty()) {
+        Node* node = stack.back();
+        stack.pop_back();
+        for (Node* child : node->children) {
+            if (child->filename == "Memory") stack.push_back(child);
+        }
+        delete node;
+    }
+    for (Node* leaf : leafNodes) {
+        if (ownsLeaf(leaf)) delete leaf;
+    }
+    root = nullptr;
+    leafNodes.clear();
+    levelGroups.clear();
+}
+
+BloomTree::RetiredNodes::~RetiredNodes() {
+    for (Node* node : nodes) delete node;
+}
+
+void BloomTree::retireNodes(const std::vector<Node*>& nodes) {
+    // copies taken before this swap share the generation and may retire
+    // the same nodes again; the set keeps them from being freed twice
+    generation->nodes.insert(nodes.begin(), nodes.end());
+    generation = std::make_shared<RetiredNodes>();
 }
 
 void BloomTree::search(Node* node, const std::string& value,
@@ -66,20 +360,15 @@ void BloomTree::search(Node* node, const std::string& value,
         (qStart.empty() || node->endKey >= qStart);
 
     if (overlaps) {
-        ++gBloomCheckCount;
-        
-        // Track leaf bloom filter checks
-        if (node->filename != "Memory") {
-            ++gLeafBloomCheckCount;
-        }
+        countBloomCheck(node->filename != "Memory");
         
-        if (node->bloom.exists(value)) {
+        if (node->probe(value)) {
             if (node->filename != "Memory") {
                 results.push_back(node->filename);
             } else {
-                for (Node* child : node->children) {
+                node->forEachOverlappingChild(qStart, qEnd, [&](Node* child) {
                     search(child, value, qStart, qEnd, results);
-                }
+                });
             }
         }
     }
@@ -104,20 +393,15 @@ void BloomTree::searchNodes(Node* node, const std::string& value,
         (qStart.empty() || node->endKey >= qStart);
 
     if (overlaps) {
-        ++gBloomCheckCount;
+        countBloomCheck(node->filename != "Memory");
         
-        // Track leaf bloom filter checks
-        if (node->filename != "Memory") {
-            ++gLeafBloomCheckCount;
-        }
-        
-        if (node->bloom.exists(value)) {
+        if (node->probe(value)) {
             if (node->children.empty()) {
                 results.push_back(node);
             } else {
-                for (Node* child : node->children) {
+                node->forEachOverlappingChild(qStart, qEnd, [&](Node* child) {
                     searchNodes(child, value, qStart, qEnd, results);
-                }
+                });
             }
         }
     }
@@ -132,6 +416,78 @@ std::vector<const Node*> BloomTree::queryNodes(const std::string& value,
     return results;
 }
 
+// search that prunes with zone maps instead of bloom filters
+void BloomTree::searchRangeNodes(Node* node, const std::string& low,
+                                 const std::string& high,
+                                 const std::string& qStart, const std::string& qEnd,
+                                 std::vector<const Node*>& results) const {
+    if (!node) return;
+
+    bool overlaps =
+        (qEnd.empty() || node->startKey <= qEnd) &&
+        (qStart.empty() || node->endKey >= qStart);
+
+    if (overlaps) {
+        countBloomCheck(node->filename != "Memory");
+
+        if (node->valueRangeOverlaps(low, high)) {
+            if (node->children.empty()) {
+                results.push_back(node);
+            } else {
+                node->forEachOverlappingChild(qStart, qEnd, [&](Node* child) {
+                    searchRangeNodes(child, low, high, qStart, qEnd, results);
+                });
+            }
+        }
+    }
+}
+
+// leaves whose zone map overlaps [low, high]
+std::vector<const Node*> BloomTree::queryRangeNodes(const std::string& low,
+                                                    const std::string& high,
+                                                    const std::string& qStart,
+                                                    const std::string& qEnd) const {
+    std::vector<const Node*> results;
+    if (low > high) return results;
+    searchRangeNodes(root, low, high, qStart, qEnd, results);
+    return results;
+}
+
+// search that prunes with the n-gram / prefix filters
+void BloomTree::searchTextNodes(Node* node, const std::vector<std::string>& probes,
+                                const std::string& qStart, const std::string& qEnd,
+                                std::vector<const Node*>& results) const {
+    if (!node) return;
+
+    bool overlaps =
+        (qEnd.empty() || node->startKey <= qEnd) &&
+        (qStart.empty() || node->endKey >= qStart);
+
+    if (overlaps) {
+        countBloomCheck(node->filename != "Memory");
+
+        if (node->textMayMatch(probes)) {
+            if (node->children.empty()) {
+                results.push_back(node);
+            } else {
+                node->forEachOverlappingChild(qStart, qEnd, [&](Node* child) {
+                    searchTextNodes(child, probes, qStart, qEnd, results);
+                });
+            }
+        }
+    }
+}
+
+// leaves that may hold a value containing (or starting with) the pattern
+std::vector<const Node*> BloomTree::queryTextNodes(const std::string& pattern,
+                                                   bool prefixOnly,
+                                                   const std::string& qStart,
+                                                   const std::string& qEnd) const {
+    std::vector<const Node*> results;
+    searchTextNodes(root, textProbes(pattern, prefixOnly), qStart, qEnd, results);
+    return results;
+}
+
 static size_t computeNodeMemory(const Node* node) {
     if (!node) return 0;
     size_t mem = 0;
@@ -169,8 +525,17 @@ size_t BloomTree::memorySize() const {
     while (!stack.empty()) {
         const Node* node = stack.back();
         stack.pop_back();
+        if (node->sketch) {
+            total += node->sketch->memorySize();
+        }
+        if (node->qfilter) {
+            total += node->qfilter->memorySize();
+        }
         if (node->filename == "Memory") {
             total += computeBloomFilterDiskSize(node->bloom);
+            if (node->textBloom) {
+                total += computeBloomFilterDiskSize(*node->textBloom);
+            }
             for (const Node* child : node->children) {
                 stack.push_back(child);
             }
@@ -179,11 +544,40 @@ size_t BloomTree::memorySize() const {
     return total;
 }
 
+std::vector<size_t> BloomTree::memorySizeByDepth() const {
+    std::vector<size_t> sizes;
+    std::vector<std::pair<const Node*, size_t>> stack;
+    if (root) stack.emplace_back(root, 0);
+    while (!stack.empty()) {
+        auto [node, depth] = stack.back();
+        stack.pop_back();
+        if (sizes.size() <= depth) sizes.resize(depth + 1, 0);
+        size_t bytes = 0;
+        if (node->qfilter) bytes += node->qfilter->memorySize();
+        if (node->sketch) bytes += node->sketch->memorySize();
+        if (node->filename != "Memory") {
+            sizes[depth] += bytes;
+            continue;
+        }
+        bytes += computeBloomFilterDiskSize(node->bloom);
+        if (node->textBloom) bytes += computeBloomFilterDiskSize(*node->textBloom);
+        sizes[depth] += bytes;
+        for (const Node* child : node->children) {
+            stack.emplace_back(child, depth + 1);
+        }
+    }
+    return sizes;
+}
+
 size_t BloomTree::diskSize() const {
     size_t total = 0;
     for (const Node* leaf : leafNodes) {
         if (leaf->filename != "Memory") {
-            total += computeBloomFilterDiskSize(leaf->bloom);
+            total += leaf->qfilter ? leaf->qfilter->diskSize()
+                                   : computeBloomFilterDiskSize(leaf->bloom);
+            if (leaf->textBloom) {
+                total += computeBloomFilterDiskSize(*leaf->textBloom);
+            }
         }
     }
     return total;
@@ -1,23 +1,35 @@
 #pragma once
 #include <memory>
+#include <unordered_set>
 #include <vector>
 
+#include "co_match_stats.hpp"
 #include "node.hpp"
+#include "text_filter.hpp"
+#include "value_dictionary.hpp"
 
 class BloomTree {
    public:
-    Node* root;
+    Node* root = nullptr;
 
    private:
     int ratio;
     size_t bloomSize;
     int numHashFunctions;
+    TextFilterMode textMode;
+    size_t gramSize;
+    ProbeMode probeMode = ProbeMode::EarlyExit;
+    double foldTargetFpr = 0.0;
+    FilterKind filterKind = FilterKind::Bloom;
 
     // for future use
     //  size_t expectedItems;
     //  double bloomFalsePositiveRate;
 
-    void buildLevel(std::vector<Node*>& nodes);
+    Node* buildLevel(std::vector<Node*>& nodes);
+    Node* makeParent(const std::vector<Node*>& children) const;
+    std::vector<std::vector<Node*>> clusterLeaves(
+        const std::vector<Node*>& leaves, const CoMatchStats::Counts& coMatches) const;
     void search(Node* node, const std::string& value,
                 const std::string& qStart, const std::string& qEnd,
                 std::vector<std::string>& results) const;
@@ -26,24 +38,126 @@ class BloomTree {
                      const std::string& qStart, const std::string& qEnd,
                      std::vector<const Node*>& results) const;
 
+    void searchRangeNodes(Node* node, const std::string& low,
+                          const std::string& high,
+                          const std::string& qStart, const std::string& qEnd,
+                          std::vector<const Node*>& results) const;
+
+    void searchTextNodes(Node* node, const std::vector<std::string>& probes,
+                         const std::string& qStart, const std::string& qEnd,
+                         std::vector<const Node*>& results) const;
+
    public:
     // for future use
     //   BloomTree(int branchingRatio, size_t expectedItems, double bloomFalsePositiveRate)
     //       : ratio(branchingRatio),
     //       expectedItems(expectedItems),
     //         bloomFalsePositiveRate(bloomFalsePositiveRate) {}
-    BloomTree(int branchingRatio, size_t bloomSize, int numHashFunctions)
+    BloomTree(int branchingRatio, size_t bloomSize, int numHashFunctions,
+              TextFilterMode textMode = TextFilterMode::None,
+              size_t gramSize = 3)
         : ratio(branchingRatio),
           bloomSize(bloomSize),
-          numHashFunctions(numHashFunctions) {}
+          numHashFunctions(numHashFunctions),
+          textMode(textMode),
+          gramSize(gramSize) {}
 
     std::vector<Node*> leafNodes;
 
+    // LSM-level-aware layout: one subtree per level group, newest levels
+    // first, joined under a thin top node. Empty for a flat tree.
+    struct LevelGroup {
+        int firstLevel;
+        int lastLevel;
+        std::vector<std::string> files;
+        std::vector<Node*> leaves;
+        Node* root = nullptr;
+    };
+    std::vector<LevelGroup> levelGroups;
+
+    // leaves that returned keys for the same query; shared by tree copies
+    std::shared_ptr<CoMatchStats> coMatches = std::make_shared<CoMatchStats>();
+
+    // Copies are shallow. Nodes a tree replaces are retired into the
+    // generation it shares with its copies and freed with the last of them,
+    // so a copy taken before a restructure or refresh keeps a valid tree.
+    struct RetiredNodes {
+        std::unordered_set<Node*> nodes;
+        RetiredNodes() = default;
+        RetiredNodes(const RetiredNodes&) = delete;
+        RetiredNodes& operator=(const RetiredNodes&) = delete;
+        ~RetiredNodes();
+    };
+    std::shared_ptr<RetiredNodes> generation = std::make_shared<RetiredNodes>();
+
+    // hands nodes this tree no longer uses to its current generation and
+    // starts a new one
+    void retireNodes(const std::vector<Node*>& nodes);
+
+    // leaves shared with the tree this one was cloned from; that tree owns
+    // them, so they are never deleted through this one
+    std::shared_ptr<const std::unordered_set<const Node*>> borrowedLeaves;
+
+    bool ownsLeaf(const Node* leaf) const {
+        return !borrowedLeaves || borrowedLeaves->count(leaf) == 0;
+    }
+
+    // Deletes the internal nodes and the owned leaves and empties the tree;
+    // copies of it must not be used afterwards.
+    void deleteNodes();
+
+    // set for dictionary-encoded columns: the filters hold codes, so query
+    // values go through encodeQueryValue first
+    std::shared_ptr<const ValueDictionary> dictionary;
+
+    std::string encodeQueryValue(const std::string& value) const {
+        return dictionary ? dictionary->encode(value) : value;
+    }
+
+    // Internal levels rebuilt from the observed workload: leaves that tend
+    // to match together share a parent and hotter subtrees come first.
+    // Leaves are reused as they are.
+    struct Restructure {
+        Node* root = nullptr;
+        std::vector<Node*> groupRoots;  // one per level group, if any
+    };
+
     void addLeafNode(BloomFilter&& bv, const std::string& file,
                      const std::string& start, const std::string& end);
 
     void buildTree();
 
+    // internal nodes over the given leaves, returns the subtree root
+    Node* buildSubtree(std::vector<Node*> leaves);
+    // rebuilds the top node over levelGroups and refreshes leafNodes
+    void joinLevelGroups();
+    void persistLeaves(const std::vector<Node*>& leaves) const;
+
+    // Filters built with more bits than their items need are folded until
+    // their FPR would exceed the target; 0 disables. Folding runs once the
+    // parents have merged the full-size children, so every level keeps the
+    // FPR of its own items. A parent built later over folded children
+    // (restructure, refresh) folds down to its narrowest child instead.
+    void setFoldTargetFpr(double targetFpr) { foldTargetFpr = targetFpr; }
+    double getFoldTargetFpr() const { return foldTargetFpr; }
+    void foldFilters(const std::vector<Node*>& nodes) const;
+    // node and everything below it, parents before children
+    static std::vector<Node*> subtreeNodes(Node* node);
+
+    // Builds the new internal levels without touching the live tree, so it
+    // can run while queries are in flight. installRestructure swaps them in
+    // and retires the old ones; no query may be running on this tree at that
+    // point, copies taken earlier stay usable.
+    Restructure planRestructure() const;
+    void installRestructure(Restructure&& plan);
+
+    // key hits recorded at the leaves below node
+    static uint64_t subtreeHits(const Node* node);
+
+    size_t getBloomSize() const { return bloomSize; }
+    int getNumHashFunctions() const { return numHashFunctions; }
+    size_t getGramSize() const { return gramSize; }
+
     std::vector<std::string> query(const std::string& value,
                                    const std::string& qStart,
                                    const std::string& qEnd) const;
@@ -52,7 +166,44 @@ class BloomTree {
                                         const std::string& qStart,
                                         const std::string& qEnd) const;
 
+    // range predicate: value BETWEEN low AND high (inclusive, byte-wise)
+    std::vector<const Node*> queryRangeNodes(const std::string& low,
+                                             const std::string& high,
+                                             const std::string& qStart,
+                                             const std::string& qEnd) const;
+
+    // substring (prefixOnly = false) or prefix predicate on the value
+    std::vector<const Node*> queryTextNodes(const std::string& pattern,
+                                            bool prefixOnly,
+                                            const std::string& qStart,
+                                            const std::string& qEnd) const;
+
+    std::vector<std::string> textProbes(const std::string& pattern,
+                                        bool prefixOnly) const {
+        return textFilterProbes(pattern, prefixOnly, textMode, gramSize);
+    }
+
+    TextFilterMode getTextMode() const { return textMode; }
+
+    // Quotient filter hierarchies merge children losslessly, so upper
+    // levels stay as selective as the leaves. Set before building; leaves
+    // must carry a qfilter (see BloomManager).
+    void setFilterKind(FilterKind kind) { filterKind = kind; }
+    FilterKind getFilterKind() const { return filterKind; }
+
+    // Deletes one occurrence of value from leaf and every quotient filter
+    // above it. Bloom hierarchies can't delete; returns false for them.
+    bool removeValue(Node* leaf, const std::string& value);
+
+    // reselects the probe kernels of every filter in the tree
+    void setProbeMode(ProbeMode mode);
+    ProbeMode getProbeMode() const { return probeMode; }
+
+    // Bloom bits of the internal nodes, plus every node's quotient filter
+    // and sketch, which stay resident on the leaves too
     size_t memorySize() const;
+    // memorySize split by depth below the root (index 0 = root)
+    std::vector<size_t> memorySizeByDepth() const;
     size_t diskSize() const;
 
     void print() const {
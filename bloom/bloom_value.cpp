@@ -2,6 +2,7 @@
 #include <iostream>
 
 #include <stdexcept>
+#include <utility>
 
 #include "MurmurHash3.h"
 
@@ -14,6 +15,7 @@
 
 BloomFilter::BloomFilter(size_t size, double numHashFunctions) : bitArraySize(size), numHashFunctions(numHashFunctions) {
     bitArray.resize(bitArraySize, false);
+    selectKernels();
 }
 
 size_t BloomFilter::hash(const std::string& key, int seed) const {
@@ -22,22 +24,90 @@ size_t BloomFilter::hash(const std::string& key, int seed) const {
     return static_cast<size_t>(hashOutput) % bitArraySize;
 }
 
-void BloomFilter::insert(const std::string& key) {
-    for (int i = 0; i < numHashFunctions; ++i) {
-        bitArray[hash(key, i)] = true;
-    }
+template <int K>
+bool BloomFilter::probeEarlyExit(const BloomFilter& bf, const std::string& key) {
+    return [&]<int... I>(std::integer_sequence<int, I...>) {
+        return (bf.bitArray[bf.hash(key, I)] && ...);
+    }(std::make_integer_sequence<int, K>{});
 }
 
-bool BloomFilter::exists(const std::string& key) const {
-    for (int i = 0; i < numHashFunctions; ++i) {
-        if (!bitArray[hash(key, i)]) {
+template <int K>
+bool BloomFilter::probeBranchFree(const BloomFilter& bf, const std::string& key) {
+    return [&]<int... I>(std::integer_sequence<int, I...>) {
+        return static_cast<bool>((static_cast<unsigned>(bf.bitArray[bf.hash(key, I)]) & ...));
+    }(std::make_integer_sequence<int, K>{});
+}
+
+template <int K>
+void BloomFilter::insertUnrolled(BloomFilter& bf, const std::string& key) {
+    [&]<int... I>(std::integer_sequence<int, I...>) {
+        ((bf.bitArray[bf.hash(key, I)] = true), ...);
+    }(std::make_integer_sequence<int, K>{});
+}
+
+bool BloomFilter::probeGeneric(const BloomFilter& bf, const std::string& key) {
+    for (int i = 0; i < bf.numHashFunctions; ++i) {
+        if (!bf.bitArray[bf.hash(key, i)]) {
             return false;
         }
     }
     return true;
 }
 
+void BloomFilter::insertGeneric(BloomFilter& bf, const std::string& key) {
+    for (int i = 0; i < bf.numHashFunctions; ++i) {
+        bf.bitArray[bf.hash(key, i)] = true;
+    }
+}
+
+void BloomFilter::selectKernels(ProbeMode mode) {
+    probeMode = mode;
+    bool branchFree = mode == ProbeMode::BranchFree;
+    switch (numHashFunctions) {
+#define BLOOM_KERNELS(K)                                                \
+    case K:                                                             \
+        probeFn = branchFree ? &probeBranchFree<K> : &probeEarlyExit<K>; \
+        insertFn = &insertUnrolled<K>;                                  \
+        return;
+        BLOOM_KERNELS(1)
+        BLOOM_KERNELS(2)
+        BLOOM_KERNELS(3)
+        BLOOM_KERNELS(4)
+        BLOOM_KERNELS(5)
+        BLOOM_KERNELS(6)
+        BLOOM_KERNELS(7)
+        BLOOM_KERNELS(8)
+#undef BLOOM_KERNELS
+        default:
+            probeFn = &probeGeneric;
+            insertFn = &insertGeneric;
+    }
+}
+
+void BloomFilter::insert(const std::string& key) {
+    insertFn(*this, key);
+}
+
+bool BloomFilter::exists(const std::string& key) const {
+    return probeFn(*this, key);
+}
+
 void BloomFilter::merge(const BloomFilter& other) {
+    // a filter k times larger folds exactly: (h mod k*m) mod m == h mod m
+    if (other.bitArray.size() > bitArray.size() &&
+        other.bitArray.size() % bitArray.size() == 0) {
+        for (size_t i = 0; i < other.bitArray.size(); ++i) {
+            if (other.bitArray[i]) bitArray[i % bitArraySize] = true;
+        }
+        return;
+    }
+    // a folded filter can't be unfolded without copying each of its bits to
+    // every position it may have come from, which saturates this one; this
+    // filter folds down to its size instead
+    while (bitArraySize > other.bitArraySize && !other.bitArray.empty() &&
+           bitArraySize % (2 * other.bitArraySize) == 0) {
+        fold();
+    }
     if (bitArray.size() != other.bitArray.size()) {
       std::cout << "bitArray.size() " << bitArray.size() << " other.bitArray.size() " << other.bitArray.size() << std::endl;
 
@@ -48,6 +118,41 @@ void BloomFilter::merge(const BloomFilter& other) {
     }
 }
 
+bool BloomFilter::fold() {
+    if (bitArraySize < 2 || bitArraySize % 2 != 0) return false;
+    size_t half = bitArraySize / 2;
+    for (size_t i = 0; i < half; ++i) {
+        if (bitArray[i + half]) bitArray[i] = true;
+    }
+    bitArray.resize(half);
+    bitArray.shrink_to_fit();
+    bitArraySize = half;
+    return true;
+}
+
+double BloomFilter::estimatedFpr() const {
+    if (bitArraySize == 0) return 1.0;
+    size_t setBits = 0;
+    for (bool bit : bitArray) setBits += bit;
+    return std::pow(static_cast<double>(setBits) / bitArraySize, numHashFunctions);
+}
+
+int BloomFilter::foldToTarget(double targetFpr, size_t minSize) {
+    int folds = 0;
+    while (bitArraySize % 2 == 0 && bitArraySize / 2 >= minSize) {
+        size_t half = bitArraySize / 2;
+        size_t setBits = 0;
+        for (size_t i = 0; i < half; ++i) {
+            setBits += bitArray[i] || bitArray[i + half];
+        }
+        double fpr = std::pow(static_cast<double>(setBits) / half, numHashFunctions);
+        if (fpr > targetFpr) break;
+        fold();
+        ++folds;
+    }
+    return folds;
+}
+
 void BloomFilter::saveToFile(const std::string& filename) const {
     std::ofstream file(filename, std::ios::binary);
     if (!file) throw std::runtime_error("Error opening file: " + filename);
@@ -76,6 +181,7 @@ BloomFilter BloomFilter::loadFromFile(const std::string& filename) {
     filter.bitArraySize = bitArraySize;
     filter.numHashFunctions = numHashFunctions;
     filter.bitArray.resize(bitArraySize);
+    filter.selectKernels();
 
     size_t byteSize = (bitArraySize + 7) / 8;
     std::vector<char> buffer(byteSize);
@@ -5,10 +5,32 @@
 #include <string>
 #include <vector>
 
+enum class ProbeMode {
+    EarlyExit,   // stop at the first unset bit
+    BranchFree,  // always test all k bits, no data-dependent branch
+};
+
 class BloomFilter {
    private:
     size_t hash(const std::string& key, int seed) const;
 
+    using ProbeFn = bool (*)(const BloomFilter&, const std::string&);
+    using InsertFn = void (*)(BloomFilter&, const std::string&);
+
+    // unrolled kernels for k = 1..8, generic loop otherwise
+    template <int K>
+    static bool probeEarlyExit(const BloomFilter& bf, const std::string& key);
+    template <int K>
+    static bool probeBranchFree(const BloomFilter& bf, const std::string& key);
+    template <int K>
+    static void insertUnrolled(BloomFilter& bf, const std::string& key);
+    static bool probeGeneric(const BloomFilter& bf, const std::string& key);
+    static void insertGeneric(BloomFilter& bf, const std::string& key);
+
+    ProbeFn probeFn = nullptr;
+    InsertFn insertFn = nullptr;
+    ProbeMode probeMode = ProbeMode::EarlyExit;
+
    public:
     std::vector<bool> bitArray;
     int numHashFunctions;
@@ -20,6 +42,20 @@ class BloomFilter {
     bool exists(const std::string& key) const;
     void merge(const BloomFilter& other);
 
+    // ORs the upper half onto the lower half; probes then hash modulo the
+    // halved size and still find every inserted key. Returns false if the
+    // size is odd.
+    bool fold();
+    // folds while the fill-based FPR stays at or under targetFpr and the
+    // size stays at or above minSize; returns the number of folds
+    int foldToTarget(double targetFpr, size_t minSize = 64);
+    double estimatedFpr() const;
+
+    // picks the probe/insert kernels for numHashFunctions; done on
+    // construction and load, call again after changing the mode
+    void selectKernels(ProbeMode mode = ProbeMode::EarlyExit);
+    ProbeMode getProbeMode() const { return probeMode; }
+
     void saveToFile(const std::string& filename) const;
     static BloomFilter loadFromFile(const std::string& filename);
 };
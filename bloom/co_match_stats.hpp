@@ -0,0 +1,73 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+class Node;
+
+// How often pairs of leaves returned keys for the same query. Used to
+// cluster leaves that tend to match together under one parent.
+class CoMatchStats {
+   public:
+    using Counts = std::unordered_map<const Node*, std::unordered_map<const Node*, uint64_t>>;
+
+    // Every query with a hit counts towards a restructure, single-leaf ones
+    // too: their leaves get hotter, which moves them forward. Pairs grow
+    // quadratically, so only the first maxLeaves hits are paired.
+    void record(const std::vector<const Node*>& hitLeaves, size_t maxLeaves = 32) {
+        size_t n = std::min(hitLeaves.size(), maxLeaves);
+        if (n == 0) return;
+        std::lock_guard<std::mutex> lock(mtx);
+        ++recordedQueries;
+        for (size_t i = 0; i < n; ++i) {
+            for (size_t j = i + 1; j < n; ++j) {
+                ++counts[hitLeaves[i]][hitLeaves[j]];
+                ++counts[hitLeaves[j]][hitLeaves[i]];
+            }
+        }
+    }
+
+    Counts snapshot() const {
+        std::lock_guard<std::mutex> lock(mtx);
+        return counts;
+    }
+
+    // queries with at least one hit leaf recorded since the last decay
+    uint64_t recordedSinceDecay() const {
+        std::lock_guard<std::mutex> lock(mtx);
+        return recordedQueries;
+    }
+
+    // halves every count so old workload phases fade out
+    void decay() {
+        std::lock_guard<std::mutex> lock(mtx);
+        recordedQueries = 0;
+        for (auto it = counts.begin(); it != counts.end();) {
+            auto& row = it->second;
+            for (auto jt = row.begin(); jt != row.end();) {
+                jt->second /= 2;
+                jt = jt->second == 0 ? row.erase(jt) : std::next(jt);
+            }
+            it = row.empty() ? counts.erase(it) : std::next(it);
+        }
+    }
+
+    void forget(const Node* leaf) {
+        std::lock_guard<std::mutex> lock(mtx);
+        auto it = counts.find(leaf);
+        if (it == counts.end()) return;
+        for (const auto& [other, _] : it->second) {
+            auto ot = counts.find(other);
+            if (ot != counts.end()) ot->second.erase(leaf);
+        }
+        counts.erase(it);
+    }
+
+   private:
+    mutable std::mutex mtx;
+    Counts counts;
+    uint64_t recordedQueries = 0;
+};
@@ -0,0 +1,57 @@
+#include "count_min_sketch.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+#include "MurmurHash3.h"
+
+CountMinSketch::CountMinSketch(size_t width, int depth)
+    : width(width), depth(depth), totalCount(0) {
+    counts.resize(width * depth, 0);
+}
+
+size_t CountMinSketch::index(const std::string& key, int row) const {
+    uint32_t hashOutput;
+    // seeds distinct from the bloom filter's 0..k-1
+    MurmurHash3_x86_32(key.c_str(), key.size(), 0x9747b28cu + row, &hashOutput);
+    return row * width + static_cast<size_t>(hashOutput) % width;
+}
+
+void CountMinSketch::add(const std::string& key, uint32_t count) {
+    for (int row = 0; row < depth; ++row) {
+        counts[index(key, row)] += count;
+    }
+    totalCount += count;
+}
+
+uint32_t CountMinSketch::estimate(const std::string& key) const {
+    uint32_t result = std::numeric_limits<uint32_t>::max();
+    for (int row = 0; row < depth; ++row) {
+        result = std::min(result, counts[index(key, row)]);
+    }
+    return depth > 0 ? result : 0;
+}
+
+void CountMinSketch::merge(const CountMinSketch& other) {
+    if (width != other.width || depth != other.depth) {
+        throw std::runtime_error("CountMinSketch shape mismatch during merge");
+    }
+    for (size_t i = 0; i < counts.size(); ++i) {
+        counts[i] += other.counts[i];
+    }
+    totalCount += other.totalCount;
+}
+
+double CountMinSketch::epsilon() const {
+    return width == 0 ? 1.0 : std::exp(1.0) / static_cast<double>(width);
+}
+
+double CountMinSketch::delta() const {
+    return std::exp(-static_cast<double>(depth));
+}
+
+size_t CountMinSketch::memorySize() const {
+    return counts.capacity() * sizeof(uint32_t) + sizeof(*this);
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Count-min sketch: value -> approximate frequency. Never underestimates;
+// overestimates by at most epsilon() * totalCount with probability
+// 1 - delta().
+class CountMinSketch {
+   private:
+    size_t index(const std::string& key, int row) const;
+
+   public:
+    std::vector<uint32_t> counts;
+    size_t width;
+    int depth;
+    uint64_t totalCount;
+
+    CountMinSketch(size_t width, int depth);
+    void add(const std::string& key, uint32_t count = 1);
+    uint32_t estimate(const std::string& key) const;
+    void merge(const CountMinSketch& other);
+
+    double epsilon() const;
+    double delta() const;
+    size_t memorySize() const;
+};
@@ -0,0 +1,197 @@
+#include "memory_accounting.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+struct alignas(64) TagCounters {
+    std::atomic<int64_t> live{0};
+    std::atomic<int64_t> peak{0};
+    std::atomic<uint64_t> allocations{0};
+    std::atomic<uint64_t> allocatedBytes{0};
+    std::atomic<uint64_t> windowBytes{0};
+};
+
+std::atomic<bool> gAccountingEnabled{false};
+std::array<TagCounters, kMemoryTags> gTagCounters;
+std::atomic<int64_t> gWindowStartNanos{0};
+thread_local MemoryTag tCurrentTag = MemoryTag::Other;
+
+int64_t nowNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+#ifdef HDB_MEMORY_ACCOUNTING
+
+// In front of every block; 16 bytes keeps malloc's alignment for the caller.
+struct alignas(16) BlockHeader {
+    uint64_t size;
+    uint32_t tag;
+    uint32_t counted;
+};
+static_assert(sizeof(BlockHeader) == 16);
+
+void charge(BlockHeader* header, size_t size) {
+    header->size = size;
+    header->tag = static_cast<uint32_t>(tCurrentTag);
+    header->counted = gAccountingEnabled.load(std::memory_order_relaxed) ? 1 : 0;
+    if (!header->counted) return;
+    TagCounters& c = gTagCounters[header->tag];
+    int64_t live = c.live.fetch_add(static_cast<int64_t>(size), std::memory_order_relaxed) +
+                   static_cast<int64_t>(size);
+    int64_t peak = c.peak.load(std::memory_order_relaxed);
+    while (live > peak &&
+           !c.peak.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+    }
+    c.allocations.fetch_add(1, std::memory_order_relaxed);
+    c.allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    c.windowBytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+void credit(const BlockHeader* header) {
+    if (!header->counted) return;
+    gTagCounters[header->tag].live.fetch_sub(static_cast<int64_t>(header->size),
+                                             std::memory_order_relaxed);
+}
+
+size_t headerSpace(std::align_val_t align) {
+    return std::max(sizeof(BlockHeader), static_cast<size_t>(align));
+}
+
+void* allocate(size_t size, std::align_val_t align, bool nothrow) {
+    size_t space = headerSpace(align);
+    for (;;) {
+        void* raw = nullptr;
+        if (static_cast<size_t>(align) <= alignof(std::max_align_t)) {
+            raw = std::malloc(size + space);
+        } else {
+            size_t total = (size + space + static_cast<size_t>(align) - 1) &
+                           ~(static_cast<size_t>(align) - 1);
+            raw = std::aligned_alloc(static_cast<size_t>(align), total);
+        }
+        if (raw) {
+            char* user = static_cast<char*>(raw) + space;
+            charge(reinterpret_cast<BlockHeader*>(user) - 1, size);
+            return user;
+        }
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) {
+            if (nothrow) return nullptr;
+            throw std::bad_alloc();
+        }
+        handler();
+    }
+}
+
+void release(void* ptr, std::align_val_t align) {
+    if (!ptr) return;
+    char* user = static_cast<char*>(ptr);
+    credit(reinterpret_cast<BlockHeader*>(user) - 1);
+    std::free(user - headerSpace(align));
+}
+
+constexpr std::align_val_t kDefaultAlign{alignof(std::max_align_t)};
+
+#endif  // HDB_MEMORY_ACCOUNTING
+
+}  // namespace
+
+bool enableMemoryAccounting(bool enabled) {
+    if (!kMemoryAccountingBuilt) return !enabled;
+    if (enabled && !gAccountingEnabled.load()) {
+        gWindowStartNanos.store(nowNanos());
+    }
+    gAccountingEnabled.store(enabled);
+    return true;
+}
+
+bool memoryAccountingEnabled() { return gAccountingEnabled.load(std::memory_order_relaxed); }
+
+MemoryTagStats memoryStats(MemoryTag tag) {
+    const TagCounters& c = gTagCounters[static_cast<size_t>(tag)];
+    MemoryTagStats stats;
+    stats.liveBytes = c.live.load(std::memory_order_relaxed);
+    stats.peakBytes = c.peak.load(std::memory_order_relaxed);
+    stats.allocations = c.allocations.load(std::memory_order_relaxed);
+    stats.allocatedBytes = c.allocatedBytes.load(std::memory_order_relaxed);
+    double seconds = (nowNanos() - gWindowStartNanos.load()) / 1e9;
+    if (seconds > 0) {
+        stats.allocatedBytesPerSec = c.windowBytes.load(std::memory_order_relaxed) / seconds;
+    }
+    return stats;
+}
+
+void resetMemoryPeaks() {
+    for (auto& c : gTagCounters) {
+        c.peak.store(c.live.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        c.windowBytes.store(0, std::memory_order_relaxed);
+    }
+    gWindowStartNanos.store(nowNanos());
+}
+
+const char* memoryTagName(MemoryTag tag) {
+    switch (tag) {
+        case MemoryTag::Other: return "other";
+        case MemoryTag::Hierarchy: return "hierarchy";
+        case MemoryTag::Build: return "build";
+        case MemoryTag::QueryScratch: return "query_scratch";
+        case MemoryTag::Results: return "results";
+        default: return "unknown";
+    }
+}
+
+MemoryTag setMemoryTag(MemoryTag tag) {
+    MemoryTag previous = tCurrentTag;
+    tCurrentTag = tag;
+    return previous;
+}
+
+MemoryTagScope::MemoryTagScope(MemoryTag tag) : previous(setMemoryTag(tag)) {}
+
+MemoryTagScope::~MemoryTagScope() { tCurrentTag = previous; }
+
+#ifdef HDB_MEMORY_ACCOUNTING
+
+// ---- global allocation functions ----
+
+void* operator new(size_t size) { return allocate(size, kDefaultAlign, false); }
+void* operator new[](size_t size) { return allocate(size, kDefaultAlign, false); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return allocate(size, kDefaultAlign, true);
+}
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return allocate(size, kDefaultAlign, true);
+}
+void* operator new(size_t size, std::align_val_t align) { return allocate(size, align, false); }
+void* operator new[](size_t size, std::align_val_t align) { return allocate(size, align, false); }
+void* operator new(size_t size, std::align_val_t align, const std::nothrow_t&) noexcept {
+    return allocate(size, align, true);
+}
+void* operator new[](size_t size, std::align_val_t align, const std::nothrow_t&) noexcept {
+    return allocate(size, align, true);
+}
+
+void operator delete(void* ptr) noexcept { release(ptr, kDefaultAlign); }
+void operator delete[](void* ptr) noexcept { release(ptr, kDefaultAlign); }
+void operator delete(void* ptr, size_t) noexcept { release(ptr, kDefaultAlign); }
+void operator delete[](void* ptr, size_t) noexcept { release(ptr, kDefaultAlign); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { release(ptr, kDefaultAlign); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { release(ptr, kDefaultAlign); }
+void operator delete(void* ptr, std::align_val_t align) noexcept { release(ptr, align); }
+void operator delete[](void* ptr, std::align_val_t align) noexcept { release(ptr, align); }
+void operator delete(void* ptr, size_t, std::align_val_t align) noexcept { release(ptr, align); }
+void operator delete[](void* ptr, size_t, std::align_val_t align) noexcept { release(ptr, align); }
+void operator delete(void* ptr, std::align_val_t align, const std::nothrow_t&) noexcept {
+    release(ptr, align);
+}
+void operator delete[](void* ptr, std::align_val_t align, const std::nothrow_t&) noexcept {
+    release(ptr, align);
+}
+
+#endif  // HDB_MEMORY_ACCOUNTING
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Tagged heap accounting. Built with HDB_MEMORY_ACCOUNTING (make
+// MEMORY_ACCOUNTING=1), global operator new/delete (memory_accounting.cpp)
+// charge every allocation to the calling thread's current tag and remember
+// it, so a free is credited back to the tag that allocated, wherever it
+// happens. Counting is off until enabled; blocks allocated before that are
+// never counted. Without the flag the stock allocator is used, tags are
+// still tracked per thread and enabling is refused.
+enum class MemoryTag : uint32_t {
+    Other,
+    Hierarchy,     // nodes, filter bits, sketches, key bounds
+    Build,         // SST readers and buffers while building leaves
+    QueryScratch,  // traversal state, candidate lists, SST scan buffers
+    Results,       // matching keys handed back to the caller
+    Count
+};
+
+constexpr size_t kMemoryTags = static_cast<size_t>(MemoryTag::Count);
+
+struct MemoryTagStats {
+    int64_t liveBytes = 0;
+    int64_t peakBytes = 0;
+    uint64_t allocations = 0;
+    uint64_t allocatedBytes = 0;
+    double allocatedBytesPerSec = 0.0;  // since enable / resetMemoryPeaks
+};
+
+#ifdef HDB_MEMORY_ACCOUNTING
+constexpr bool kMemoryAccountingBuilt = true;
+#else
+constexpr bool kMemoryAccountingBuilt = false;
+#endif
+
+// false if the build has no allocation hooks
+bool enableMemoryAccounting(bool enabled);
+bool memoryAccountingEnabled();
+MemoryTagStats memoryStats(MemoryTag tag);
+// peaks drop to the live bytes, the rate window restarts
+void resetMemoryPeaks();
+const char* memoryTagName(MemoryTag tag);
+
+// Sets the calling thread's tag, returns the previous one.
+MemoryTag setMemoryTag(MemoryTag tag);
+
+// Sets the calling thread's tag until the scope ends.
+class MemoryTagScope {
+   public:
+    explicit MemoryTagScope(MemoryTag tag);
+    ~MemoryTagScope();
+    MemoryTagScope(const MemoryTagScope&) = delete;
+    MemoryTagScope& operator=(const MemoryTagScope&) = delete;
+
+   private:
+    MemoryTag previous;
+};
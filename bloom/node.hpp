@@ -1,26 +1,185 @@
 #pragma once
 #include <spdlog/spdlog.h>
 
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
 #include <memory>
+#include <optional>
 #include <string>
 #include <vector>
 
 #include "bloom_value.hpp"
+#include "count_min_sketch.hpp"
+#include "quotient_filter.hpp"
+
+class Node;
+
+// Children's key ranges and pointers packed into one cache line, so a parent
+// can rule out children by key and reach the others without touching its
+// children vector. Keys are reduced to the 2 bytes that follow the parent's
+// common key prefix; the reduction is monotone, so a reject is always exact
+// and only some overlaps are false.
+template <size_t MaxFanout>
+struct alignas(64) ChildRangeIndex {
+    std::array<Node*, MaxFanout> child{};
+    std::array<uint16_t, MaxFanout> startPrefix{};
+    std::array<uint16_t, MaxFanout> endPrefix{};
+    uint16_t prefixLen = 0;
+    uint8_t count = 0;  // 0: not indexed, check every child
+
+    // base[0, prefixLen) is the common prefix
+    uint16_t reduce(const std::string& key, const std::string& base) const {
+        int cmp = key.compare(0, prefixLen, base, 0, prefixLen);
+        if (cmp < 0) return 0;
+        if (cmp > 0) return UINT16_MAX;
+        uint32_t v = 0;
+        for (size_t i = 0; i < 2; ++i) {
+            size_t pos = prefixLen + i;
+            v = (v << 8) | (pos < key.size() ? static_cast<unsigned char>(key[pos]) : 0u);
+        }
+        return static_cast<uint16_t>(v);
+    }
+
+    // bit i set if child i may overlap [lo, hi] (reduced keys)
+    uint32_t overlapMask(uint16_t lo, uint16_t hi) const {
+        uint32_t mask = 0;
+        for (size_t i = 0; i < MaxFanout; ++i) {
+            mask |= static_cast<uint32_t>(startPrefix[i] <= hi && endPrefix[i] >= lo) << i;
+        }
+        return mask & ((1u << count) - 1u);
+    }
+};
 
 class Node {
    public:
+    // 5 children with 16-bit bounds and their pointers fill one cache line
+    static constexpr size_t kInlineFanout = 5;
     std::vector<Node*> children;
     BloomFilter bloom;
     std::string filename;
     std::string startKey;
     std::string endKey;
 
+    // set by indexChildren() for internal nodes with up to kInlineFanout children
+    ChildRangeIndex<kInlineFanout> childRanges;
+    static_assert(sizeof(ChildRangeIndex<kInlineFanout>) == 64,
+                  "child range index must stay one cache line");
+
+    // entries of the partition (leaf) or of all leaves below (internal node)
+    size_t itemCount = 0;
+
+    // Filter health, updated by queries: equality probes of this node's
+    // bloom filter, probes that passed, passes whose SST scan settled
+    // whether the value is there, and those of them that found keys
+    mutable std::atomic<uint64_t> probeCount{0};
+    mutable std::atomic<uint64_t> passCount{0};
+    mutable std::atomic<uint64_t> scanCount{0};
+    mutable std::atomic<uint64_t> hitCount{0};
+
+    // Zone map: smallest and largest value stored under this node
+    bool hasValueRange = false;
+    std::string minValue;
+    std::string maxValue;
+
+    // replaces bloom for hierarchies built with FilterKind::Quotient
+    std::optional<QuotientFilter> qfilter;
+
+    // n-gram / prefix filter, present only for columns built with a text mode
+    std::optional<BloomFilter> textBloom;
+
+    // value frequencies of a leaf partition, for count estimates
+    std::optional<CountMinSketch> sketch;
+
     Node(BloomFilter bf, std::string fname, std::string start, std::string end)
         : bloom(std::move(bf)), filename(std::move(fname)), startKey(std::move(start)), endKey(std::move(end)) {}
 
     Node(size_t bloomSize, double falsePositiveRate)
         : filename("Memory"), bloom(bloomSize, falsePositiveRate) {}
 
+    void indexChildren() {
+        childRanges = {};
+        if (children.empty() || children.size() > kInlineFanout) return;
+        size_t len = 0;
+        while (len < startKey.size() && len < endKey.size() && len < UINT16_MAX &&
+               startKey[len] == endKey[len]) {
+            ++len;
+        }
+        childRanges.prefixLen = static_cast<uint16_t>(len);
+        for (size_t i = 0; i < children.size(); ++i) {
+            childRanges.child[i] = children[i];
+            childRanges.startPrefix[i] = childRanges.reduce(children[i]->startKey, startKey);
+            childRanges.endPrefix[i] = childRanges.reduce(children[i]->endKey, startKey);
+        }
+        childRanges.count = static_cast<uint8_t>(children.size());
+    }
+
+    // Children that may overlap [qStart, qEnd] (empty = unbounded) as a bit
+    // mask, or all ones if the children are not indexed.
+    uint32_t childOverlapMask(const std::string& qStart, const std::string& qEnd) const {
+        if (childRanges.count == 0) return UINT32_MAX;
+        uint16_t lo = qStart.empty() ? 0 : childRanges.reduce(qStart, startKey);
+        uint16_t hi = qEnd.empty() ? UINT16_MAX : childRanges.reduce(qEnd, startKey);
+        return childRanges.overlapMask(lo, hi);
+    }
+
+    // Calls f on every child that may overlap [qStart, qEnd]; indexed nodes
+    // are walked from childRanges alone.
+    template <typename F>
+    void forEachOverlappingChild(const std::string& qStart, const std::string& qEnd, F&& f) const {
+        if (childRanges.count == 0) {
+            for (Node* child : children) f(child);
+            return;
+        }
+        for (uint32_t mask = childOverlapMask(qStart, qEnd); mask != 0; mask &= mask - 1) {
+            f(childRanges.child[std::countr_zero(mask)]);
+        }
+    }
+
+    void extendValueRange(const std::string& low, const std::string& high) {
+        if (!hasValueRange) {
+            minValue = low;
+            maxValue = high;
+            hasValueRange = true;
+            return;
+        }
+        if (low < minValue) minValue = low;
+        if (high > maxValue) maxValue = high;
+    }
+
+    // true if some value in [low, high] may be stored under this node;
+    // bounds are compared byte-wise, as std::string does
+    bool valueRangeOverlaps(const std::string& low, const std::string& high) const {
+        if (!hasValueRange) return true;
+        return minValue <= high && maxValue >= low;
+    }
+
+    bool probe(const std::string& value) const {
+        probeCount.fetch_add(1, std::memory_order_relaxed);
+        bool present = qfilter ? qfilter->exists(value) : bloom.exists(value);
+        if (!present) return false;
+        passCount.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // An empty scan of part of the leaf proves nothing about the rest, so
+    // it is only counted when wholeLeaf.
+    void recordScanResult(bool foundKeys, bool wholeLeaf = true) const {
+        if (!foundKeys && !wholeLeaf) return;
+        scanCount.fetch_add(1, std::memory_order_relaxed);
+        if (foundKeys) hitCount.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // true unless the text filter proves one of the probes absent
+    bool textMayMatch(const std::vector<std::string>& probes) const {
+        if (!textBloom) return true;
+        for (const auto& probe : probes) {
+            if (!textBloom->exists(probe)) return false;
+        }
+        return true;
+    }
+
     void print() const {
         spdlog::info("Node: {}, Start: {}, End: {}", filename, startKey, endKey);
         for (const auto& child : children) {
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+/// Global counter of bloom‐filter lookups performed (monotonic, never reset)
+inline std::atomic<size_t> gBloomCheckCount{0};
+/// Global counter of leaf-node bloom-filter lookups performed (monotonic)
+inline std::atomic<size_t> gLeafBloomCheckCount{0};
+/// Global counter of SSTables checked (monotonic)
+inline std::atomic<size_t> gSSTCheckCount{0};
+
+// Checks made while a QueryCounterScope on this counter (or on a scope
+// nested inside it) was active. Concurrent queries each get their own, so
+// per-query numbers no longer come from resetting the globals.
+struct QueryCounters {
+    std::atomic<size_t> bloomChecks{0};
+    std::atomic<size_t> leafBloomChecks{0};
+    std::atomic<size_t> sstChecks{0};
+    QueryCounters* parent = nullptr;
+};
+
+inline thread_local QueryCounters* tQueryCounters = nullptr;
+
+// Makes counters the calling thread's current one until the scope ends.
+// Nested scopes also count into the enclosing ones.
+class QueryCounterScope {
+   public:
+    explicit QueryCounterScope(QueryCounters& counters)
+        : previous(tQueryCounters) {
+        counters.parent = previous;
+        tQueryCounters = &counters;
+    }
+    ~QueryCounterScope() { tQueryCounters = previous; }
+    QueryCounterScope(const QueryCounterScope&) = delete;
+    QueryCounterScope& operator=(const QueryCounterScope&) = delete;
+
+   private:
+    QueryCounters* previous;
+};
+
+inline void countBloomCheck(bool leaf) {
+    ++gBloomCheckCount;
+    if (leaf) ++gLeafBloomCheckCount;
+    for (QueryCounters* c = tQueryCounters; c; c = c->parent) {
+        ++c->bloomChecks;
+        if (leaf) ++c->leafBloomChecks;
+    }
+}
+
+inline void countSstChecks(size_t n) {
+    gSSTCheckCount += n;
+    for (QueryCounters* c = tQueryCounters; c; c = c->parent) {
+        c->sstChecks += n;
+    }
+}
@@ -0,0 +1,431 @@
+#include "quotient_filter.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <stdexcept>
+
+#include "MurmurHash3.h"
+
+QuotientFilter::QuotientFilter(int fingerprintBits)
+    : fingerprintBits(std::clamp(fingerprintBits, 8, 32)), quotientBits(0) {
+    allocate(kMinQuotientBits);
+}
+
+uint32_t QuotientFilter::fingerprint(const std::string& value) const {
+    uint32_t hashOutput;
+    // seed distinct from the bloom filter's and the sketch's
+    MurmurHash3_x86_32(value.c_str(), value.size(), 0x51ed270bu, &hashOutput);
+    return fingerprintBits == 32 ? hashOutput : hashOutput >> (32 - fingerprintBits);
+}
+
+void QuotientFilter::setBit(std::vector<uint64_t>& bits, size_t i, bool on) {
+    uint64_t mask = uint64_t{1} << (i & 63);
+    if (on) {
+        bits[i >> 6] |= mask;
+    } else {
+        bits[i >> 6] &= ~mask;
+    }
+}
+
+uint64_t QuotientFilter::remainderAt(size_t slot) const {
+    int r = remainderBits();
+    if (r == 0) return 0;
+    size_t pos = slot * r;
+    size_t word = pos >> 6;
+    int offset = pos & 63;
+    uint64_t value = remainders[word] >> offset;
+    if (offset + r > 64) value |= remainders[word + 1] << (64 - offset);
+    return value & ((uint64_t{1} << r) - 1);
+}
+
+void QuotientFilter::setRemainder(size_t slot, uint64_t value) {
+    int r = remainderBits();
+    if (r == 0) return;
+    uint64_t mask = (uint64_t{1} << r) - 1;
+    size_t pos = slot * r;
+    size_t word = pos >> 6;
+    int offset = pos & 63;
+    remainders[word] = (remainders[word] & ~(mask << offset)) | (value << offset);
+    if (offset + r > 64) {
+        int spill = 64 - offset;
+        remainders[word + 1] = (remainders[word + 1] & ~(mask >> spill)) | (value >> spill);
+    }
+}
+
+// A slot with content is either a run start at its home (occupied) or
+// shifted; a continuation is always shifted too.
+bool QuotientFilter::isEmpty(size_t slot) const {
+    return !bit(occupied, slot) && !bit(continuation, slot) && !bit(shifted, slot);
+}
+
+// Walks back to the start of the cluster, then forward run by run, one per
+// occupied home, until it reaches quotient's. For an unoccupied quotient it
+// returns where its run would go.
+size_t QuotientFilter::runStart(size_t quotient) const {
+    size_t home = quotient;
+    while (home > 0 && bit(shifted, home)) --home;
+    size_t start = home;
+    while (home != quotient) {
+        do ++start; while (bit(continuation, start));
+        do ++home; while (!bit(occupied, home));
+    }
+    return start;
+}
+
+size_t QuotientFilter::nextOccupied(size_t quotient) const {
+    do ++quotient; while (!bit(occupied, quotient));
+    return quotient;
+}
+
+size_t QuotientFilter::find(uint32_t fp) const {
+    size_t quotient = fp >> remainderBits();
+    uint64_t remainder = fp & ((uint64_t{1} << remainderBits()) - 1);
+    if (!bit(occupied, quotient)) return npos;
+    size_t slot = runStart(quotient);
+    do {
+        uint64_t stored = remainderAt(slot);
+        if (stored == remainder) return slot;
+        if (stored > remainder) return npos;
+        ++slot;
+    } while (bit(continuation, slot));
+    return npos;
+}
+
+uint32_t QuotientFilter::extraCount(uint32_t fp) const {
+    if (extraCounts.empty()) return 0;
+    auto it = extraCounts.find(fp);
+    return it == extraCounts.end() ? 0 : it->second;
+}
+
+int QuotientFilter::quotientBitsFor(size_t items) const {
+    int bits = kMinQuotientBits;
+    while (bits < fingerprintBits && std::ldexp(kMaxLoad, bits) < static_cast<double>(items)) {
+        ++bits;
+    }
+    return bits;
+}
+
+// The metadata vectors get one spare bit past the last slot, always clear,
+// so run scans stop there without a bounds check; the remainders get a
+// spare word for fields that straddle two words.
+void QuotientFilter::allocate(int newQuotientBits) {
+    quotientBits = std::clamp(newQuotientBits, kMinQuotientBits, fingerprintBits);
+    slots = (size_t{1} << quotientBits) + kOverflowSlots;
+    size_t metaWords = (slots + 1 + 63) / 64;
+    remainders.assign((slots * remainderBits() + 63) / 64 + 1, 0);
+    occupied.assign(metaWords, 0);
+    continuation.assign(metaWords, 0);
+    shifted.assign(metaWords, 0);
+    distinct = 0;
+}
+
+bool QuotientFilter::place(const std::vector<uint32_t>& fps) {
+    int r = remainderBits();
+    uint64_t mask = (uint64_t{1} << r) - 1;
+    size_t next = 0;
+    size_t lastHome = npos;
+    for (uint32_t fp : fps) {
+        size_t home = fp >> r;
+        bool sameRun = home == lastHome;
+        size_t slot = sameRun ? next : std::max(next, home);
+        if (slot >= slots) return false;
+        if (!sameRun) setBit(occupied, home, true);
+        setRemainder(slot, fp & mask);
+        setBit(continuation, slot, sameRun);
+        setBit(shifted, slot, slot != home);
+        next = slot + 1;
+        lastHome = home;
+    }
+    distinct = fps.size();
+    return true;
+}
+
+// With every fingerprint bit in the quotient each run is one slot at its
+// home, so placement can't overrun and the loop ends.
+void QuotientFilter::rebuild(const std::vector<uint32_t>& fps, int newQuotientBits) {
+    for (int bits = newQuotientBits;; ++bits) {
+        allocate(bits);
+        if (place(fps)) return;
+    }
+}
+
+std::vector<uint32_t> QuotientFilter::fingerprints() const {
+    std::vector<uint32_t> fps;
+    fps.reserve(distinct);
+    int r = remainderBits();
+    size_t home = 0;
+    bool first = true;
+    for (size_t slot = 0; slot < slots && fps.size() < distinct; ++slot) {
+        if (isEmpty(slot)) continue;
+        if (!bit(continuation, slot)) {
+            // runs are laid out in home order, so each new run is the next occupied home
+            if (first) {
+                while (!bit(occupied, home)) ++home;
+                first = false;
+            } else {
+                home = nextOccupied(home);
+            }
+        }
+        fps.push_back(static_cast<uint32_t>((uint64_t{home} << r) | remainderAt(slot)));
+    }
+    return fps;
+}
+
+void QuotientFilter::insertFingerprint(uint32_t fp) {
+    if (find(fp) != npos) {
+        ++extraCounts[fp];
+        return;
+    }
+    if (quotientBits < fingerprintBits &&
+        std::ldexp(kMaxLoad, quotientBits) < static_cast<double>(distinct + 1)) {
+        resize(quotientBits + 1);
+    }
+
+    int r = remainderBits();
+    size_t quotient = fp >> r;
+    uint64_t remainder = fp & ((uint64_t{1} << r) - 1);
+
+    if (isEmpty(quotient)) {
+        setRemainder(quotient, remainder);
+        setBit(occupied, quotient, true);
+        ++distinct;
+        return;
+    }
+
+    // the shift ends at the first empty slot right of home; none left means
+    // the cluster would run off the table
+    size_t end = quotient;
+    while (end < slots && !isEmpty(end)) ++end;
+    if (end == slots) {
+        resize(quotientBits + 1);
+        insertFingerprint(fp);
+        return;
+    }
+
+    bool hadRun = bit(occupied, quotient);
+    setBit(occupied, quotient, true);
+    size_t start = runStart(quotient);
+    size_t slot = start;
+    if (hadRun) {
+        while (remainderAt(slot) < remainder) {
+            ++slot;
+            if (!bit(continuation, slot)) break;
+        }
+    }
+
+    // write the new remainder at slot and carry each displaced one a slot
+    // right; a displaced run start of this run becomes its continuation
+    uint64_t carryRemainder = remainder;
+    bool carryContinuation = hadRun && slot != start;
+    bool carryShifted = slot != quotient;
+    for (size_t i = slot;; ++i) {
+        bool wasEmpty = isEmpty(i);
+        uint64_t nextRemainder = remainderAt(i);
+        bool nextContinuation = bit(continuation, i) || (hadRun && i == start && slot == start);
+        setRemainder(i, carryRemainder);
+        setBit(continuation, i, carryContinuation);
+        setBit(shifted, i, carryShifted);
+        if (wasEmpty) break;
+        carryRemainder = nextRemainder;
+        carryContinuation = nextContinuation;
+        carryShifted = true;
+    }
+    ++distinct;
+}
+
+void QuotientFilter::insert(const std::string& value) {
+    insertFingerprint(fingerprint(value));
+}
+
+void QuotientFilter::insertAll(const std::vector<std::string>& values) {
+    std::vector<uint32_t> fps;
+    fps.reserve(values.size());
+    for (const auto& value : values) fps.push_back(fingerprint(value));
+    std::sort(fps.begin(), fps.end());
+
+    QuotientFilter batch(fingerprintBits);
+    size_t out = 0;
+    for (size_t i = 0; i < fps.size(); ++i) {
+        if (out > 0 && fps[out - 1] == fps[i]) {
+            ++batch.extraCounts[fps[i]];
+        } else {
+            fps[out++] = fps[i];
+        }
+    }
+    fps.resize(out);
+    batch.rebuild(fps, batch.quotientBitsFor(fps.size()));
+
+    if (distinct == 0 && extraCounts.empty()) {
+        *this = std::move(batch);
+    } else {
+        merge(batch);
+    }
+}
+
+bool QuotientFilter::exists(const std::string& value) const {
+    return find(fingerprint(value)) != npos;
+}
+
+uint32_t QuotientFilter::count(const std::string& value) const {
+    uint32_t fp = fingerprint(value);
+    return find(fp) == npos ? 0 : 1 + extraCount(fp);
+}
+
+bool QuotientFilter::erase(const std::string& value) {
+    uint32_t fp = fingerprint(value);
+    size_t slot = find(fp);
+    if (slot == npos) return false;
+    auto extra = extraCounts.find(fp);
+    if (extra != extraCounts.end()) {
+        if (--extra->second == 0) extraCounts.erase(extra);
+        return true;
+    }
+
+    size_t quotient = fp >> remainderBits();
+    bool removedStart = slot == runStart(quotient);
+    if (removedStart && !bit(continuation, slot + 1)) {
+        setBit(occupied, quotient, false);
+    }
+
+    // pull the rest of the cluster one slot left, up to an empty slot or a
+    // remainder already at its home; home tracks whose run is being moved
+    size_t home = quotient;
+    size_t i = slot;
+    for (; !isEmpty(i + 1) && bit(shifted, i + 1); ++i) {
+        bool cont = bit(continuation, i + 1);
+        if (!cont) home = nextOccupied(home);
+        setRemainder(i, remainderAt(i + 1));
+        setBit(continuation, i, cont && !(i == slot && removedStart));
+        setBit(shifted, i, i != home);
+    }
+    setRemainder(i, 0);
+    setBit(continuation, i, false);
+    setBit(shifted, i, false);
+    --distinct;
+    return true;
+}
+
+void QuotientFilter::merge(const QuotientFilter& other) {
+    // a narrower fingerprint can't be widened, so this side is cut down
+    if (other.fingerprintBits < fingerprintBits) {
+        narrowTo(other.fingerprintBits);
+    }
+    int shift = other.fingerprintBits - fingerprintBits;
+
+    std::vector<uint32_t> mine = fingerprints();
+    std::vector<uint32_t> theirs = other.fingerprints();
+    std::vector<uint32_t> merged;
+    merged.reserve(mine.size() + theirs.size());
+    std::unordered_map<uint32_t, uint32_t> mergedExtra;
+
+    auto append = [&](uint32_t fp, uint32_t count) {
+        if (!merged.empty() && merged.back() == fp) {
+            mergedExtra[fp] += count;
+        } else {
+            merged.push_back(fp);
+            if (count > 1) mergedExtra[fp] += count - 1;
+        }
+    };
+
+    size_t i = 0, j = 0;
+    while (i < mine.size() || j < theirs.size()) {
+        uint32_t otherFp = j < theirs.size() ? theirs[j] >> shift : 0;
+        if (j >= theirs.size() || (i < mine.size() && mine[i] <= otherFp)) {
+            append(mine[i], 1 + extraCount(mine[i]));
+            ++i;
+        } else {
+            append(otherFp, 1 + other.extraCount(theirs[j]));
+            ++j;
+        }
+    }
+    extraCounts = std::move(mergedExtra);
+    rebuild(merged, quotientBitsFor(merged.size()));
+}
+
+void QuotientFilter::narrowTo(int bits) {
+    int shift = fingerprintBits - bits;
+    std::vector<uint32_t> fps = fingerprints();
+    std::unordered_map<uint32_t, uint32_t> narrowedExtra;
+    size_t out = 0;
+    for (uint32_t fp : fps) {
+        uint32_t narrowed = fp >> shift;
+        uint32_t extra = extraCount(fp);
+        if (out > 0 && fps[out - 1] == narrowed) {
+            narrowedExtra[narrowed] += 1 + extra;
+        } else {
+            fps[out++] = narrowed;
+            if (extra > 0) narrowedExtra[narrowed] += extra;
+        }
+    }
+    fps.resize(out);
+    extraCounts = std::move(narrowedExtra);
+    fingerprintBits = bits;
+    rebuild(fps, quotientBitsFor(fps.size()));
+}
+
+void QuotientFilter::resize(int newQuotientBits) {
+    rebuild(fingerprints(), std::clamp(newQuotientBits, kMinQuotientBits, fingerprintBits));
+}
+
+double QuotientFilter::estimatedFpr() const {
+    return std::min(1.0, static_cast<double>(distinct) / std::ldexp(1.0, fingerprintBits));
+}
+
+size_t QuotientFilter::memorySize() const {
+    size_t bytes = (remainders.capacity() + occupied.capacity() + continuation.capacity() +
+                    shifted.capacity()) * sizeof(uint64_t);
+    bytes += extraCounts.bucket_count() * sizeof(void*) +
+             extraCounts.size() * (sizeof(std::pair<const uint32_t, uint32_t>) + sizeof(void*));
+    return bytes;
+}
+
+size_t QuotientFilter::diskSize() const {
+    return sizeof(fingerprintBits) + sizeof(quotientBits) + 2 * sizeof(size_t) +
+           (remainders.size() + 3 * occupied.size()) * sizeof(uint64_t) +
+           extraCounts.size() * 2 * sizeof(uint32_t);
+}
+
+void QuotientFilter::saveToFile(const std::string& filename) const {
+    std::ofstream file(filename, std::ios::binary);
+    if (!file) throw std::runtime_error("Error opening file: " + filename);
+
+    size_t extras = extraCounts.size();
+    file.write(reinterpret_cast<const char*>(&fingerprintBits), sizeof(fingerprintBits));
+    file.write(reinterpret_cast<const char*>(&quotientBits), sizeof(quotientBits));
+    file.write(reinterpret_cast<const char*>(&distinct), sizeof(distinct));
+    file.write(reinterpret_cast<const char*>(&extras), sizeof(extras));
+    for (const auto* bits : {&remainders, &occupied, &continuation, &shifted}) {
+        file.write(reinterpret_cast<const char*>(bits->data()), bits->size() * sizeof(uint64_t));
+    }
+    for (const auto& [fp, extra] : extraCounts) {
+        file.write(reinterpret_cast<const char*>(&fp), sizeof(fp));
+        file.write(reinterpret_cast<const char*>(&extra), sizeof(extra));
+    }
+}
+
+QuotientFilter QuotientFilter::loadFromFile(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file) throw std::runtime_error("Error opening file: " + filename);
+
+    int fingerprintBits, quotientBits;
+    size_t distinct, extras;
+    file.read(reinterpret_cast<char*>(&fingerprintBits), sizeof(fingerprintBits));
+    file.read(reinterpret_cast<char*>(&quotientBits), sizeof(quotientBits));
+    file.read(reinterpret_cast<char*>(&distinct), sizeof(distinct));
+    file.read(reinterpret_cast<char*>(&extras), sizeof(extras));
+
+    QuotientFilter filter(fingerprintBits);
+    filter.allocate(quotientBits);
+    filter.distinct = distinct;
+    for (auto* bits : {&filter.remainders, &filter.occupied, &filter.continuation, &filter.shifted}) {
+        file.read(reinterpret_cast<char*>(bits->data()), bits->size() * sizeof(uint64_t));
+    }
+    for (size_t i = 0; i < extras; ++i) {
+        uint32_t fp, extra;
+        file.read(reinterpret_cast<char*>(&fp), sizeof(fp));
+        file.read(reinterpret_cast<char*>(&extra), sizeof(extra));
+        filter.extraCounts.emplace(fp, extra);
+    }
+    return filter;
+}
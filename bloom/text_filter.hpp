@@ -0,0 +1,70 @@
+#pragma once
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+// Optional per-column filter over parts of a value, used for substring
+// (LIKE '%p%') and prefix (LIKE 'p%') predicates.
+enum class TextFilterMode { None, NGram, Prefix };
+
+// The n-gram of value at offset, tagged with the offset. Longer than
+// gramSize, so it never collides with a plain prefix term.
+inline std::string positionalGram(const std::string& value, size_t offset,
+                                  size_t gramSize) {
+    return std::to_string(offset) + '\x1f' + value.substr(offset, gramSize);
+}
+
+// Terms inserted into the text filter for one stored value.
+inline std::vector<std::string> textFilterTerms(const std::string& value,
+                                                TextFilterMode mode,
+                                                size_t gramSize) {
+    std::vector<std::string> terms;
+    if (gramSize == 0) return terms;
+    if (mode == TextFilterMode::NGram) {
+        if (value.size() < gramSize) return terms;
+        terms.reserve(value.size() - gramSize + 1);
+        for (size_t i = 0; i + gramSize <= value.size(); ++i) {
+            terms.push_back(value.substr(i, gramSize));
+        }
+    } else if (mode == TextFilterMode::Prefix) {
+        // prefixes up to gramSize, then every later n-gram with its offset,
+        // so longer prefixes are checked along their whole length
+        size_t maxLen = std::min(gramSize, value.size());
+        terms.reserve(std::max(value.size(), gramSize));
+        for (size_t len = 1; len <= maxLen; ++len) {
+            terms.push_back(value.substr(0, len));
+        }
+        for (size_t i = 1; i + gramSize <= value.size(); ++i) {
+            terms.push_back(positionalGram(value, i, gramSize));
+        }
+    }
+    return terms;
+}
+
+// Terms that must all be present in a node's text filter for a value under
+// it to match the pattern. Empty result means the filter cannot prune.
+inline std::vector<std::string> textFilterProbes(const std::string& pattern,
+                                                 bool prefixOnly,
+                                                 TextFilterMode mode,
+                                                 size_t gramSize) {
+    if (mode == TextFilterMode::NGram) {
+        return textFilterTerms(pattern, mode, gramSize);
+    }
+    if (mode == TextFilterMode::Prefix && prefixOnly && !pattern.empty() &&
+        gramSize > 0) {
+        std::vector<std::string> probes{
+            pattern.substr(0, std::min(gramSize, pattern.size()))};
+        for (size_t i = 1; i + gramSize <= pattern.size(); ++i) {
+            probes.push_back(positionalGram(pattern, i, gramSize));
+        }
+        return probes;
+    }
+    return {};
+}
+
+inline bool textMatches(const std::string& value, const std::string& pattern,
+                        bool prefixOnly) {
+    if (prefixOnly) return value.compare(0, pattern.size(), pattern) == 0;
+    return value.find(pattern) != std::string::npos;
+}
@@ -0,0 +1,99 @@
+#include "value_dictionary.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+
+std::string ValueDictionary::codeString(uint32_t code) {
+    std::string out(kCodeWidth, '\0');
+    for (size_t i = 0; i < kCodeWidth; ++i) {
+        out[kCodeWidth - 1 - i] = static_cast<char>(code >> (8 * i) & 0xffu);
+    }
+    return out;
+}
+
+uint32_t ValueDictionary::codeValue(const std::string& code) {
+    uint32_t v = 0;
+    for (size_t i = 0; i < kCodeWidth && i < code.size(); ++i) {
+        v = (v << 8) | static_cast<unsigned char>(code[i]);
+    }
+    return v;
+}
+
+const std::string& ValueDictionary::absentCode() {
+    static const std::string absent(kCodeWidth + 1, '\xff');
+    return absent;
+}
+
+std::string ValueDictionary::reserve(const std::string& value, bool* unpublished) {
+    *unpublished = false;
+    {
+        std::shared_lock<std::shared_mutex> lock(mtx);
+        auto it = codes.find(value);
+        if (it != codes.end()) return codeString(it->second);
+    }
+    std::unique_lock<std::shared_mutex> lock(mtx);
+    auto it = codes.find(value);
+    if (it != codes.end()) return codeString(it->second);
+    *unpublished = true;
+    auto pending = reserved.find(value);
+    if (pending != reserved.end()) return codeString(pending->second);
+    // a failed write leaves its code reserved; it is not handed out again
+    if (nextCode == std::numeric_limits<uint32_t>::max()) {
+        throw std::runtime_error("ValueDictionary: out of codes");
+    }
+    uint32_t code = nextCode++;
+    reserved.emplace(value, code);
+    return codeString(code);
+}
+
+void ValueDictionary::publish(const std::string& value) {
+    std::unique_lock<std::shared_mutex> lock(mtx);
+    auto it = reserved.find(value);
+    if (it == reserved.end()) return;  // published by another writer
+    uint32_t code = it->second;
+    reserved.erase(it);
+    if (values.size() <= code) values.resize(code + 1);
+    values[code] = value;
+    codes[value] = code;
+}
+
+std::string ValueDictionary::encode(const std::string& value) const {
+    std::shared_lock<std::shared_mutex> lock(mtx);
+    auto it = codes.find(value);
+    return it == codes.end() ? absentCode() : codeString(it->second);
+}
+
+std::string ValueDictionary::decode(const std::string& code) const {
+    if (code.size() != kCodeWidth) return code;
+    uint32_t v = codeValue(code);
+    std::shared_lock<std::shared_mutex> lock(mtx);
+    return v < values.size() ? values[v] : code;
+}
+
+void ValueDictionary::restore(const std::string& code, const std::string& value) {
+    uint32_t v = codeValue(code);
+    std::unique_lock<std::shared_mutex> lock(mtx);
+    if (values.size() <= v) values.resize(v + 1);
+    values[v] = value;
+    codes[value] = v;
+    nextCode = std::max(nextCode, v + 1);
+}
+
+size_t ValueDictionary::size() const {
+    std::shared_lock<std::shared_mutex> lock(mtx);
+    return codes.size();
+}
+
+size_t ValueDictionary::memorySize() const {
+    std::shared_lock<std::shared_mutex> lock(mtx);
+    // hash nodes hold a pointer, the key and the code
+    size_t bytes = values.capacity() * sizeof(std::string) +
+                   codes.size() * (sizeof(void*) + sizeof(std::string) + sizeof(uint32_t)) +
+                   codes.bucket_count() * sizeof(void*);
+    for (const auto& value : values) {
+        if (value.capacity() > sizeof(std::string)) bytes += 2 * value.capacity();
+    }
+    return bytes;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Per-column value dictionary: each distinct value gets a dense code, stored
+// as kCodeWidth big-endian bytes in place of the value, so scans compare and
+// filters hash fixed-width codes. Codes follow arrival order; they keep
+// equality but not order, so range and text predicates can't run on an
+// encoded column.
+class ValueDictionary {
+   public:
+    static constexpr size_t kCodeWidth = 4;
+
+    // code of value for a write; a new value gets the next free code,
+    // reserved but not visible to encode/decode until publish. unpublished
+    // is set while that holds, so the writer also stores the entry. Writers
+    // of one new value share its reservation.
+    std::string reserve(const std::string& value, bool* unpublished);
+    // makes a reserved code visible, once a write that stored it succeeded
+    void publish(const std::string& value);
+    // code of value, or absentCode() if it was never written
+    std::string encode(const std::string& value) const;
+    // value of a stored code; the input itself if it is not a known code
+    std::string decode(const std::string& code) const;
+    // puts back an entry loaded from storage
+    void restore(const std::string& code, const std::string& value);
+    size_t size() const;
+    size_t memorySize() const;
+
+    // one byte longer than any code, so it never equals a stored value
+    static const std::string& absentCode();
+    static std::string codeString(uint32_t code);
+    static uint32_t codeValue(const std::string& code);
+
+   private:
+    mutable std::shared_mutex mtx;
+    std::unordered_map<std::string, uint32_t> codes;
+    std::vector<std::string> values;  // index = code
+    std::unordered_map<std::string, uint32_t> reserved;
+    uint32_t nextCode = 0;
+};
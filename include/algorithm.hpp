@@ -6,26 +6,109 @@
 #include <atomic>
 #include <boost/asio/post.hpp>
 #include <boost/asio/thread_pool.hpp>
+#include <chrono>
+#include <cmath>
 #include <functional>
 #include <future>
 #include <iostream>
+#include <limits>
+#include <stdexcept>
 #include <string>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
 #include "bloomTree.hpp"
 #include "db_manager.hpp"
+#include "memory_accounting.hpp"
+#include "metrics.hpp"
 #include "node.hpp"
+#include "perf_counters.hpp"
+#include "query_counters.hpp"
 #include "stopwatch.hpp"
 
 extern boost::asio::thread_pool globalThreadPool;
 
-/// Global counter of bloom‐filter lookups performed
-inline std::atomic<size_t> gBloomCheckCount{0};
-/// Global counter of leaf-node bloom-filter lookups performed
-inline std::atomic<size_t> gLeafBloomCheckCount{0};
-/// Global counter of SSTables checked
-inline std::atomic<size_t> gSSTCheckCount{0};
+
+// Per-column predicate: equality (bloom filter), range (zone map) or
+// substring / prefix (text filter)
+struct ColumnPredicate {
+  enum class Kind { Equal, Range, Contains, Prefix };
+  Kind kind = Kind::Equal;
+  std::string value;  // Equal, or the pattern for Contains / Prefix
+  std::string low;    // Range, inclusive, byte-wise order
+  std::string high;   // Range, inclusive, byte-wise order
+  std::vector<std::string> probes;  // text filter terms, set per tree
+
+  static ColumnPredicate equal(std::string v) {
+    ColumnPredicate p;
+    p.value = std::move(v);
+    return p;
+  }
+
+  // Values are compared as raw bytes, not as numbers: "v9" > "v10". Store
+  // numbers fixed-width (zero-padded, big-endian) to range over them.
+  static ColumnPredicate between(std::string lo, std::string hi) {
+    ColumnPredicate p;
+    p.kind = Kind::Range;
+    p.low = std::move(lo);
+    p.high = std::move(hi);
+    return p;
+  }
+
+  static ColumnPredicate contains(std::string pattern) {
+    ColumnPredicate p;
+    p.kind = Kind::Contains;
+    p.value = std::move(pattern);
+    return p;
+  }
+
+  static ColumnPredicate startsWith(std::string prefix) {
+    ColumnPredicate p;
+    p.kind = Kind::Prefix;
+    p.value = std::move(prefix);
+    return p;
+  }
+
+  bool isText() const { return kind == Kind::Contains || kind == Kind::Prefix; }
+
+  // false only if no value under the node can satisfy the predicate
+  bool mayMatch(const Node* node) const {
+    if (kind == Kind::Range) return node->valueRangeOverlaps(low, high);
+    if (isText()) return node->textMayMatch(probes);
+    return node->probe(value);
+  }
+};
+
+// Scan one leaf's key range for keys whose value satisfies the predicate.
+inline std::vector<std::string> scanLeafForPredicate(
+    DBManager& dbManager, const std::string& filename,
+    const ColumnPredicate& pred, const std::string& scanStart,
+    const std::string& scanEnd) {
+  switch (pred.kind) {
+    case ColumnPredicate::Kind::Range:
+      return dbManager.scanFileForKeysInValueRange(filename, pred.low,
+                                                   pred.high, scanStart,
+                                                   scanEnd);
+    case ColumnPredicate::Kind::Contains:
+    case ColumnPredicate::Kind::Prefix:
+      return dbManager.scanFileForKeysMatchingText(
+          filename, pred.value, pred.kind == ColumnPredicate::Kind::Prefix,
+          scanStart, scanEnd);
+    case ColumnPredicate::Kind::Equal:
+      break;
+  }
+  return dbManager.scanFileForKeysWithValue(filename, pred.value, scanStart,
+                                            scanEnd);
+}
+
+inline std::vector<ColumnPredicate> equalityPredicates(
+    const std::vector<std::string>& values) {
+  std::vector<ColumnPredicate> predicates;
+  predicates.reserve(values.size());
+  for (const auto& v : values) predicates.push_back(ColumnPredicate::equal(v));
+  return predicates;
+}
 
 // Combination of nodes
 struct Combo {
@@ -47,13 +130,49 @@ inline void computeIntersection(const std::vector<Node*>& nodes,
   }
 }
 
+// Scans leaf i of a leaf combo, restricted to the combo's key range.
+inline std::vector<std::string> scanComboLeaf(const Combo& combo, size_t i,
+                                              const ColumnPredicate& pred,
+                                              DBManager& dbManager) {
+  Node* leaf = combo.nodes[i];
+  std::string scanStart = std::max(combo.rangeStart, leaf->startKey);
+  std::string scanEnd = std::min(combo.rangeEnd, leaf->endKey);
+  std::vector<std::string> keys =
+      scanLeafForPredicate(dbManager, leaf->filename, pred, scanStart, scanEnd);
+  if (pred.kind == ColumnPredicate::Kind::Equal) {
+    leaf->recordScanResult(!keys.empty(), scanStart == leaf->startKey &&
+                                              scanEnd == leaf->endKey);
+  }
+  return keys;
+}
+
+// Keys present in every set.
+inline std::vector<std::string> intersectKeySets(
+    const std::vector<std::unordered_set<std::string>>& columnKeySets) {
+  if (columnKeySets.empty()) return {};
+
+  std::unordered_set<std::string> result = columnKeySets[0];
+  for (size_t i = 1; i < columnKeySets.size(); ++i) {
+    std::unordered_set<std::string> temp;
+    for (const auto& key : result) {
+      if (columnKeySets[i].find(key) != columnKeySets[i].end()) {
+        temp.insert(key);
+      }
+    }
+    result = std::move(temp);
+    if (result.empty()) break;
+  }
+
+  return std::vector<std::string>(result.begin(), result.end());
+}
+
 inline std::vector<std::string> finalSstScanAndIntersect(
-    const Combo& combo, const std::vector<std::string>& values,
+    const Combo& combo, const std::vector<ColumnPredicate>& predicates,
     DBManager& dbManager) {
   size_t n = combo.nodes.size();
 
   // Increment SSTable check count
-  gSSTCheckCount += n;
+  countSstChecks(n);
 
   std::vector<std::promise<std::unordered_set<std::string>>> promises(n);
   std::vector<std::future<std::unordered_set<std::string>>> futures;
@@ -61,17 +180,18 @@ inline std::vector<std::string> finalSstScanAndIntersect(
 
   for (size_t i = 0; i < n; ++i) {
     futures.push_back(promises[i].get_future());
-    Node* leaf = combo.nodes[i];
-    std::string scanStart = std::max(combo.rangeStart, leaf->startKey);
-    std::string scanEnd = std::min(combo.rangeEnd, leaf->endKey);
+    ++gPoolQueuedTasks;
 
     boost::asio::post(
-        globalThreadPool, [leaf, values, i, scanStart, scanEnd, &dbManager,
+        globalThreadPool, [combo, i, pred = predicates[i], &dbManager,
                            promise = std::move(promises[i])]() mutable {
+          --gPoolQueuedTasks;
+          PerfScope perf(PerfPhase::Scan);
+          MemoryTagScope memoryTag(MemoryTag::QueryScratch);
           try {
-            // Scan the SST file for keys matching the value.
-            std::vector<std::string> keys = dbManager.scanFileForKeysWithValue(
-                leaf->filename, values[i], scanStart, scanEnd);
+            // Scan the SST file for keys matching the predicate.
+            std::vector<std::string> keys =
+                scanComboLeaf(combo, i, pred, dbManager);
             promise.set_value(
                 std::unordered_set<std::string>(keys.begin(), keys.end()));
           } catch (const std::exception& e) {
@@ -87,33 +207,24 @@ inline std::vector<std::string> finalSstScanAndIntersect(
     columnKeySets.push_back(fut.get());
   }
 
-  // Intersect all key sets
-  if (columnKeySets.empty()) return {};
-
-  std::unordered_set<std::string> result = columnKeySets[0];
-  for (size_t i = 1; i < columnKeySets.size(); ++i) {
-    std::unordered_set<std::string> temp;
-    for (const auto& key : result) {
-      if (columnKeySets[i].find(key) != columnKeySets[i].end()) {
-        temp.insert(key);
-      }
-    }
-    result = std::move(temp);
-    if (result.empty()) break;
-  }
-
-  return std::vector<std::string>(result.begin(), result.end());
+  return intersectKeySets(columnKeySets);
 }
 
 // DFS with per‑level range pruning and optional first‑column parallel split
-inline void dfsMultiColumn(const std::vector<std::string>& values,
-                           Combo currentCombo, DBManager& dbManager,
-                           bool isInitialCall) {
+// A leaf combo that survived pruning is handed to onLeafCombo if given,
+// otherwise its SSTs are scanned into globalfinalMatches. An internal combo
+// is not expanded if deferInner returns true for it; it has passed its
+// filters, so dfsMultiColumn(..., false, ...) can pick it up later.
+inline void dfsMultiColumn(
+    const std::vector<ColumnPredicate>& predicates, Combo currentCombo,
+    DBManager& dbManager, bool isInitialCall,
+    const std::function<void(const Combo&)>& onLeafCombo = {},
+    const std::function<bool(const Combo&)>& deferInner = {}) {
                             //check roots
 if (isInitialCall) {
   for (size_t i = 0; i < currentCombo.nodes.size(); ++i) {
-    ++gBloomCheckCount;
-    if (!currentCombo.nodes[i]->bloom.exists(values[i]))
+    countBloomCheck(currentCombo.nodes[i]->filename != "Memory");
+    if (!predicates[i].mayMatch(currentCombo.nodes[i]))
       return;
   }
 }
@@ -130,11 +241,16 @@ if (isInitialCall) {
     }
   }
   if (allLeaves) {
-    auto keys = finalSstScanAndIntersect(currentCombo, values, dbManager);
+    if (onLeafCombo) {
+      onLeafCombo(currentCombo);
+      return;
+    }
+    auto keys = finalSstScanAndIntersect(currentCombo, predicates, dbManager);
     globalfinalMatches.insert(globalfinalMatches.end(), keys.begin(),
                               keys.end());
     return;
   }
+  if (deferInner && deferInner(currentCombo)) return;
 
   // 4) build candidateOptions with progressive range tightening
   size_t n = currentCombo.nodes.size();
@@ -149,9 +265,8 @@ if (isInitialCall) {
 
     auto consider = [&](Node* c) {
       if (c->endKey < tightStart || c->startKey > tightEnd) return;
-      ++gBloomCheckCount;
-      if (c->filename != "Memory") ++gLeafBloomCheckCount;
-      if (!c->bloom.exists(values[i])) return;
+      countBloomCheck(c->filename != "Memory");
+      if (!predicates[i].mayMatch(c)) return;
       candidateOptions[i].push_back(c);
       if (!found) {
         colMin = c->startKey;
@@ -164,7 +279,7 @@ if (isInitialCall) {
     };
 
     if (node->filename == "Memory") {
-      for (auto* ch : node->children) consider(ch);
+      node->forEachOverlappingChild(tightStart, tightEnd, consider);
     } else {
       consider(node);
     }
@@ -186,7 +301,8 @@ if (isInitialCall) {
                   const std::string& curS, const std::string& curE) {
     if (idx == n) {
       Combo next{chosen, curS, curE};
-      dfsMultiColumn(values, next, dbManager, false);
+      dfsMultiColumn(predicates, next, dbManager, false, onLeafCombo,
+                     deferInner);
       return;
     }
     for (auto* cand : candidateOptions[idx]) {
@@ -203,48 +319,370 @@ if (isInitialCall) {
   backtrack(0, chosen, currentCombo.rangeStart, currentCombo.rangeEnd);
 }
 
-// Multi-column hierarchical query interface.
+// Builds the root combo over all trees; false if the key ranges don't meet.
+inline bool makeRootCombo(std::vector<BloomTree>& trees,
+                          const std::string& globalStart,
+                          const std::string& globalEnd, Combo& start) {
+  size_t n = trees.size();
+  start.nodes.resize(n);
+  std::string s = globalStart.empty() ? trees[0].root->startKey : globalStart;
+  std::string e = globalEnd.empty() ? trees[0].root->endKey : globalEnd;
+  for (size_t i = 0; i < n; ++i) {
+    start.nodes[i] = trees[i].root;
+    s = std::max(s, trees[i].root->startKey);
+    e = std::min(e, trees[i].root->endKey);
+  }
+  start.rangeStart = s;
+  start.rangeEnd = e;
+  return s <= e;
+}
+
+// Fills in the text filter probes of substring / prefix predicates.
+inline std::vector<ColumnPredicate> resolvePredicates(
+    const std::vector<BloomTree>& trees,
+    const std::vector<ColumnPredicate>& predicates) {
+  std::vector<ColumnPredicate> resolved = predicates;
+  for (size_t i = 0; i < resolved.size() && i < trees.size(); ++i) {
+    if (trees[i].dictionary) {
+      // codes keep equality only
+      if (resolved[i].kind != ColumnPredicate::Kind::Equal) {
+        throw std::runtime_error(
+            "Only equality predicates are supported on dictionary-encoded "
+            "columns.");
+      }
+      resolved[i].value = trees[i].encodeQueryValue(resolved[i].value);
+    } else if (resolved[i].isText()) {
+      resolved[i].probes = trees[i].textProbes(
+          resolved[i].value,
+          resolved[i].kind == ColumnPredicate::Kind::Prefix);
+    }
+  }
+  return resolved;
+}
+
+// Adds the leaves of a combo that produced keys to each column's hit list.
+inline void addComboHits(const Combo& combo,
+                         std::vector<std::vector<const Node*>>& hitLeaves) {
+  for (size_t i = 0; i < combo.nodes.size(); ++i) {
+    auto& hits = hitLeaves[i];
+    if (std::find(hits.begin(), hits.end(), combo.nodes[i]) == hits.end()) {
+      hits.push_back(combo.nodes[i]);
+    }
+  }
+}
+
+// Per column, the leaves that matched together in one query feed the
+// workload-adaptive restructure.
+inline void recordCoMatches(
+    std::vector<BloomTree>& trees,
+    const std::vector<std::vector<const Node*>>& hitLeaves) {
+  for (size_t i = 0; i < trees.size() && i < hitLeaves.size(); ++i) {
+    trees[i].coMatches->record(hitLeaves[i]);
+  }
+}
+
+// Multi-column hierarchical query interface. Equality predicates are pruned
+// with bloom filters, range predicates with the per-node zone maps and
+// substring / prefix predicates with the text filters.
 inline std::vector<std::string> multiColumnQueryHierarchical(
-    std::vector<BloomTree>& trees, const std::vector<std::string>& values,
+    std::vector<BloomTree>& trees,
+    const std::vector<ColumnPredicate>& predicates,
     const std::string& globalStart, const std::string& globalEnd,
     DBManager& dbManager) {
+  static QueryPlanMetrics planMetrics("multi");
+  QueryMetricsScope queryMetrics(planMetrics);
   StopWatch sw;
   sw.start();
   size_t n = trees.size();
-  if (n == 0 || n != values.size()) {
+  if (n == 0 || n != predicates.size()) {
     std::cerr
         << "Error: Number of trees and values must match and be non-empty.\n";
     sw.stop();
     return {};
   }
 
-  // Reset counters
-  gBloomCheckCount = 0;
-  gLeafBloomCheckCount = 0;
-  gSSTCheckCount = 0;
+  QueryCounters counters;
+  QueryCounterScope countScope(counters);
 
+  std::vector<ColumnPredicate> resolved = resolvePredicates(trees, predicates);
+
+  // matches are collected per call so concurrent queries don't interleave
+  std::vector<std::string> matches;
+  std::vector<std::vector<const Node*>> hitLeaves(n);
   Combo start;
-  start.nodes.resize(n);
-  std::string s = globalStart.empty() ? trees[0].root->startKey : globalStart;
-  std::string e = globalEnd.empty() ? trees[0].root->endKey : globalEnd;
-  for (size_t i = 0; i < n; ++i) {
-    start.nodes[i] = trees[i].root;
-    s = std::max(s, trees[i].root->startKey);
-    e = std::min(e, trees[i].root->endKey);
+  makeRootCombo(trees, globalStart, globalEnd, start);
+  {
+    // this thread only waits while the leaf scans run on the pool
+    PerfScope perf(PerfPhase::Filter);
+    MemoryTagScope memoryTag(MemoryTag::QueryScratch);
+    dfsMultiColumn(resolved, start, dbManager, true, [&](const Combo& combo) {
+      auto keys = finalSstScanAndIntersect(combo, resolved, dbManager);
+      if (!keys.empty()) addComboHits(combo, hitLeaves);
+      MemoryTagScope resultTag(MemoryTag::Results);
+      matches.insert(matches.end(), keys.begin(), keys.end());
+    });
   }
-  start.rangeStart = s;
-  start.rangeEnd = e;
-  globalfinalMatches.clear();
-  dfsMultiColumn(values, start, dbManager, true);
+  recordCoMatches(trees, hitLeaves);
 
   sw.stop();
   spdlog::critical(
       "Multi-column query with SST scan took {} µs, found matching {} keys.",
-      sw.elapsedMicros(), globalfinalMatches.size());
+      sw.elapsedMicros(), matches.size());
   spdlog::info(
       "Bloom filters checked: {} (total), {} (leaves only), SSTables checked: "
       "{}",
-      gBloomCheckCount.load(), gLeafBloomCheckCount.load(),
-      gSSTCheckCount.load());
-  return globalfinalMatches;
+      counters.bloomChecks.load(), counters.leafBloomChecks.load(),
+      counters.sstChecks.load());
+  return matches;
+}
+
+inline std::vector<std::string> multiColumnQueryHierarchical(
+    std::vector<BloomTree>& trees, const std::vector<std::string>& values,
+    const std::string& globalStart, const std::string& globalEnd,
+    DBManager& dbManager) {
+  return multiColumnQueryHierarchical(trees, equalityPredicates(values),
+                                      globalStart, globalEnd, dbManager);
+}
+
+// Answer of a time-bounded query. keys holds what was found before the
+// deadline; the work left over is kept as combos so the caller can resume
+// (resumeMultiColumnQuery) or fall back to another plan. Leaf combos name
+// the SST files still to scan (Combo::nodes[i]->filename); internal combos
+// are subtrees whose filters passed but were not descended.
+struct BoundedQueryResult {
+  std::vector<std::string> keys;
+  std::vector<Combo> unscannedCombos;
+  std::vector<Combo> undescendedCombos;
+  size_t scannedCombos = 0;
+
+  bool complete() const {
+    return unscannedCombos.empty() && undescendedCombos.empty();
+  }
+};
+
+// Runs the leftover combos of result until the deadline, moving whatever
+// is still left back into it. Scans already started run to the end, so a
+// query can overshoot the deadline by about one leaf combo scan.
+inline void continueBoundedQuery(const std::vector<ColumnPredicate>& resolved,
+                                 std::chrono::steady_clock::time_point deadline,
+                                 DBManager& dbManager,
+                                 BoundedQueryResult& result) {
+  auto expired = [&] { return std::chrono::steady_clock::now() >= deadline; };
+  auto onLeafCombo = [&](const Combo& combo) {
+    if (expired()) {
+      result.unscannedCombos.push_back(combo);
+      return;
+    }
+    auto keys = finalSstScanAndIntersect(combo, resolved, dbManager);
+    ++result.scannedCombos;
+    MemoryTagScope resultTag(MemoryTag::Results);
+    result.keys.insert(result.keys.end(), keys.begin(), keys.end());
+  };
+  auto deferInner = [&](const Combo& combo) {
+    if (!expired()) return false;
+    result.undescendedCombos.push_back(combo);
+    return true;
+  };
+
+  // leaf combos first, they are the closest to an answer
+  std::vector<Combo> leafCombos = std::move(result.unscannedCombos);
+  std::vector<Combo> innerCombos = std::move(result.undescendedCombos);
+  result.unscannedCombos.clear();
+  result.undescendedCombos.clear();
+  for (const Combo& combo : leafCombos) onLeafCombo(combo);
+  for (const Combo& combo : innerCombos) {
+    if (deferInner(combo)) continue;
+    dfsMultiColumn(resolved, combo, dbManager, false, onLeafCombo, deferInner);
+  }
+}
+
+// multiColumnQueryHierarchical that stops descending and scanning once
+// budget has passed and returns a partial answer.
+inline BoundedQueryResult multiColumnQueryHierarchicalBounded(
+    std::vector<BloomTree>& trees,
+    const std::vector<ColumnPredicate>& predicates,
+    const std::string& globalStart, const std::string& globalEnd,
+    DBManager& dbManager, std::chrono::microseconds budget) {
+  static QueryPlanMetrics planMetrics("multi_bounded");
+  QueryMetricsScope queryMetrics(planMetrics);
+  auto deadline = std::chrono::steady_clock::now() + budget;
+  BoundedQueryResult result;
+  size_t n = trees.size();
+  if (n == 0 || n != predicates.size()) {
+    std::cerr
+        << "Error: Number of trees and values must match and be non-empty.\n";
+    return result;
+  }
+
+  QueryCounters counters;
+  QueryCounterScope countScope(counters);
+
+  std::vector<ColumnPredicate> resolved = resolvePredicates(trees, predicates);
+  Combo start;
+  if (!makeRootCombo(trees, globalStart, globalEnd, start)) return result;
+  {
+    PerfScope perf(PerfPhase::Filter);
+    MemoryTagScope memoryTag(MemoryTag::QueryScratch);
+    // root filters are checked here, as in the initial dfsMultiColumn call
+    for (size_t i = 0; i < n; ++i) {
+      countBloomCheck(start.nodes[i]->filename != "Memory");
+      if (!resolved[i].mayMatch(start.nodes[i])) return result;
+    }
+    result.undescendedCombos.push_back(start);
+    continueBoundedQuery(resolved, deadline, dbManager, result);
+  }
+
+  if (!result.complete()) {
+    metrics()
+        .counter("hdb_query_deadline_exceeded_total",
+                 "Time-bounded queries that returned a partial answer")
+        .inc();
+    spdlog::warn(
+        "Bounded multi-column query hit its {} µs budget: {} keys from {} "
+        "leaf combos, {} leaf combos unscanned, {} subtrees not descended",
+        budget.count(), result.keys.size(), result.scannedCombos,
+        result.unscannedCombos.size(), result.undescendedCombos.size());
+  }
+  return result;
+}
+
+inline BoundedQueryResult multiColumnQueryHierarchicalBounded(
+    std::vector<BloomTree>& trees, const std::vector<std::string>& values,
+    const std::string& globalStart, const std::string& globalEnd,
+    DBManager& dbManager, std::chrono::microseconds budget) {
+  return multiColumnQueryHierarchicalBounded(trees, equalityPredicates(values),
+                                             globalStart, globalEnd, dbManager,
+                                             budget);
+}
+
+// Continues a partial answer with a new budget; keys found now are appended.
+inline void resumeMultiColumnQuery(
+    std::vector<BloomTree>& trees,
+    const std::vector<ColumnPredicate>& predicates, DBManager& dbManager,
+    std::chrono::microseconds budget, BoundedQueryResult& partial) {
+  static QueryPlanMetrics planMetrics("multi_bounded");
+  QueryMetricsScope queryMetrics(planMetrics);
+  auto deadline = std::chrono::steady_clock::now() + budget;
+  QueryCounters counters;
+  QueryCounterScope countScope(counters);
+  std::vector<ColumnPredicate> resolved = resolvePredicates(trees, predicates);
+  PerfScope perf(PerfPhase::Filter);
+  MemoryTagScope memoryTag(MemoryTag::QueryScratch);
+  continueBoundedQuery(resolved, deadline, dbManager, partial);
+}
+
+// Sketches only overcount, so estimate is a hard upper bound on the number
+// of matching rows. errorBound is the summed sketch overcount of every
+// column (w.p. confidence), so the smallest true per-column count lies in
+// [lowerBound, estimate]. That is the intersection count when the columns
+// match the same rows; otherwise the intersection is lower still.
+struct CountEstimate {
+  size_t estimate = 0;     // upper bound on the number of matching rows
+  size_t lowerBound = 0;   // estimate - errorBound, at least 0
+  size_t errorBound = 0;   // sketch overcount summed over the columns
+  double confidence = 1.0;
+  bool exact = false;      // true if answered by an SST scan
+  size_t leafCombos = 0;   // surviving leaf combos the estimate was built from
+  long long elapsedMicros = 0;
+};
+
+// Estimates how many rows match all values using the per-leaf count-min
+// sketches, without touching any SST. A combo is dropped as soon as one of
+// its leaf sketches reports zero. The per-column sum over distinct
+// surviving leaves bounds the count from above; the smallest such sum is
+// returned. With exactFallback the query is re-run with SST scans whenever
+// a leaf has no sketch or errorBound exceeds maxRelativeError * estimate.
+inline CountEstimate estimateMultiColumnCount(
+    std::vector<BloomTree>& trees, const std::vector<std::string>& values,
+    const std::string& globalStart, const std::string& globalEnd,
+    DBManager& dbManager, bool exactFallback = false,
+    double maxRelativeError = 0.5) {
+  StopWatch sw;
+  sw.start();
+  CountEstimate result;
+  size_t n = trees.size();
+  if (n == 0 || n != values.size()) {
+    std::cerr
+        << "Error: Number of trees and values must match and be non-empty.\n";
+    return result;
+  }
+
+  QueryCounters counters;
+  QueryCounterScope countScope(counters);
+
+  std::vector<ColumnPredicate> predicates = equalityPredicates(values);
+  std::vector<ColumnPredicate> resolved = resolvePredicates(trees, predicates);
+  // per column: distinct surviving leaf -> sketch estimate
+  std::vector<std::unordered_map<const Node*, uint32_t>> leafCounts(n);
+  bool missingSketch = false;
+
+  Combo start;
+  if (makeRootCombo(trees, globalStart, globalEnd, start)) {
+    dfsMultiColumn(resolved, start, dbManager, true,
+                   [&](const Combo& combo) {
+                     std::vector<uint32_t> counts(n, 0);
+                     for (size_t i = 0; i < n; ++i) {
+                       const Node* leaf = combo.nodes[i];
+                       if (!leaf->sketch) {
+                         missingSketch = true;
+                         return;
+                       }
+                       counts[i] = leaf->sketch->estimate(resolved[i].value);
+                       if (counts[i] == 0) return;
+                     }
+                     ++result.leafCombos;
+                     for (size_t i = 0; i < n; ++i) {
+                       leafCounts[i].emplace(combo.nodes[i], counts[i]);
+                     }
+                   });
+  }
+
+  if (result.leafCombos > 0) {
+    // any column's overcount can decide the minimum, so their errors add
+    size_t best = std::numeric_limits<size_t>::max();
+    double slack = 0.0;
+    double confidence = 1.0;
+    for (size_t i = 0; i < n; ++i) {
+      size_t sum = 0;
+      for (const auto& [leaf, count] : leafCounts[i]) {
+        sum += count;
+        slack += leaf->sketch->epsilon() *
+                 static_cast<double>(leaf->sketch->totalCount);
+        confidence *= 1.0 - leaf->sketch->delta();
+      }
+      best = std::min(best, sum);
+    }
+    result.estimate = best;
+    result.errorBound = static_cast<size_t>(std::ceil(slack));
+    result.confidence = confidence;
+    if (result.errorBound < best) {
+      result.lowerBound = best - result.errorBound;
+    }
+  }
+
+  bool tooLoose = result.estimate > 0 &&
+                  result.errorBound > maxRelativeError * result.estimate;
+  if (exactFallback && (missingSketch || tooLoose)) {
+    auto keys = multiColumnQueryHierarchical(trees, predicates, globalStart,
+                                             globalEnd, dbManager);
+    result.estimate = keys.size();
+    result.lowerBound = keys.size();
+    result.errorBound = 0;
+    result.confidence = 1.0;
+    result.exact = true;
+  } else if (missingSketch) {
+    spdlog::warn(
+        "Count estimate: some leaves have no count-min sketch, estimate "
+        "ignores them.");
+  }
+
+  sw.stop();
+  result.elapsedMicros = sw.elapsedMicros();
+  spdlog::info(
+      "Count estimate {} (at least {}, confidence {:.3f}, {}) from {} leaf "
+      "combos in {} µs.",
+      result.estimate, result.lowerBound, result.confidence,
+      result.exact ? "exact" : "sketch", result.leafCombos,
+      result.elapsedMicros);
+  return result;
 }
@@ -0,0 +1,115 @@
+#pragma once
+
+// Boost 1.74's awaitable.hpp uses std::exchange without including <utility>
+#include <utility>
+
+#include <atomic>
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/thread_pool.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "algorithm.hpp"
+#include "bloomTree.hpp"
+#include "db_manager.hpp"
+#include "metrics.hpp"
+
+extern boost::asio::thread_pool globalThreadPool;
+
+// Runs every task on globalThreadPool at once and resumes the awaiting
+// coroutine on its own executor when the last one is done, results in task
+// order. The first exception thrown by a task is rethrown at the co_await.
+// Nothing blocks while the tasks run, so an event loop with a few threads
+// can keep many of these in flight.
+template <typename R>
+boost::asio::awaitable<std::vector<R>> onPoolAll(
+    std::vector<std::function<R()>> tasks) {
+  return boost::asio::async_initiate<const boost::asio::use_awaitable_t<>&,
+                                     void(std::exception_ptr, std::vector<R>)>(
+      [](auto handler, std::vector<std::function<R()>> tasks) {
+        using Handler = decltype(handler);
+        struct State {
+          std::vector<R> results;
+          std::exception_ptr error;
+          std::atomic<size_t> pending{0};
+          std::mutex mtx;
+          std::optional<Handler> handler;
+        };
+        auto state = std::make_shared<State>();
+        state->results.resize(tasks.size());
+        state->pending = tasks.size();
+        state->handler.emplace(std::move(handler));
+
+        auto complete = [state]() {
+          auto executor = boost::asio::get_associated_executor(*state->handler);
+          boost::asio::post(executor, [state]() {
+            std::move (*state->handler)(state->error, std::move(state->results));
+          });
+        };
+        if (tasks.empty()) {
+          complete();
+          return;
+        }
+        for (size_t i = 0; i < tasks.size(); ++i) {
+          ++gPoolQueuedTasks;
+          boost::asio::post(globalThreadPool, [state, complete, i,
+                                               task = std::move(tasks[i])]() {
+            --gPoolQueuedTasks;
+            try {
+              state->results[i] = task();
+            } catch (...) {
+              std::lock_guard<std::mutex> lock(state->mtx);
+              if (!state->error) state->error = std::current_exception();
+            }
+            if (--state->pending == 0) complete();
+          });
+        }
+      },
+      boost::asio::use_awaitable, std::move(tasks));
+}
+
+// One task on the pool.
+template <typename R>
+boost::asio::awaitable<R> onPool(std::function<R()> task) {
+  std::vector<std::function<R()>> tasks;
+  tasks.push_back(std::move(task));
+  std::vector<R> results = co_await onPoolAll<R>(std::move(tasks));
+  co_return std::move(results.front());
+}
+
+// Awaitable counterparts of multiColumnQueryHierarchical,
+// DBManager::findUsingSingleHierarchy and DBManager::findRecordInHierarchy,
+// for callers running coroutines (boost::asio::co_spawn) on their own
+// executor. Filter traversal, SST scans and verification run on
+// globalThreadPool; the caller's thread is free while they do. trees,
+// hierarchy and dbManager must outlive the coroutine.
+//
+// The global Bloom / SST check counters are not reset: with many queries in
+// flight they would only mix up each other's numbers.
+boost::asio::awaitable<std::vector<std::string>>
+multiColumnQueryHierarchicalAsync(std::vector<BloomTree>& trees,
+                                  std::vector<ColumnPredicate> predicates,
+                                  std::string globalStart, std::string globalEnd,
+                                  DBManager& dbManager);
+
+boost::asio::awaitable<std::vector<std::string>>
+multiColumnQueryHierarchicalAsync(std::vector<BloomTree>& trees,
+                                  const std::vector<std::string>& values,
+                                  std::string globalStart, std::string globalEnd,
+                                  DBManager& dbManager);
+
+boost::asio::awaitable<std::vector<std::string>> findUsingSingleHierarchyAsync(
+    DBManager& dbManager, BloomTree& hierarchy,
+    std::vector<std::string> columns, std::vector<std::string> values);
+
+boost::asio::awaitable<bool> findRecordInHierarchyAsync(
+    DBManager& dbManager, BloomTree& hierarchy, std::string value,
+    std::string startKey = "", std::string endKey = "");
@@ -1,27 +1,111 @@
 #ifndef BLOOM_MANAGER_HPP
 #define BLOOM_MANAGER_HPP
 
+#include <future>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include <boost/asio/thread_pool.hpp>
 
 #include "bloomTree.hpp"
 
 extern boost::asio::thread_pool globalThreadPool;
+// number of threads globalThreadPool was started with
+extern const size_t globalThreadPoolSize;
 
 class BloomManager {
    public:
+    // Files are split into enough ranges to keep buildThreads threads busy.
+    // 0 builds on globalThreadPool; otherwise on a pool of buildThreads
+    // threads started for this build.
     BloomTree createPartitionedHierarchy(const std::vector<std::string>& sstFiles,
                                          size_t partitionSize,
                                          size_t bloomSize,
                                          int numHashFunctions,
-                                         int branchingRatio);
+                                         int branchingRatio,
+                                         TextFilterMode textMode = TextFilterMode::None,
+                                         size_t gramSize = 3,
+                                         size_t sketchWidth = 0,
+                                         int sketchDepth = 4,
+                                         double foldTargetFpr = 0.0,
+                                         FilterKind filterKind = FilterKind::Bloom,
+                                         size_t buildThreads = 0);
+
+    // One subtree per LSM level (L0..L(hotLevels-1) share the small, often
+    // rebuilt one), joined under a thin top. sstFilesByLevel[i] lists the
+    // files of level i, as returned by DBManager::scanSSTFilesByLevel.
+    BloomTree createLevelAwareHierarchy(const std::vector<std::vector<std::string>>& sstFilesByLevel,
+                                        size_t partitionSize,
+                                        size_t bloomSize,
+                                        int numHashFunctions,
+                                        int branchingRatio,
+                                        int hotLevels = 2,
+                                        TextFilterMode textMode = TextFilterMode::None,
+                                        size_t gramSize = 3,
+                                        size_t sketchWidth = 0,
+                                        int sketchDepth = 4,
+                                        double foldTargetFpr = 0.0,
+                                        FilterKind filterKind = FilterKind::Bloom);
+
+    // Brings a level-aware hierarchy up to date after flushes/compactions.
+    // Only new SST files are read and only changed level groups are rebuilt.
+    void refreshLevelAwareHierarchy(BloomTree& hierarchy,
+                                    const std::vector<std::vector<std::string>>& sstFilesByLevel,
+                                    size_t partitionSize,
+                                    int hotLevels = 2,
+                                    size_t sketchWidth = 0,
+                                    int sketchDepth = 4);
+
+    // Plans workload-adaptive internal levels on globalThreadPool while the
+    // tree keeps serving queries. Apply with hierarchy.installRestructure
+    // once no query is running.
+    std::future<BloomTree::Restructure> restructureHierarchyAsync(const BloomTree& hierarchy);
+
+    // Threshold trigger for a query loop, called between queries: once
+    // minQueries co-matching queries were recorded since the last
+    // restructure, plans one; a finished plan is installed. Pass the tree
+    // the queries copy from, since installing replaces its root. Returns
+    // true if a plan was installed.
+    bool maybeRestructure(BloomTree& hierarchy, uint64_t minQueries = 1000);
+    // Waits for a plan still running for hierarchy and installs it.
+    bool finishRestructure(BloomTree& hierarchy);
+    // plans read the leaf filters, which must not be replaced meanwhile
+    bool restructurePending() const { return !pendingRestructures.empty(); }
 
    private:
-    std::vector<Node*> processSSTFile(const std::string& sstFile,
-                                      size_t partitionSize,
-                                      size_t bloomSize,
-                                      int numHashFunctions);
+    std::unordered_map<const BloomTree*, std::future<BloomTree::Restructure>> pendingRestructures;
+
+    std::vector<std::vector<Node*>> processSSTFiles(const std::vector<std::string>& sstFiles,
+                                                    size_t partitionSize,
+                                                    size_t bloomSize,
+                                                    int numHashFunctions,
+                                                    TextFilterMode textMode,
+                                                    size_t gramSize,
+                                                    size_t sketchWidth,
+                                                    int sketchDepth,
+                                                    FilterKind filterKind,
+                                                    size_t buildThreads = 0);
+
+    // Start keys of the ranges sstFile is read in ("" = file start), from
+    // the boundary samples in its table properties; a single range if it
+    // has none.
+    std::vector<std::string> splitSSTFile(const std::string& sstFile,
+                                          size_t partitionSize,
+                                          size_t maxRanges);
+
+    // Leaves of the keys in [startKey, endKey) of sstFile; empty endKey
+    // reads to the end of the file.
+    std::vector<Node*> processSSTRange(const std::string& sstFile,
+                                       const std::string& startKey,
+                                       const std::string& endKey,
+                                       size_t partitionSize,
+                                       size_t bloomSize,
+                                       int numHashFunctions,
+                                       TextFilterMode textMode,
+                                       size_t gramSize,
+                                       size_t sketchWidth,
+                                       int sketchDepth,
+                                       FilterKind filterKind);
 };
 
 #endif  // BLOOM_MANAGER_HPP
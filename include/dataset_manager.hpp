@@ -0,0 +1,73 @@
+#ifndef DATASET_MANAGER_HPP
+#define DATASET_MANAGER_HPP
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "bloomTree.hpp"
+#include "bloom_manager.hpp"
+#include "db_manager.hpp"
+#include "test_params.hpp"
+
+// Copy-on-write view of the base dataset for one trial: a checkpoint of the
+// base DB (hard-linked SSTs) plus hierarchies over the clone's files.
+struct DatasetClone {
+  std::string path;
+  DBManager db;
+  std::map<std::string, BloomTree> hierarchies;
+};
+
+// How a clone's modifications reach its SSTs. Flushed writes them into new
+// L0 files and reuses the base leaves for everything else; Compacted fully
+// compacts the clone and builds flat partitioned hierarchies from scratch,
+// the same layout as applyModifications + buildHierarchies on the base.
+enum class CloneLayout { Flushed, Compacted };
+
+// Keeps the base DB open and hands out modified clones of it instead of
+// modifying and compacting the base. The base's level-aware hierarchies are
+// built once, on first use: Compacted clones never need them.
+class DatasetManager {
+ public:
+  DatasetManager(const TestParams &params, std::vector<std::string> columns,
+                 int hotLevels = 2);
+  ~DatasetManager();
+
+  void open();
+  void close();
+  DBManager &baseDB() { return base_; }
+  const std::map<std::string, BloomTree> &baseHierarchies() {
+    buildBaseHierarchies();
+    return baseHierarchies_;
+  }
+
+  // Checkpoints the base and writes the (key, column, value) modifications
+  // into the clone. With CloneLayout::Flushed the clone's hierarchies share
+  // the base leaves of the SSTs they have in common; only the newly flushed
+  // files are read.
+  std::unique_ptr<DatasetClone> createClone(
+      const std::vector<std::tuple<std::string, std::string, std::string>>
+          &modifications,
+      CloneLayout layout = CloneLayout::Flushed);
+  // closes the clone and deletes its directory
+  void releaseClone(std::unique_ptr<DatasetClone> clone);
+
+ private:
+  // no-op once built
+  void buildBaseHierarchies();
+  BloomTree shareHierarchy(const BloomTree &base,
+                           const std::string &clonePath) const;
+
+  TestParams params_;
+  std::vector<std::string> columns_;
+  int hotLevels_;
+  DBManager base_;
+  BloomManager bloomManager_;
+  std::map<std::string, BloomTree> baseHierarchies_;
+  size_t nextCloneId_ = 0;
+};
+
+#endif  // DATASET_MANAGER_HPP
@@ -4,27 +4,151 @@
 #include <rocksdb/db.h>
 #include <rocksdb/sst_file_manager.h>
 #include <rocksdb/sst_file_reader.h>
+#include <rocksdb/write_batch.h>
 
+#include <atomic>
+#include <cstdint>
+#include <functional>
 #include <map>
 #include <memory>
+#include <set>
+#include <shared_mutex>
 #include <string>
 #include <unordered_set>
 #include <vector>
 
 #include "bloomTree.hpp"
+#include "value_dictionary.hpp"
+
+class Counter;
+
+// SST readers opened by the scan paths and the time spent opening them, the
+// hdb_sst_reader_opens_total / hdb_sst_reader_open_micros_total series
+Counter& sstReaderOpens();
+Counter& sstReaderOpenMicros();
+
+// The defaults compact like a plain CompactRange, one column family after
+// another; parallel() is the tuned setup.
+struct CompactionSettings {
+  // column families compacted at once, 0 = all of them
+  size_t parallelism = 1;
+  // per CompactRange call, 0 = use the DB-wide max_subcompactions
+  uint32_t maxSubcompactions = 0;
+  bool exclusiveManualCompaction = true;
+  rocksdb::BottommostLevelCompaction bottommostLevelCompaction =
+      rocksdb::BottommostLevelCompaction::kIfHaveCompactionFilter;
+  // applied with SetOptions while compacting, 0 keeps the CF setting
+  uint64_t targetFileSizeBase = 0;
+  // max_background_jobs while compacting, 0 keeps the DB setting
+  int backgroundJobs = 0;
+
+  // all column families at once, with enough background jobs to run them
+  static CompactionSettings parallel();
+};
+
+struct CompactionProgress {
+  std::string column;
+  size_t completed;  // column families finished so far
+  size_t total;
+  bool ok;
+  long long elapsedMicros;  // for this column family
+  uint64_t bytesBefore;
+  uint64_t bytesAfter;
+  double mbPerSec;  // bytesBefore / elapsed, both taken after the flush
+};
+
+// Write-path pressure summed over the column families
+struct WriteStallStats {
+  bool writeStopped = false;
+  uint64_t delayedWriteRate = 0;  // bytes/s, 0 = not throttled
+  uint64_t pendingCompactionBytes = 0;
+  uint64_t runningCompactions = 0;
+  uint64_t runningFlushes = 0;
+  uint64_t immutableMemtables = 0;
+  uint64_t level0Files = 0;
+};
+
+// RocksDB-owned memory summed over the column families
+struct RocksDBMemoryStats {
+  uint64_t blockCacheBytes = 0;
+  uint64_t tableReaderBytes = 0;  // index / filter blocks outside the cache
+  uint64_t memtableBytes = 0;
+};
+
+// Size and write cost of the secondary indexes. Bytes written count keys and
+// values put since the DB was opened, backfills included.
+struct SecondaryIndexStats {
+  uint64_t indexBytes = 0;  // SST files and memtables of the index CF
+  uint64_t valueBytesWritten = 0;
+  uint64_t indexBytesWritten = 0;
+  double writeAmplification() const {
+    return valueBytesWritten == 0
+               ? 0.0
+               : static_cast<double>(valueBytesWritten + indexBytesWritten) /
+                     valueBytesWritten;
+  }
+};
+
+using CompactionProgressCallback =
+    std::function<void(const CompactionProgress &)>;
 
 class DBManager {
  public:
-  void compactAllColumnFamilies(size_t numRecords = 0);
+  // Flushes and compacts every column family, settings.parallelism at a
+  // time. progress is called (serialized) once per finished column family.
+  // Options changed for the compaction are restored afterwards.
+  void compactAllColumnFamilies(
+      size_t numRecords = 0, const CompactionSettings &settings = {},
+      const CompactionProgressCallback &progress = {});
   void openDB(const std::string &dbname,
               std::vector<std::string> columns = {"phone", "mail", "address"});
-  void insertRecords(int numRecords, std::vector<std::string> columns);
+  // cardinality > 0 cycles through that many distinct values per column
+  void insertRecords(int numRecords, std::vector<std::string> columns,
+                     size_t cardinality = 0);
   void insertRecordsWithSearchTargets(
       int numRecords, const std::vector<std::string> &columns,
       const std::unordered_set<int> &targetIndices);
   std::vector<std::string> scanSSTFilesForColumn(const std::string &dbname,
                                                  const std::string &column);
+  // SST files of a column grouped by LSM level, index = level
+  std::vector<std::vector<std::string>> scanSSTFilesByLevel(
+      const std::string &dbname, const std::string &column);
   bool isOpen() const { return static_cast<bool>(db_); }
+
+  // Side column family holding the value dictionaries, always opened.
+  static inline const std::string kDictionaryColumn = "__dictionary";
+  // Values written to column from now on are stored as dictionary codes.
+  // Enable before the first insert (throws if the column holds values);
+  // the choice is persisted with the DB.
+  void enableDictionaryEncoding(const std::string &column);
+  // nullptr if the column is not encoded
+  std::shared_ptr<ValueDictionary> columnDictionary(
+      const std::string &column) const;
+  // query value -> stored form, once per query; values never written map
+  // to a code that matches nothing
+  std::string queryValue(const std::string &column,
+                         const std::string &value) const;
+  std::vector<std::string> queryValues(
+      const std::vector<std::string> &columns,
+      const std::vector<std::string> &values) const;
+
+  // Exact value -> key index in a side column family, always opened.
+  static inline const std::string kIndexColumn = "__index";
+  // Indexes the records already in column and keeps the index current on
+  // every later write. Persisted with the DB.
+  void enableSecondaryIndex(const std::string &column);
+  bool hasSecondaryIndex(const std::string &column) const;
+  // keys holding value in column, in key order; postings are checked
+  // against the column, so stale index entries never show up
+  std::vector<std::string> indexLookup(const std::string &column,
+                                       const std::string &value);
+  // Keys matching every column: posting lists of the indexed columns are
+  // merge-intersected, then every column, indexed ones included, is checked
+  // per remaining key. At least one column must be indexed.
+  std::vector<std::string> findUsingSecondaryIndex(
+      const std::vector<std::string> &columns,
+      const std::vector<std::string> &values);
+  SecondaryIndexStats secondaryIndexStats();
   rocksdb::Status closeDB();
 
   std::string getValue(const std::string &column_family_name,
@@ -32,6 +156,20 @@ class DBManager {
   rocksdb::ColumnFamilyHandle *getColumnFamilyHandle(
       const std::string &column_family_name);
 
+  // writes the (key, column, value) triples in one batch, no compaction
+  rocksdb::Status writeModifications(
+      const std::vector<std::tuple<std::string, std::string, std::string>>
+          &modifications);
+  void flushAllColumnFamilies(bool wait = true);
+  // hard-link snapshot of the open DB in checkpointDir (must not exist)
+  rocksdb::Status createCheckpoint(const std::string &checkpointDir);
+  // While disabled, compaction leaves obsolete SST files on disk, so
+  // hierarchy leaves over them stay scannable; enabling deletes them.
+  rocksdb::Status disableFileDeletions();
+  rocksdb::Status enableFileDeletions();
+  WriteStallStats getWriteStallStats();
+  RocksDBMemoryStats getRocksDBMemoryStats();
+
   rocksdb::Status applyModifications(
       const std::vector<std::tuple<std::string, std::string, std::string>>
           &modifications,
@@ -58,21 +196,106 @@ class DBManager {
   std::vector<std::string> scanFileForKeysWithValue(
       const std::string &filename, const std::string &value,
       const std::string &rangeStart, const std::string &rangeEnd);
-  // query hierarchy for one column and then get from DB
+  // scan given SST file for keys whose value lies in [low, high]
+  std::vector<std::string> scanFileForKeysInValueRange(
+      const std::string &filename, const std::string &low,
+      const std::string &high, const std::string &rangeStart,
+      const std::string &rangeEnd);
+  // scan given SST file for keys whose value contains (or starts with) pattern
+  std::vector<std::string> scanFileForKeysMatchingText(
+      const std::string &filename, const std::string &pattern,
+      bool prefixOnly, const std::string &rangeStart,
+      const std::string &rangeEnd);
+  // substring / prefix predicate on one column, leaves pruned with the
+  // hierarchy's text filters
+  std::vector<std::string> findKeysMatchingText(BloomTree &hierarchy,
+                                                const std::string &pattern,
+                                                bool prefixOnly,
+                                                const std::string &startKey = "",
+                                                const std::string &endKey = "");
+  // range predicate on one column, leaves pruned with zone maps; low/high
+  // compare byte-wise ("_value9" > "_value10")
+  std::vector<std::string> findKeysInValueRange(BloomTree &hierarchy,
+                                                const std::string &low,
+                                                const std::string &high,
+                                                const std::string &startKey = "",
+                                                const std::string &endKey = "");
+  // query hierarchy for one column and then get from DB; an empty
+  // startKey/endKey leaves that side of the key range open
   std::vector<std::string> findUsingSingleHierarchy(
       BloomTree &hierarchy, const std::vector<std::string> &columns,
-      const std::vector<std::string> &values);
+      const std::vector<std::string> &values, const std::string &startKey = "",
+      const std::string &endKey = "");
+  // true if key holds values[i] in columns[i] for every i >= firstColumn;
+  // values are in stored form (see queryValues). columns[0] is usually
+  // verified already by the scan that found the key.
+  bool keyMatchesColumns(const std::string &key,
+                         const std::vector<std::string> &columns,
+                         const std::vector<std::string> &values,
+                         size_t firstColumn = 1);
 
  private:
+  bool compactColumnFamily(const std::string &column,
+                           rocksdb::ColumnFamilyHandle *handle,
+                           size_t numRecords,
+                           const CompactionSettings &settings);
+  bool compactRange(const std::string &column,
+                    rocksdb::ColumnFamilyHandle *handle, size_t numRecords,
+                    const CompactionSettings &settings);
+
+  using PartitionScanFn = std::function<std::vector<std::string>(
+      const std::string &filename, const std::string &scanStart,
+      const std::string &scanEnd)>;
+  // scan candidate leaves in parallel on globalThreadPool
+  std::vector<std::string> scanCandidatePartitions(
+      const std::vector<const Node *> &candidates, const std::string &startKey,
+      const std::string &endKey, const PartitionScanFn &scan);
+
   struct RocksDBDeleter {
     void operator()(rocksdb::DB *dbPtr) const {
       delete dbPtr;  // Safe to call delete on a nullptr
     }
   };
 
+  // A write batch and the dictionary codes it stores for the first time.
+  // writeBatch publishes those codes only once the batch is written, so a
+  // failed write leaves no code that points at nothing.
+  struct StagedBatch {
+    rocksdb::WriteBatch batch;
+    std::set<std::pair<ValueDictionary *, std::string>> newCodes;
+  };
+  // writes staged.batch, then publishes its codes and clears it
+  rocksdb::Status writeBatch(
+      StagedBatch &staged,
+      const rocksdb::WriteOptions &options = rocksdb::WriteOptions());
+
+  // value as written to column: its dictionary code if the column is
+  // encoded, with a new dictionary entry added to the batch
+  std::string storedValue(const std::string &column, const std::string &value,
+                          StagedBatch &staged);
+  void loadDictionaries();
+  // puts value under key in column, along with its dictionary and index
+  // entries; mayExist also removes the index entry of the value it replaces.
+  // That value is read before the batch is written, so two writes of one
+  // key in a batch, or from two threads at once, can leave a stale entry;
+  // so can overwriting with mayExist false. Index readers verify postings
+  // against the column, so a stale entry costs a lookup, not a wrong key.
+  void putColumnValue(const std::string &column, const std::string &key,
+                      const std::string &value, StagedBatch &staged,
+                      bool mayExist);
+  std::vector<std::string> indexPostings(const std::string &column,
+                                         const std::string &stored);
+  void loadIndexedColumns();
+
   std::unique_ptr<rocksdb::DB, RocksDBDeleter> db_{nullptr};
   std::unordered_map<std::string, std::unique_ptr<rocksdb::ColumnFamilyHandle>>
       cf_handles_;
+  std::map<std::string, std::shared_ptr<ValueDictionary>> dictionaries_;
+  // shared for the per-write and per-query checks, unique to change
+  mutable std::shared_mutex indexedColumnsMtx_;
+  std::set<std::string> indexedColumns_;
+  std::atomic<uint64_t> valueBytesWritten_{0};
+  std::atomic<uint64_t> indexBytesWritten_{0};
 };
 
 #endif  // DB_MANAGER_HPP
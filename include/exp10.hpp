@@ -0,0 +1,6 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+void runExp10(const std::string& dbPath, size_t dbSize, bool skipDbScan);
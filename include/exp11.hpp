@@ -0,0 +1,8 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// queryBudgetMicros > 0 runs time-bounded queries with that budget
+void runExp11(const std::string& dbPath, size_t dbSize, bool skipDbScan,
+              long long queryBudgetMicros = 0);
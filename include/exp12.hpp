@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Replays a captured query log (see query_log.hpp) against each candidate
+// hierarchy configuration. timed = keep the recorded inter-arrival gaps,
+// otherwise queries are issued back to back. The log is replayed in
+// passes; leaf rebuilds and restructures are applied between them, so
+// every query of a pass runs against the same trees.
+void runExp12(const std::string& dbPath, size_t dbSize,
+              const std::string& queryLogPath, bool timed);
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Same records written plainly and with dictionary-encoded columns, for a
+// few value cardinalities: SST bytes, ingest and build time, filter memory,
+// hierarchical query and full scan time. Databases are <baseDir>/exp13_*.
+void runExp13(const std::string& baseDir, size_t dbSize);
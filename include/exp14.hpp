@@ -0,0 +1,10 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Full scan, Bloom hierarchy and exact secondary index on the same data,
+// one row per engine in one CSV schema: structure size, build time, write
+// cost, query latency for present and absent values. cardinality 0 = every
+// value unique. Databases are <baseDir>/exp14_*.
+void runExp14(const std::string& baseDir, size_t dbSize);
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Non-equality predicates on the shared database: value ranges pruned with
+// the zone maps, alone and combined with an equality predicate on another
+// column, and substring / prefix patterns pruned with the mail column's
+// n-gram filter. Writes csv/exp_15_predicates.csv, and the leaf sketches'
+// count estimates against the exact counts to csv/exp_15_count_estimates.csv.
+void runExp15(const std::string& dbPath, size_t dbSize);
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// asyncClients also sweeps in-flight coroutine queries (csv/exp_9_async.csv)
+void runExp9(const std::string& dbPath, size_t dbSize, bool skipDbScan,
+             bool asyncClients = false);
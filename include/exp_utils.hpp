@@ -1,10 +1,14 @@
 #pragma once
 
+#include <atomic>
 #include <future>
 #include <map>
+#include <mutex>
+#include <thread>
 #include <string>
 #include <vector>
 
+#include "perf_counters.hpp"
 #include "test_params.hpp"
 
 // Forward declarations
@@ -157,15 +161,23 @@ struct AggregatedQueryTimings {
   TimingStatistics singleCol_nonLeafBloomChecksPerColumnStats;
   
   size_t numColumns;  // Number of columns for reference
+
+  // hardware counters summed over the runs (--perf-counters)
+  PhasePerfCounts multiPerf{};
+  PhasePerfCounts singlePerf{};
+  bool perfMultiplexed = false;
+  int runs = 0;
 };
 
 std::map<std::string, std::vector<std::string>> scanSstFilesAsync(
     const std::vector<std::string>& columns, DBManager& dbManager,
     const TestParams& params);
 
+// dbManager, if given, supplies the dictionaries of encoded columns
 std::map<std::string, BloomTree> buildHierarchies(
     const std::map<std::string, std::vector<std::string>>& columnSstFiles,
-    BloomManager& bloomManager, const TestParams& params);
+    BloomManager& bloomManager, const TestParams& params,
+    const DBManager* dbManager = nullptr);
 
 AggregatedQueryTimings runStandardQueries(
     DBManager& dbManager, const std::map<std::string, BloomTree>& hierarchies,
@@ -204,6 +216,55 @@ std::vector<AccumulatedQueryMetrics> runComprehensiveQueryAnalysis(
 
 void writeCsvHeader(const std::string& filename, const std::string& headerLine);
 
+struct LatencyPercentiles {
+  long long p50 = 0;
+  long long p95 = 0;
+  long long p99 = 0;
+  long long max = 0;
+  double average = 0.0;
+};
+
+LatencyPercentiles calculateLatencyPercentiles(std::vector<long long> values);
+
+// Measures queueing in globalThreadPool while a benchmark runs: every
+// interval it posts an empty task and records how long it waited to start,
+// and times a burst of read-modify-writes on gBloomCheckCount to expose
+// cache-line contention on the shared counters.
+class PoolDelayProbe {
+ public:
+  explicit PoolDelayProbe(std::chrono::milliseconds interval =
+                              std::chrono::milliseconds(5));
+  ~PoolDelayProbe();
+  void stop();
+
+  LatencyPercentiles poolDelayMicros() const;
+  double atomicNanosPerOp() const;
+
+ private:
+  std::chrono::milliseconds interval;
+  std::atomic<bool> running{true};
+  std::thread sampler;
+  mutable std::mutex mtx;
+  std::vector<long long> delays;
+  std::vector<double> atomicSamples;
+};
+
+// Memory accounting rows, one per tag plus the RocksDB-owned memory, after
+// the experiment's own columns (prefixColumns / prefixValues).
+void writeMemoryCsvHeader(const std::string& filename,
+                          const std::string& prefixColumns);
+void appendMemoryCsvRows(const std::string& filename,
+                         const std::string& prefixValues, DBManager& dbManager);
+
+// Hardware counter rows, one per phase, averaged over queries, after the
+// experiment's own columns and the query path.
+void writePerfCsvHeader(const std::string& filename,
+                        const std::string& prefixColumns);
+void appendPerfCsvRows(const std::string& filename,
+                       const std::string& prefixValues, const std::string& path,
+                       const PhasePerfCounts& counts, size_t queries,
+                       bool multiplexed);
+
 double getProbabilityOfFalsePositive(size_t bloomSize, int numHashFunctions,
                                      size_t itemsPerPartition);
 
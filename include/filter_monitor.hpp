@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <future>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "bloomTree.hpp"
+#include "node.hpp"
+
+struct LeafFilterStats {
+  const Node* leaf;
+  uint64_t probes;
+  uint64_t passes;
+  uint64_t scans;       // passes whose scan covered the whole leaf or hit
+  uint64_t hits;
+  // false positives over known negatives: (scans - hits) /
+  // (probes - passes + scans - hits); passes never scanned are left out
+  double observedFpr;
+  double predictedFpr;  // from size, hash count and item count
+  bool overBudget;
+};
+
+struct LevelFilterStats {
+  size_t depth;  // 0 = root
+  size_t nodes;
+  uint64_t probes;
+  uint64_t passes;
+  uint64_t hits;           // leaves only
+  double passRate;         // passes / probes
+  double observedFpr;      // leaves only, -1 for internal levels
+  double avgPredictedFpr;  // from the fill ratio of the level's filters
+};
+
+struct LeafRebuild {
+  Node* leaf;
+  BloomFilter bloom;
+};
+
+// Compares the false-positive rate each leaf shows under real queries
+// (filter passes whose SST scan found nothing) with the rate its size
+// predicts, and rebuilds leaves that stay over budget with larger filters.
+class FilterMonitor {
+ public:
+  FilterMonitor(double tolerance = 2.0, uint64_t minNegativeProbes = 100,
+                int strikesToRebuild = 3, uint64_t evaluateEvery = 1000)
+      : tolerance(tolerance),
+        minNegativeProbes(minNegativeProbes),
+        strikesToRebuild(strikesToRebuild),
+        evaluateEvery(evaluateEvery) {}
+
+  std::vector<LeafFilterStats> leafStats(const BloomTree& tree) const;
+  std::vector<LevelFilterStats> levelStats(const BloomTree& tree) const;
+
+  // One evaluation round: leaves over budget get a strike, others are
+  // cleared. Returns the leaves with strikesToRebuild consecutive strikes.
+  std::vector<Node*> evaluate(const BloomTree& tree);
+
+  // Re-reads each leaf's key range and builds a filter growthFactor times
+  // larger on globalThreadPool. Install the result with installRebuilds
+  // while the tree is not being queried.
+  std::future<std::vector<LeafRebuild>> scheduleRebuild(
+      std::vector<Node*> leaves, size_t growthFactor = 2);
+  size_t installRebuilds(std::vector<LeafRebuild>&& rebuilds);
+
+  // Rebuild trigger for a query loop, called between queries with the
+  // trees just queried: installs finished rebuilds and, every
+  // evaluateEvery calls, evaluates the trees and starts rebuilds of the
+  // leaves due. Returns the number of leaves installed.
+  size_t afterQuery(const std::vector<BloomTree>& trees);
+  // Waits for and installs every rebuild still running.
+  size_t finishRebuilds();
+  size_t installedRebuilds() const { return installedTotal; }
+
+  void writeLeafStatsCsv(const std::string& filename,
+                         const std::string& column,
+                         const BloomTree& tree) const;
+  void writeLevelStatsCsv(const std::string& filename,
+                          const std::string& column,
+                          const BloomTree& tree) const;
+
+ private:
+  double tolerance;
+  uint64_t minNegativeProbes;
+  int strikesToRebuild;
+  uint64_t evaluateEvery;
+  uint64_t queriesSinceEvaluation = 0;
+  size_t installedTotal = 0;
+  std::unordered_map<const Node*, int> strikes;
+  std::unordered_set<const Node*> rebuilding;
+  std::vector<std::future<std::vector<LeafRebuild>>> pendingRebuilds;
+};
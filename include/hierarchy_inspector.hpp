@@ -0,0 +1,77 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "bloomTree.hpp"
+
+// Per-depth summary of a hierarchy (depth 0 = root). Leaves of level-aware
+// trees can sit at different depths, so a level may mix leaves and internal
+// nodes.
+struct LevelInspection {
+  size_t depth = 0;
+  size_t nodes = 0;
+  size_t leaves = 0;
+  size_t items = 0;
+  size_t filterBytes = 0;
+  // share of set bits (Bloom) or of the 2^fingerprintBits fingerprints in
+  // use (quotient filter); outputs name it in their fillMeasure field
+  double avgFillRatio = 0.0;
+  double minFillRatio = 0.0;
+  double maxFillRatio = 0.0;
+  // from the fill ratio, and from itemCount with the textbook formula
+  double avgFillFpr = 0.0;
+  double maxFillFpr = 0.0;
+  double avgTheoreticalFpr = 0.0;
+  // sibling pairs under a parent at the previous depth whose key ranges
+  // overlap, against all sibling pairs
+  size_t siblingPairs = 0;
+  size_t overlappingSiblingPairs = 0;
+  // known-absent values probed against each sampled node of the level
+  size_t sampledNodes = 0;
+  size_t absentProbes = 0;
+  size_t absentPasses = 0;
+  double empiricalFpr = 0.0;
+};
+
+struct HierarchyInspection {
+  std::string column;
+  FilterKind filterKind = FilterKind::Bloom;
+  size_t bloomSize = 0;
+  int numHashFunctions = 0;
+  // leaves and internal nodes folded down to this FPR, 0 = not folded
+  double foldTargetFpr = 0.0;
+  size_t leaves = 0;
+  size_t depth = 0;
+  std::vector<LevelInspection> levels;
+  // known-absent values pushed through the whole tree: how many reached a
+  // leaf at all, and how many leaves they reached on average
+  size_t absentQueries = 0;
+  size_t absentQueriesReachingLeaf = 0;
+  double avgLeavesPerAbsentQuery = 0.0;
+  double avgNodesProbedPerAbsentQuery = 0.0;
+};
+
+// Walks the tree without touching the nodes' probe statistics. Absent values
+// are "<column>_absent<i>", which the generated datasets never contain; at
+// most maxSampledNodes nodes per level are probed with each of them.
+HierarchyInspection inspectHierarchy(const BloomTree& tree,
+                                     const std::string& column,
+                                     size_t absentSamples = 10000,
+                                     size_t maxSampledNodes = 64);
+
+void logHierarchyInspection(const HierarchyInspection& inspection);
+void writeInspectionCsv(const std::string& filename,
+                        const std::vector<HierarchyInspection>& inspections);
+void writeInspectionJson(const std::string& filename,
+                         const std::vector<HierarchyInspection>& inspections);
+
+// --inspect: builds the hierarchies of dbPath with the given shape and
+// writes csv/hierarchy_inspect.csv and csv/hierarchy_inspect.json. With
+// foldTargetFpr > 0 the filters are folded, and each level's empiricalFpr
+// shows what that costs the parents.
+void runHierarchyInspection(const std::string& dbPath, size_t dbSize,
+                            int ratio, size_t bloomSize,
+                            size_t itemsPerPartition, int numHashFunctions,
+                            size_t absentSamples = 10000,
+                            double foldTargetFpr = 0.0);
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "query_counters.hpp"
+
+class BloomTree;
+
+// Tasks posted to globalThreadPool by the query paths that have not started yet
+inline std::atomic<int64_t> gPoolQueuedTasks{0};
+
+using MetricLabels = std::vector<std::pair<std::string, std::string>>;
+
+class Counter {
+ public:
+  void inc(uint64_t by = 1) { value_.fetch_add(by, std::memory_order_relaxed); }
+  uint64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+ private:
+  std::atomic<uint64_t> value_{0};
+};
+
+class Gauge {
+ public:
+  void set(double v) { value_.store(v, std::memory_order_relaxed); }
+  double value() const { return value_.load(std::memory_order_relaxed); }
+
+ private:
+  std::atomic<double> value_{0.0};
+};
+
+// Cumulative buckets as Prometheus expects them; bounds are inclusive
+// upper limits, +Inf is implicit.
+class Histogram {
+ public:
+  explicit Histogram(std::vector<double> bounds);
+  void observe(double v);
+  const std::vector<double>& bounds() const { return bounds_; }
+  // per bucket (not cumulative), last one is +Inf
+  std::vector<uint64_t> bucketCounts() const;
+  uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+  double sum() const { return sum_.load(std::memory_order_relaxed); }
+
+ private:
+  std::vector<double> bounds_;
+  std::unique_ptr<std::atomic<uint64_t>[]> buckets_;
+  std::atomic<uint64_t> count_{0};
+  std::atomic<double> sum_{0.0};
+};
+
+// Process-wide metric families. References returned stay valid for the
+// life of the process, so hot paths can look a series up once and keep it.
+class MetricsRegistry {
+ public:
+  static MetricsRegistry& instance();
+
+  Counter& counter(const std::string& name, const std::string& help,
+                   const MetricLabels& labels = {});
+  Gauge& gauge(const std::string& name, const std::string& help,
+               const MetricLabels& labels = {});
+  Histogram& histogram(const std::string& name, const std::string& help,
+                       const MetricLabels& labels = {},
+                       const std::vector<double>& bounds = latencyBucketsMicros());
+
+  // run before every export, e.g. to copy process counters into gauges
+  void addCollector(std::function<void()> collector);
+  void collect();
+  std::string renderPrometheus() const;
+
+  static const std::vector<double>& latencyBucketsMicros();
+
+ private:
+  enum class Type { Counter, Gauge, Histogram };
+  struct Family {
+    Type type;
+    std::string help;
+    std::map<std::string, std::unique_ptr<Counter>> counters;
+    std::map<std::string, std::unique_ptr<Gauge>> gauges;
+    std::map<std::string, std::unique_ptr<Histogram>> histograms;
+  };
+  Family& family(const std::string& name, const std::string& help, Type type);
+
+  mutable std::mutex mtx;
+  std::map<std::string, Family> families;
+  std::vector<std::function<void()>> collectors;
+};
+
+inline MetricsRegistry& metrics() { return MetricsRegistry::instance(); }
+
+// The series of one query plan (multi, multi_bounded, single, scan, index,
+// range, text). Call sites keep it in a function-local static, so the
+// registry is searched once per plan and a query only touches atomics.
+struct QueryPlanMetrics {
+  explicit QueryPlanMetrics(const char* plan);
+
+  Counter& queries;
+  Histogram& latency;
+  Counter& bloomChecks;
+  Counter& leafBloomChecks;
+  Counter& sstChecks;
+};
+
+// Records one query of a plan when it goes out of scope, early returns
+// included: rate, latency and the Bloom / SST checks this query made.
+class QueryMetricsScope {
+ public:
+  explicit QueryMetricsScope(QueryPlanMetrics& series);
+  ~QueryMetricsScope();
+
+ private:
+  QueryPlanMetrics& series;
+  std::chrono::steady_clock::time_point begin;
+  QueryCounters counters;
+  QueryCounterScope countScope;
+};
+
+// memory per column and tree depth (internal nodes) and on-disk leaf bytes
+void exportHierarchyMetrics(const std::string& column, const BloomTree& tree);
+
+// Writes the registry in Prometheus text format every interval to filePath
+// (atomically, via a temporary file) and/or serves it over HTTP on
+// 127.0.0.1:port. Empty path / port 0 disables that output.
+class MetricsExporter {
+ public:
+  MetricsExporter(std::string filePath, int port,
+                  std::chrono::milliseconds interval =
+                      std::chrono::milliseconds(5000));
+  ~MetricsExporter();
+  void stop();
+
+ private:
+  void run();
+  void writeFile(const std::string& text) const;
+  void serveUntil(std::chrono::steady_clock::time_point deadline,
+                  const std::string& text);
+
+  std::string filePath;
+  int port;
+  std::chrono::milliseconds interval;
+  int listenFd = -1;
+  std::atomic<bool> running{true};
+  std::thread worker;
+};
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Hardware counters (perf_event_open, user space only) summed per query
+// phase over every thread that works on it: the querying thread for
+// Filter, globalThreadPool workers for Scan and Verify. Off by default;
+// when the kernel refuses an event it reads as 0 and is reported missing.
+// When the PMU multiplexes events, counts are scaled by enabled/running
+// time and perfCountersMultiplexed() says so.
+enum class PerfEvent : size_t {
+  Cycles,
+  Instructions,
+  LLCMisses,
+  DTLBMisses,
+  BranchMisses,
+  Count
+};
+
+enum class PerfPhase : size_t {
+  Filter,  // hierarchy traversal / filter probes
+  Scan,    // SST scans of candidate leaves
+  Verify,  // point lookups of the other columns (single hierarchy)
+  Count
+};
+
+constexpr size_t kPerfEvents = static_cast<size_t>(PerfEvent::Count);
+constexpr size_t kPerfPhases = static_cast<size_t>(PerfPhase::Count);
+
+using PerfCounts = std::array<uint64_t, kPerfEvents>;
+using PhasePerfCounts = std::array<PerfCounts, kPerfPhases>;
+
+// raw readings with the kernel's enabled and running times per event
+struct PerfReading {
+  PerfCounts value{};
+  PerfCounts enabled{};
+  PerfCounts running{};
+};
+
+void setPerfCountersEnabled(bool enabled);
+bool perfCountersEnabled();
+// bit i set if event i could be opened on some thread
+unsigned perfEventsAvailable();
+// also clears the multiplexed flag
+void resetPerfCounters();
+PerfCounts perfCounters(PerfPhase phase);
+// every phase at once; the difference of two is the work in between
+PhasePerfCounts perfCountersByPhase();
+// true if some event did not run for all of a scope since the last reset,
+// i.e. the counts since then are scaled estimates
+bool perfCountersMultiplexed();
+
+const char* perfEventName(PerfEvent event);
+const char* perfPhaseName(PerfPhase phase);
+// "cycles,instructions,..." for a CSV header, prefixed per column
+std::string perfCsvHeader(const std::string& prefix);
+// matching comma-separated values
+std::string perfCsvValues(const PerfCounts& counts);
+
+// Adds the calling thread's counter deltas over its lifetime to phase.
+// Costs one relaxed load when counters are disabled.
+class PerfScope {
+ public:
+  explicit PerfScope(PerfPhase phase);
+  ~PerfScope();
+  PerfScope(const PerfScope&) = delete;
+  PerfScope& operator=(const PerfScope&) = delete;
+
+ private:
+  PerfPhase phase;
+  bool active = false;
+  PerfReading start;
+};
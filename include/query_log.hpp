@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// One captured query: equality values per column over [startKey, endKey]
+// (empty = unbounded), arrivalMicros since capture started.
+struct QueryLogRecord {
+  uint64_t arrivalMicros = 0;
+  std::vector<std::string> columns;
+  std::vector<std::string> values;
+  std::string startKey;
+  std::string endKey;
+};
+
+// Binary log: "HQL1", then per record a varint arrival delta, the column
+// count, and per column a dictionary id (a new id is followed by the name)
+// and the value; key bounds last. Strings are varint length + bytes.
+void startQueryCapture(const std::string& path);
+void stopQueryCapture();
+bool queryCaptureActive();
+// no-op unless a capture is running; safe from any thread
+void captureQuery(const std::vector<std::string>& columns,
+                  const std::vector<std::string>& values,
+                  const std::string& startKey = "",
+                  const std::string& endKey = "");
+
+std::vector<QueryLogRecord> readQueryLog(const std::string& path);
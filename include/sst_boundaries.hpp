@@ -0,0 +1,51 @@
+#pragma once
+
+#include <rocksdb/table_properties.h>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Every kBoundarySampleStride-th put key of an SST file, recorded in its
+// table properties when the file is written. Hierarchy builds split large
+// files at these keys, so a file can be read by several threads without a
+// counting pass.
+inline constexpr size_t kBoundarySampleStride = 10000;
+
+class BoundarySampleCollector : public rocksdb::TablePropertiesCollector {
+ public:
+  rocksdb::Status AddUserKey(const rocksdb::Slice& key,
+                             const rocksdb::Slice& value,
+                             rocksdb::EntryType type,
+                             rocksdb::SequenceNumber seq,
+                             uint64_t fileSize) override;
+  rocksdb::Status Finish(rocksdb::UserCollectedProperties* properties) override;
+  rocksdb::UserCollectedProperties GetReadableProperties() const override;
+  const char* Name() const override { return "BoundarySampleCollector"; }
+
+ private:
+  size_t puts = 0;
+  std::string samples;  // 4-byte BE length + key, repeated
+};
+
+class BoundarySampleCollectorFactory
+    : public rocksdb::TablePropertiesCollectorFactory {
+ public:
+  rocksdb::TablePropertiesCollector* CreateTablePropertiesCollector(
+      rocksdb::TablePropertiesCollectorFactory::Context context) override;
+  const char* Name() const override { return "BoundarySampleCollectorFactory"; }
+};
+
+// Sampled keys of a file in key order; samples[i] is the first key of put
+// number (i + 1) * stride. Empty if the file was written without the
+// collector.
+std::vector<std::string> readBoundarySamples(
+    const rocksdb::TableProperties& properties, size_t* stride = nullptr);
+
+// Start keys of up to maxRanges ranges covering the file, in order, the
+// first one empty (= file start). Each range except the last holds a whole
+// number of partitionSize entries, so partitions built per range are the
+// ones a single pass over the file would build.
+std::vector<std::string> splitKeysForPartitions(
+    const std::vector<std::string>& samples, size_t stride,
+    uint64_t numEntries, size_t partitionSize, size_t maxRanges);
@@ -2,6 +2,10 @@
 
 #include <string>
 #include <cstddef>
+#include <vector>
+
+#include "bloom_value.hpp"
+#include "quotient_filter.hpp"
 
 struct TestParams {
     std::string dbName;
@@ -11,4 +15,14 @@ struct TestParams {
     size_t itemsPerPartition;
     size_t bloomSize;
     int numHashFunctions;
+    // columns that also get an n-gram filter for substring / prefix queries
+    std::vector<std::string> ngramColumns = {};
+    size_t ngramSize = 3;
+    // count-min sketch per leaf for count estimates, 0 disables
+    size_t sketchWidth = 0;
+    int sketchDepth = 4;
+    ProbeMode probeMode = ProbeMode::EarlyExit;
+    // fold sparse leaves down to this FPR after build, 0 disables
+    double foldTargetFpr = 0.0;
+    FilterKind filterKind = FilterKind::Bloom;
 };
@@ -0,0 +1,69 @@
+import sys
+
+import pandas as pd
+import matplotlib.pyplot as plt
+from pathlib import Path
+
+plt.style.use('default')
+PLOT_STYLE = {
+    'figure.figsize': (14, 7), 'font.size': 12, 'axes.titlesize': 16,
+    'axes.labelsize': 14, 'xtick.labelsize': 12, 'ytick.labelsize': 12,
+    'legend.fontsize': 11, 'lines.linewidth': 3, 'lines.markersize': 9,
+    'axes.grid': True, 'grid.alpha': 0.4, 'axes.spines.top': False,
+    'axes.spines.right': False, 'font.family': 'serif'
+}
+plt.rcParams.update(PLOT_STYLE)
+
+COLORS = ['#2E86AB', '#F18F01', '#C73E1D', '#3B1F2B', '#6A994E']
+
+
+def load_data(file_path: str) -> pd.DataFrame:
+    """Loads the per-level rows written by --inspect."""
+    print(f"Loading data from {file_path}...")
+    try:
+        return pd.read_csv(file_path)
+    except FileNotFoundError:
+        print(f"Error: The file {file_path} was not found.")
+        return pd.DataFrame()
+
+
+def fpr_by_depth_plot(data: pd.DataFrame):
+    """Fill-based, theoretical and sampled FPR per depth, one color per column."""
+    fig, (ax_fpr, ax_fill) = plt.subplots(1, 2)
+    for i, (column, subset) in enumerate(data.groupby('column')):
+        color = COLORS[i % len(COLORS)]
+        subset = subset.sort_values('depth')
+        ax_fpr.plot(subset['depth'], subset['empiricalFpr'], 'o-', color=color,
+                    label=f'{column} sampled')
+        ax_fpr.plot(subset['depth'], subset['avgTheoreticalFpr'], 'x--', color=color,
+                    label=f'{column} theoretical')
+        ax_fill.plot(subset['depth'], subset['avgFillRatio'], 'o-', color=color, label=column)
+        ax_fill.fill_between(subset['depth'], subset['minFillRatio'], subset['maxFillRatio'],
+                             color=color, alpha=0.15)
+    ax_fpr.set_yscale('log')
+    ax_fpr.set_title('FPR per depth', fontweight='bold')
+    ax_fpr.set_xlabel('Depth (0 = root)', fontweight='bold')
+    ax_fpr.set_ylabel('False positive rate', fontweight='bold')
+    ax_fpr.legend()
+    ax_fill.set_title('Fill ratio per depth', fontweight='bold')
+    ax_fill.set_xlabel('Depth (0 = root)', fontweight='bold')
+    measures = ', '.join(data['fillMeasure'].unique()) if 'fillMeasure' in data else ''
+    ax_fill.set_ylabel(f'Fill ratio ({measures})' if measures else 'Fill ratio',
+                       fontweight='bold')
+    ax_fill.legend()
+    Path('plots').mkdir(exist_ok=True)
+    fig.savefig('plots/hierarchy_inspect_fpr.png', dpi=300, bbox_inches='tight')
+    plt.close(fig)
+    print("  > Plot saved: plots/hierarchy_inspect_fpr.png")
+
+
+def main():
+    data = load_data(sys.argv[1] if len(sys.argv) > 1 else "data/hierarchy_inspect.csv")
+    if not data.empty:
+        fpr_by_depth_plot(data)
+    else:
+        print("\nNo data loaded. Stopping script.")
+
+
+if __name__ == "__main__":
+    main()
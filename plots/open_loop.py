@@ -0,0 +1,61 @@
+import pandas as pd
+import matplotlib.pyplot as plt
+from pathlib import Path
+
+plt.style.use('default')
+PLOT_STYLE = {
+    'figure.figsize': (14, 7), 'font.size': 12, 'axes.titlesize': 16,
+    'axes.labelsize': 14, 'xtick.labelsize': 12, 'ytick.labelsize': 12,
+    'legend.fontsize': 11, 'lines.linewidth': 3, 'lines.markersize': 9,
+    'axes.grid': True, 'grid.alpha': 0.4, 'axes.spines.top': False,
+    'axes.spines.right': False, 'font.family': 'serif'
+}
+plt.rcParams.update(PLOT_STYLE)
+
+COLORS = {'poisson': '#2E86AB', 'constant': '#F18F01'}
+
+
+def load_data(file_path: str) -> pd.DataFrame:
+    """Loads the open-loop sweep written by runExp11."""
+    print(f"Loading data from {file_path}...")
+    try:
+        return pd.read_csv(file_path)
+    except FileNotFoundError:
+        print(f"Error: The file {file_path} was not found.")
+        return pd.DataFrame()
+
+
+def qps_latency_plot(data: pd.DataFrame):
+    """Latency percentiles (from intended send time) against achieved QPS."""
+    fig, ax = plt.subplots()
+    for arrival, subset in data.groupby('arrival'):
+        subset = subset.sort_values('targetQps')
+        color = COLORS.get(arrival)
+        ax.plot(subset['achievedQps'], subset['latencyP50'] / 1000, 'o--', color=color,
+                label=f'{arrival} p50')
+        ax.plot(subset['achievedQps'], subset['latencyP99'] / 1000, 'o-', color=color,
+                label=f'{arrival} p99')
+        saturated = subset[subset['saturated'] == 1]
+        ax.scatter(saturated['achievedQps'], saturated['latencyP99'] / 1000, marker='x',
+                   s=150, color='#C73E1D', zorder=5)
+    ax.set_yscale('log')
+    ax.set_title('Open-loop QPS vs latency', fontweight='bold')
+    ax.set_xlabel('Achieved QPS', fontweight='bold')
+    ax.set_ylabel('Latency [ms]', fontweight='bold')
+    ax.legend()
+    Path('plots').mkdir(exist_ok=True)
+    fig.savefig('plots/open_loop_qps_latency.png', dpi=300, bbox_inches='tight')
+    plt.close(fig)
+    print("  > Plot saved: plots/open_loop_qps_latency.png")
+
+
+def main():
+    data = load_data("data/exp_11_open_loop.csv")
+    if not data.empty:
+        qps_latency_plot(data)
+    else:
+        print("\nNo data loaded. Stopping script.")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,58 @@
+import sys
+
+import pandas as pd
+
+METRICS = ['multiTime', 'multiBloomChecks', 'multiSSTChecks',
+           'singleTime', 'singleBloomChecks', 'singleSSTChecks']
+
+
+def load_data(file_path: str) -> pd.DataFrame:
+    """Loads the per-query replay rows written by runExp12."""
+    print(f"Loading data from {file_path}...")
+    try:
+        return pd.read_csv(file_path)
+    except FileNotFoundError:
+        print(f"Error: The file {file_path} was not found.")
+        return pd.DataFrame()
+
+
+def diff_configs(data: pd.DataFrame, baseline: str, candidate: str) -> pd.DataFrame:
+    """Per-query candidate - baseline for every metric, joined on query index.
+
+    Only the last replay pass is compared, the one run after the hierarchies
+    adapted to the log."""
+    if 'pass' in data.columns:
+        data = data[data['pass'] == data['pass'].max()]
+    base = data[data['config'] == baseline].set_index('query')
+    cand = data[data['config'] == candidate].set_index('query')
+    joined = base[METRICS].join(cand[METRICS], lsuffix='_base', rsuffix='_cand', how='inner')
+    for metric in METRICS:
+        joined[f'{metric}_diff'] = joined[f'{metric}_cand'] - joined[f'{metric}_base']
+    mismatched = (base['multiMatches'] != cand['multiMatches']).reindex(joined.index)
+    joined['matchesDiffer'] = mismatched.astype(int)
+    return joined
+
+
+def main():
+    if len(sys.argv) < 3:
+        print("Usage: replay_diff.py <baseline config> <candidate config> [replay csv]")
+        return
+    baseline, candidate = sys.argv[1], sys.argv[2]
+    data = load_data(sys.argv[3] if len(sys.argv) > 3 else "data/exp_12_replay.csv")
+    if data.empty:
+        print("\nNo data loaded. Stopping script.")
+        return
+    diff = diff_configs(data, baseline, candidate)
+    out = f"data/exp_12_diff_{baseline}_vs_{candidate}.csv"
+    diff.to_csv(out)
+    print(f"  > {len(diff)} queries compared, written to {out}")
+    for metric in METRICS:
+        col = diff[f'{metric}_diff']
+        print(f"  {metric:>18}: mean {col.mean():+.1f}, median {col.median():+.1f}, "
+              f"worse in {(col > 0).sum()} queries")
+    if diff['matchesDiffer'].any():
+        print(f"  WARNING: {diff['matchesDiffer'].sum()} queries returned a different number of matches")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,169 @@
+#include "async_query.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <unordered_set>
+
+#include "memory_accounting.hpp"
+#include "perf_counters.hpp"
+
+boost::asio::awaitable<std::vector<std::string>>
+multiColumnQueryHierarchicalAsync(std::vector<BloomTree>& trees,
+                                  std::vector<ColumnPredicate> predicates,
+                                  std::string globalStart, std::string globalEnd,
+                                  DBManager& dbManager) {
+  size_t n = trees.size();
+  if (n == 0 || n != predicates.size()) {
+    spdlog::error("Number of trees and values must match and be non-empty.");
+    co_return std::vector<std::string>{};
+  }
+
+  std::vector<ColumnPredicate> resolved = resolvePredicates(trees, predicates);
+  Combo start;
+  if (!makeRootCombo(trees, globalStart, globalEnd, start)) {
+    co_return std::vector<std::string>{};
+  }
+
+  // the traversal only touches memory, one pool task does all of it
+  std::vector<Combo> leafCombos = co_await onPool<std::vector<Combo>>([&]() {
+    PerfScope perf(PerfPhase::Filter);
+    MemoryTagScope memoryTag(MemoryTag::QueryScratch);
+    std::vector<Combo> combos;
+    dfsMultiColumn(resolved, start, dbManager, true,
+                   [&](const Combo& combo) { combos.push_back(combo); });
+    return combos;
+  });
+  if (leafCombos.empty()) co_return std::vector<std::string>{};
+
+  // every leaf of every combo is scanned at once
+  countSstChecks(leafCombos.size() * n);
+  std::vector<std::function<std::unordered_set<std::string>()>> scans;
+  scans.reserve(leafCombos.size() * n);
+  for (const Combo& combo : leafCombos) {
+    for (size_t i = 0; i < n; ++i) {
+      scans.push_back([&combo, i, &pred = resolved[i], &dbManager]() {
+        PerfScope perf(PerfPhase::Scan);
+        MemoryTagScope memoryTag(MemoryTag::QueryScratch);
+        std::vector<std::string> keys =
+            scanComboLeaf(combo, i, pred, dbManager);
+        return std::unordered_set<std::string>(keys.begin(), keys.end());
+      });
+    }
+  }
+  std::vector<std::unordered_set<std::string>> keySets =
+      co_await onPoolAll<std::unordered_set<std::string>>(std::move(scans));
+
+  std::vector<std::string> matches;
+  std::vector<std::vector<const Node*>> hitLeaves(n);
+  for (size_t c = 0; c < leafCombos.size(); ++c) {
+    std::vector<std::unordered_set<std::string>> comboSets(
+        std::make_move_iterator(keySets.begin() + c * n),
+        std::make_move_iterator(keySets.begin() + (c + 1) * n));
+    std::vector<std::string> keys = intersectKeySets(comboSets);
+    if (!keys.empty()) addComboHits(leafCombos[c], hitLeaves);
+    matches.insert(matches.end(), keys.begin(), keys.end());
+  }
+  recordCoMatches(trees, hitLeaves);
+  co_return matches;
+}
+
+boost::asio::awaitable<std::vector<std::string>>
+multiColumnQueryHierarchicalAsync(std::vector<BloomTree>& trees,
+                                  const std::vector<std::string>& values,
+                                  std::string globalStart, std::string globalEnd,
+                                  DBManager& dbManager) {
+  return multiColumnQueryHierarchicalAsync(trees, equalityPredicates(values),
+                                           std::move(globalStart),
+                                           std::move(globalEnd), dbManager);
+}
+
+boost::asio::awaitable<std::vector<std::string>> findUsingSingleHierarchyAsync(
+    DBManager& dbManager, BloomTree& hierarchy,
+    std::vector<std::string> columns, std::vector<std::string> values) {
+  if (columns.size() != values.size() || columns.empty()) {
+    throw std::runtime_error(
+        "Number of columns and values must be equal and non-empty.");
+  }
+  values = dbManager.queryValues(columns, values);
+
+  std::vector<const Node*> candidates =
+      co_await onPool<std::vector<const Node*>>([&]() {
+        PerfScope perf(PerfPhase::Filter);
+        return hierarchy.queryNodes(values[0], "", "");
+      });
+  if (candidates.empty()) co_return std::vector<std::string>{};
+
+  countSstChecks(candidates.size());
+  std::vector<std::function<std::vector<std::string>()>> scans;
+  scans.reserve(candidates.size());
+  for (const Node* candidate : candidates) {
+    scans.push_back([candidate, &value = values[0], &dbManager]() {
+      PerfScope perf(PerfPhase::Scan);
+      MemoryTagScope memoryTag(MemoryTag::QueryScratch);
+      auto keys = dbManager.scanFileForKeysWithValue(
+          candidate->filename, value, candidate->startKey, candidate->endKey);
+      candidate->recordScanResult(!keys.empty());
+      return keys;
+    });
+  }
+  std::vector<std::vector<std::string>> scanned =
+      co_await onPoolAll<std::vector<std::string>>(std::move(scans));
+
+  std::vector<std::string> allKeys;
+  std::vector<const Node*> hitLeaves;
+  for (size_t i = 0; i < scanned.size(); ++i) {
+    if (!scanned[i].empty()) hitLeaves.push_back(candidates[i]);
+    allKeys.insert(allKeys.end(), scanned[i].begin(), scanned[i].end());
+  }
+  hierarchy.coMatches->record(hitLeaves);
+
+  std::vector<std::function<std::string()>> verifications;
+  verifications.reserve(allKeys.size());
+  for (const std::string& key : allKeys) {
+    verifications.push_back([&key, &columns, &values, &dbManager]() {
+      PerfScope perf(PerfPhase::Verify);
+      MemoryTagScope memoryTag(MemoryTag::QueryScratch);
+      return dbManager.keyMatchesColumns(key, columns, values) ? key
+                                                               : std::string();
+    });
+  }
+  std::vector<std::string> verified =
+      co_await onPoolAll<std::string>(std::move(verifications));
+
+  std::vector<std::string> matchingKeys;
+  for (std::string& key : verified) {
+    if (!key.empty()) matchingKeys.push_back(std::move(key));
+  }
+  co_return matchingKeys;
+}
+
+boost::asio::awaitable<bool> findRecordInHierarchyAsync(DBManager& dbManager,
+                                                        BloomTree& hierarchy,
+                                                        std::string value,
+                                                        std::string startKey,
+                                                        std::string endKey) {
+  value = hierarchy.encodeQueryValue(value);
+  std::vector<std::string> candidates =
+      co_await onPool<std::vector<std::string>>([&]() {
+        PerfScope perf(PerfPhase::Filter);
+        return hierarchy.query(value, startKey, endKey);
+      });
+  if (candidates.empty()) co_return false;
+
+  // scans that start after a hit skip their file; int because vector<bool>
+  // can't be written from several threads
+  auto found = std::make_shared<std::atomic<bool>>(false);
+  std::vector<std::function<int()>> scans;
+  scans.reserve(candidates.size());
+  for (const std::string& candidate : candidates) {
+    scans.push_back([&candidate, &value, &dbManager, found]() {
+      if (found->load()) return 0;
+      PerfScope perf(PerfPhase::Scan);
+      bool hit = dbManager.ScanFileForValue(candidate, value);
+      if (hit) found->store(true);
+      return hit ? 1 : 0;
+    });
+  }
+  co_await onPoolAll<int>(std::move(scans));
+  co_return found->load();
+}
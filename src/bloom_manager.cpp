@@ -3,21 +3,56 @@
 #include <rocksdb/sst_file_reader.h>
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
 #include <future>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include <boost/asio/thread_pool.hpp>
 #include <boost/asio/post.hpp>
 
 #include "bloomTree.hpp"
 #include "bloom_value.hpp"
+#include "memory_accounting.hpp"
+#include "metrics.hpp"
+#include "sst_boundaries.hpp"
 #include "stopwatch.hpp"
 
 extern boost::asio::thread_pool globalThreadPool;
 
-std::vector<Node*> BloomManager::processSSTFile(const std::string& sstFile,
-                                                size_t partitionSize,
-                                                size_t bloomSize,
-                                                int numHashFunctions) {
+std::vector<std::string> BloomManager::splitSSTFile(const std::string& sstFile,
+                                                   size_t partitionSize,
+                                                   size_t maxRanges) {
+    std::vector<std::string> starts = {""};
+    if (maxRanges < 2) return starts;
+    rocksdb::Options options;
+    rocksdb::SstFileReader reader(options);
+    if (!reader.Open(sstFile).ok()) return starts;
+    auto properties = reader.GetTableProperties();
+    if (!properties) return starts;
+    size_t stride = 0;
+    std::vector<std::string> samples = readBoundarySamples(*properties, &stride);
+    return splitKeysForPartitions(samples, stride, properties->num_entries,
+                                  partitionSize, maxRanges);
+}
+
+std::vector<Node*> BloomManager::processSSTRange(const std::string& sstFile,
+                                                 const std::string& startKey,
+                                                 const std::string& endKey,
+                                                 size_t partitionSize,
+                                                 size_t bloomSize,
+                                                 int numHashFunctions,
+                                                 TextFilterMode textMode,
+                                                 size_t gramSize,
+                                                 size_t sketchWidth,
+                                                 int sketchDepth,
+                                                 FilterKind filterKind) {
+    // reader and row buffers are build memory, leaves belong to the hierarchy
+    MemoryTagScope buildTag(MemoryTag::Build);
     std::vector<Node*> partitions;
     rocksdb::Options options;
     rocksdb::SstFileReader reader(options);
@@ -27,76 +62,198 @@ std::vector<Node*> BloomManager::processSSTFile(const std::string& sstFile,
         return partitions;
     }
 
-    auto iter = reader.NewIterator(rocksdb::ReadOptions());
+    // bounded so neighbouring ranges of the file don't overlap
+    rocksdb::ReadOptions readOptions;
+    rocksdb::Slice upperBound(endKey);
+    if (!endKey.empty()) readOptions.iterate_upper_bound = &upperBound;
+    auto iter = reader.NewIterator(readOptions);
     size_t currentCount = 0;
-    BloomFilter partitionBloom(bloomSize, numHashFunctions);
+    bool tables = filterKind == FilterKind::Quotient;
+    setMemoryTag(MemoryTag::Hierarchy);
+    // quotient filter leaves collect their values and build the filter in one batch
+    BloomFilter partitionBloom(tables ? 0 : bloomSize, numHashFunctions);
+    BloomFilter partitionTextBloom(textMode != TextFilterMode::None ? bloomSize : 1,
+                                   numHashFunctions);
+    CountMinSketch partitionSketch(sketchWidth > 0 ? sketchWidth : 1,
+                                   sketchWidth > 0 ? sketchDepth : 0);
+    setMemoryTag(MemoryTag::Build);
+    std::vector<std::string> partitionValues;
     std::string partitionStartKey;
+    std::string partitionMinValue;
+    std::string partitionMaxValue;
     bool firstEntry = true;
     std::string lastKey;
 
-    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    if (startKey.empty()) {
+        iter->SeekToFirst();
+    } else {
+        iter->Seek(startKey);
+    }
+    for (; iter->Valid(); iter->Next()) {
         std::string key = iter->key().ToString();
         std::string value = iter->value().ToString();
 
         if (firstEntry) {
             partitionStartKey = key;
+            partitionMinValue = value;
+            partitionMaxValue = value;
             firstEntry = false;
+        } else if (value < partitionMinValue) {
+            partitionMinValue = value;
+        } else if (value > partitionMaxValue) {
+            partitionMaxValue = value;
         }
 
-        partitionBloom.insert(value);
+        if (tables) {
+            partitionValues.push_back(value);
+        } else {
+            partitionBloom.insert(value);
+        }
+        if (textMode != TextFilterMode::None) {
+            for (const auto& term : textFilterTerms(value, textMode, gramSize)) {
+                partitionTextBloom.insert(term);
+            }
+        }
+        if (sketchWidth > 0) {
+            partitionSketch.add(value);
+        }
         lastKey = key;
         currentCount++;
 
         if (currentCount >= partitionSize) {
+            MemoryTagScope leafTag(MemoryTag::Hierarchy);
             partitions.push_back(new Node(std::move(partitionBloom), sstFile, partitionStartKey, lastKey));
-            partitionBloom = BloomFilter(bloomSize, numHashFunctions);
+            partitions.back()->extendValueRange(partitionMinValue, partitionMaxValue);
+            partitions.back()->itemCount = currentCount;
+            if (tables) {
+                partitions.back()->qfilter.emplace();
+                partitions.back()->qfilter->insertAll(partitionValues);
+                partitionValues.clear();
+            }
+            if (textMode != TextFilterMode::None) {
+                partitions.back()->textBloom = std::move(partitionTextBloom);
+                partitionTextBloom = BloomFilter(bloomSize, numHashFunctions);
+            }
+            if (sketchWidth > 0) {
+                partitions.back()->sketch = std::move(partitionSketch);
+                partitionSketch = CountMinSketch(sketchWidth, sketchDepth);
+            }
+            partitionBloom = BloomFilter(tables ? 0 : bloomSize, numHashFunctions);
             currentCount = 0;
             firstEntry = true;
         }
     }
 
     if (currentCount > 0) {
+        MemoryTagScope leafTag(MemoryTag::Hierarchy);
         partitions.push_back(new Node(std::move(partitionBloom), sstFile, partitionStartKey, lastKey));
+        partitions.back()->extendValueRange(partitionMinValue, partitionMaxValue);
+        partitions.back()->itemCount = currentCount;
+        if (tables) {
+            partitions.back()->qfilter.emplace();
+            partitions.back()->qfilter->insertAll(partitionValues);
+        }
+        if (textMode != TextFilterMode::None) {
+            partitions.back()->textBloom = std::move(partitionTextBloom);
+        }
+        if (sketchWidth > 0) {
+            partitions.back()->sketch = std::move(partitionSketch);
+        }
     }
 
     delete iter;
     return partitions;
 }
 
+std::vector<std::vector<Node*>> BloomManager::processSSTFiles(const std::vector<std::string>& sstFiles,
+                                                             size_t partitionSize,
+                                                             size_t bloomSize,
+                                                             int numHashFunctions,
+                                                             TextFilterMode textMode,
+                                                             size_t gramSize,
+                                                             size_t sketchWidth,
+                                                             int sketchDepth,
+                                                             FilterKind filterKind,
+                                                             size_t buildThreads) {
+    // Large files are split into ranges read by separate tasks, so a few
+    // big compacted files still keep every build thread busy. Ranges hold
+    // whole partitions, which keeps the leaves those of a per-file pass.
+    // A budget gets a pool of its own, so its tasks can't spread over the
+    // rest of globalThreadPool.
+    std::optional<boost::asio::thread_pool> budgetPool;
+    if (buildThreads > 0) budgetPool.emplace(buildThreads);
+    boost::asio::thread_pool& pool = budgetPool ? *budgetPool : globalThreadPool;
+    const size_t threads = buildThreads > 0 ? buildThreads : globalThreadPoolSize;
+    const size_t maxRanges =
+        sstFiles.empty() ? 1 : (threads + sstFiles.size() - 1) / sstFiles.size();
+
+    std::vector<std::vector<std::future<std::vector<Node*>>>> futures(sstFiles.size());
+    for (size_t f = 0; f < sstFiles.size(); ++f) {
+        const std::string& sstFile = sstFiles[f];
+        std::vector<std::string> starts = splitSSTFile(sstFile, partitionSize, maxRanges);
+        for (size_t r = 0; r < starts.size(); ++r) {
+            std::string endKey = r + 1 < starts.size() ? starts[r + 1] : "";
+            auto task = std::make_shared<
+                std::packaged_task<std::vector<Node*>()>
+            >(
+                std::bind(&BloomManager::processSSTRange,
+                          this,
+                          sstFile,
+                          starts[r],
+                          endKey,
+                          partitionSize,
+                          bloomSize,
+                          numHashFunctions,
+                          textMode,
+                          gramSize,
+                          sketchWidth,
+                          sketchDepth,
+                          filterKind)
+            );
+
+            futures[f].emplace_back(task->get_future());
+
+            boost::asio::post(pool,
+                [task]() { (*task)(); }
+            );
+        }
+    }
+
+    std::vector<std::vector<Node*>> leavesPerFile;
+    leavesPerFile.reserve(futures.size());
+    for (auto& fileFutures : futures) {
+        std::vector<Node*> leaves;
+        for (auto& fut : fileFutures) {
+            std::vector<Node*> rangeLeaves = fut.get();
+            leaves.insert(leaves.end(), rangeLeaves.begin(), rangeLeaves.end());
+        }
+        leavesPerFile.push_back(std::move(leaves));
+    }
+    return leavesPerFile;
+}
+
 BloomTree BloomManager::createPartitionedHierarchy(const std::vector<std::string>& sstFiles,
                                                    size_t partitionSize,
                                                    size_t bloomSize,
                                                    int numHashFunctions,
-                                                   int branchingRatio) {
+                                                   int branchingRatio,
+                                                   TextFilterMode textMode,
+                                                   size_t gramSize,
+                                                   size_t sketchWidth,
+                                                   int sketchDepth,
+                                                   double foldTargetFpr,
+                                                   FilterKind filterKind,
+                                                   size_t buildThreads) {
     StopWatch sw;
     sw.start();
-    BloomTree hierarchy(branchingRatio, bloomSize, numHashFunctions);
-
-    std::vector<std::future<std::vector<Node*>>> futures;
-    futures.reserve(sstFiles.size());
-
-    for (const auto& sstFile : sstFiles) {
-        auto task = std::make_shared<
-            std::packaged_task<std::vector<Node*>()>
-        >(
-            std::bind(&BloomManager::processSSTFile,
-                      this,
-                      sstFile,
-                      partitionSize,
-                      bloomSize,
-                      numHashFunctions)
-        );
-
-        futures.emplace_back(task->get_future());
-
-        boost::asio::post(globalThreadPool,
-            [task]() { (*task)(); }
-        );
-    }
+    BloomTree hierarchy(branchingRatio, bloomSize, numHashFunctions, textMode, gramSize);
+    hierarchy.setFoldTargetFpr(foldTargetFpr);
+    hierarchy.setFilterKind(filterKind);
 
     std::vector<Node*> allLeafNodes;
-    for (auto& fut : futures) {
-        std::vector<Node*> nodes = fut.get();
+    for (auto& nodes : processSSTFiles(sstFiles, partitionSize, bloomSize, numHashFunctions,
+                                       textMode, gramSize, sketchWidth, sketchDepth,
+                                       filterKind, buildThreads)) {
         allLeafNodes.insert(allLeafNodes.end(), nodes.begin(), nodes.end());
     }
 
@@ -104,6 +261,208 @@ BloomTree BloomManager::createPartitionedHierarchy(const std::vector<std::string
 
     hierarchy.buildTree();
     sw.stop();
+    metrics().histogram("hdb_rebuild_micros", "Hierarchy build and rebuild durations",
+                        {{"kind", "build"}})
+        .observe(static_cast<double>(sw.elapsedMicros()));
     spdlog::info("Bloom hierarchy successfully built from partitions using parallel processing in {} µs.", sw.elapsedMicros());
     return hierarchy;
 }
+
+BloomTree BloomManager::createLevelAwareHierarchy(const std::vector<std::vector<std::string>>& sstFilesByLevel,
+                                                  size_t partitionSize,
+                                                  size_t bloomSize,
+                                                  int numHashFunctions,
+                                                  int branchingRatio,
+                                                  int hotLevels,
+                                                  TextFilterMode textMode,
+                                                  size_t gramSize,
+                                                  size_t sketchWidth,
+                                                  int sketchDepth,
+                                                  double foldTargetFpr,
+                                                  FilterKind filterKind) {
+    BloomTree hierarchy(branchingRatio, bloomSize, numHashFunctions, textMode, gramSize);
+    hierarchy.setFoldTargetFpr(foldTargetFpr);
+    hierarchy.setFilterKind(filterKind);
+    refreshLevelAwareHierarchy(hierarchy, sstFilesByLevel, partitionSize, hotLevels,
+                               sketchWidth, sketchDepth);
+    return hierarchy;
+}
+
+static void collectInternalNodes(Node* node, std::vector<Node*>& out) {
+    if (!node || node->filename != "Memory") return;
+    out.push_back(node);
+    for (Node* child : node->children) {
+        collectInternalNodes(child, out);
+    }
+}
+
+void BloomManager::refreshLevelAwareHierarchy(BloomTree& hierarchy,
+                                              const std::vector<std::vector<std::string>>& sstFilesByLevel,
+                                              size_t partitionSize,
+                                              int hotLevels,
+                                              size_t sketchWidth,
+                                              int sketchDepth) {
+    StopWatch sw;
+    sw.start();
+
+    // L0..L(hotLevels-1) share one small subtree, every lower level gets its own
+    std::vector<BloomTree::LevelGroup> groups;
+    int numLevels = static_cast<int>(sstFilesByLevel.size());
+    int hotEnd = std::min(std::max(hotLevels, 1), std::max(numLevels, 1));
+    groups.push_back({0, hotEnd - 1, {}, {}, nullptr});
+    for (int level = 0; level < numLevels; ++level) {
+        if (level >= hotEnd) {
+            if (sstFilesByLevel[level].empty()) continue;
+            groups.push_back({level, level, {}, {}, nullptr});
+        }
+        auto& files = groups.back().files;
+        files.insert(files.end(), sstFilesByLevel[level].begin(), sstFilesByLevel[level].end());
+    }
+
+    // SST files are immutable, so leaves of files that survived are reused.
+    // Files are matched by name: a checkpoint clone keeps the file numbers,
+    // and its leaves may still point at the base's copy of the same file.
+    auto fileKey = [](const std::string& file) {
+        return std::filesystem::path(file).filename().string();
+    };
+    std::unordered_map<std::string, std::vector<Node*>> leavesByFile;
+    for (Node* leaf : hierarchy.leafNodes) {
+        leavesByFile[fileKey(leaf->filename)].push_back(leaf);
+    }
+
+    std::vector<std::string> newFiles;
+    std::unordered_set<std::string> liveFiles;
+    for (const auto& group : groups) {
+        for (const auto& file : group.files) {
+            liveFiles.insert(fileKey(file));
+            if (leavesByFile.find(fileKey(file)) == leavesByFile.end()) {
+                newFiles.push_back(file);
+            }
+        }
+    }
+
+    std::vector<std::vector<Node*>> newLeaves =
+        processSSTFiles(newFiles, partitionSize, hierarchy.getBloomSize(),
+                        hierarchy.getNumHashFunctions(), hierarchy.getTextMode(),
+                        hierarchy.getGramSize(), sketchWidth, sketchDepth,
+                        hierarchy.getFilterKind());
+    std::vector<Node*> createdLeaves;
+    for (size_t i = 0; i < newFiles.size(); ++i) {
+        leavesByFile[fileKey(newFiles[i])] = newLeaves[i];
+        createdLeaves.insert(createdLeaves.end(), newLeaves[i].begin(), newLeaves[i].end());
+    }
+    for (Node* leaf : createdLeaves) {
+        leaf->bloom.selectKernels(hierarchy.getProbeMode());
+    }
+
+    // rebuild internal nodes only for groups whose file set changed
+    std::vector<Node*> toFold = createdLeaves;
+    std::vector<Node*> retired;
+    std::unordered_set<Node*> keptRoots;
+    size_t rebuiltGroups = 0;
+    for (auto& group : groups) {
+        for (const auto& file : group.files) {
+            const auto& leaves = leavesByFile[fileKey(file)];
+            group.leaves.insert(group.leaves.end(), leaves.begin(), leaves.end());
+        }
+        for (const auto& old : hierarchy.levelGroups) {
+            if (old.firstLevel == group.firstLevel && old.lastLevel == group.lastLevel &&
+                old.files == group.files) {
+                group.root = old.root;
+                keptRoots.insert(old.root);
+                break;
+            }
+        }
+        if (!group.root) {
+            group.root = hierarchy.buildSubtree(group.leaves);
+            collectInternalNodes(group.root, toFold);
+            ++rebuiltGroups;
+        }
+    }
+    // new leaves fold once the parents have merged them at full size
+    hierarchy.foldFilters(toFold);
+    hierarchy.persistLeaves(createdLeaves);
+
+    for (const auto& old : hierarchy.levelGroups) {
+        if (keptRoots.count(old.root) == 0) {
+            collectInternalNodes(old.root, retired);
+        }
+    }
+    bool rootIsGroupRoot = false;
+    for (const auto& old : hierarchy.levelGroups) {
+        rootIsGroupRoot = rootIsGroupRoot || old.root == hierarchy.root;
+    }
+    if (hierarchy.root && !hierarchy.levelGroups.empty() && !rootIsGroupRoot) {
+        retired.push_back(hierarchy.root);  // previous top node
+    }
+    for (Node* leaf : hierarchy.leafNodes) {
+        if (liveFiles.count(fileKey(leaf->filename)) == 0) {
+            hierarchy.coMatches->forget(leaf);
+            if (hierarchy.ownsLeaf(leaf)) retired.push_back(leaf);
+        }
+    }
+
+    hierarchy.levelGroups = std::move(groups);
+    hierarchy.joinLevelGroups();
+
+    // the tree must not be queried concurrently with a refresh
+    hierarchy.retireNodes(retired);
+
+    sw.stop();
+    metrics().histogram("hdb_rebuild_micros", "Hierarchy build and rebuild durations",
+                        {{"kind", "refresh"}})
+        .observe(static_cast<double>(sw.elapsedMicros()));
+    spdlog::info(
+        "Level-aware hierarchy refreshed in {} µs: {} new SST files, {} of {} level groups rebuilt.",
+        sw.elapsedMicros(), newFiles.size(), rebuiltGroups, hierarchy.levelGroups.size());
+}
+
+std::future<BloomTree::Restructure> BloomManager::restructureHierarchyAsync(const BloomTree& hierarchy) {
+    auto promise = std::make_shared<std::promise<BloomTree::Restructure>>();
+    auto future = promise->get_future();
+
+    boost::asio::post(globalThreadPool, [&hierarchy, promise]() {
+        try {
+            StopWatch sw;
+            sw.start();
+            auto plan = hierarchy.planRestructure();
+            sw.stop();
+            metrics().histogram("hdb_rebuild_micros", "Hierarchy build and rebuild durations",
+                                {{"kind", "restructure"}})
+                .observe(static_cast<double>(sw.elapsedMicros()));
+            spdlog::info("Workload-adaptive restructure planned in {} µs.", sw.elapsedMicros());
+            promise->set_value(std::move(plan));
+        } catch (...) {
+            promise->set_exception(std::current_exception());
+        }
+    });
+    return future;
+}
+
+bool BloomManager::maybeRestructure(BloomTree& hierarchy, uint64_t minQueries) {
+    auto it = pendingRestructures.find(&hierarchy);
+    if (it != pendingRestructures.end()) {
+        if (it->second.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            return false;
+        }
+        return finishRestructure(hierarchy);
+    }
+    if (hierarchy.coMatches->recordedSinceDecay() < minQueries) return false;
+    pendingRestructures.emplace(&hierarchy, restructureHierarchyAsync(hierarchy));
+    return false;
+}
+
+bool BloomManager::finishRestructure(BloomTree& hierarchy) {
+    auto it = pendingRestructures.find(&hierarchy);
+    if (it == pendingRestructures.end()) return false;
+    std::future<BloomTree::Restructure> pending = std::move(it->second);
+    pendingRestructures.erase(it);
+    try {
+        hierarchy.installRestructure(pending.get());
+    } catch (const std::exception& e) {
+        spdlog::error("Workload-adaptive restructure failed: {}", e.what());
+        return false;
+    }
+    spdlog::info("Workload-adaptive restructure installed.");
+    return true;
+}
@@ -0,0 +1,170 @@
+#include "dataset_manager.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <filesystem>
+#include <stdexcept>
+#include <unordered_set>
+
+#include "exp_utils.hpp"
+#include "stopwatch.hpp"
+
+extern void clearBloomFilterFiles(const std::string& dbDir);
+
+DatasetManager::DatasetManager(const TestParams& params,
+                               std::vector<std::string> columns, int hotLevels)
+    : params_(params), columns_(std::move(columns)), hotLevels_(hotLevels) {}
+
+DatasetManager::~DatasetManager() { close(); }
+
+void DatasetManager::open() {
+  StopWatch sw;
+  sw.start();
+  clearBloomFilterFiles(params_.dbName);
+  base_.openDB(params_.dbName, columns_);
+  // clones share the base leaves, which read the base's SST files
+  auto s = base_.disableFileDeletions();
+  if (!s.ok()) {
+    spdlog::warn("DatasetManager: could not pin SSTs of '{}': {}",
+                 params_.dbName, s.ToString());
+  }
+  sw.stop();
+  spdlog::info("DatasetManager: base '{}' opened in {} µs.", params_.dbName,
+               sw.elapsedMicros());
+}
+
+void DatasetManager::buildBaseHierarchies() {
+  if (!baseHierarchies_.empty()) return;
+  if (!base_.isOpen()) throw std::runtime_error("DatasetManager not open.");
+  StopWatch sw;
+  sw.start();
+  for (const auto& column : columns_) {
+    BloomTree hierarchy = bloomManager_.createLevelAwareHierarchy(
+        base_.scanSSTFilesByLevel(params_.dbName, column),
+        params_.itemsPerPartition, params_.bloomSize, params_.numHashFunctions,
+        params_.bloomTreeRatio, hotLevels_, TextFilterMode::None,
+        params_.ngramSize, params_.sketchWidth, params_.sketchDepth,
+        params_.foldTargetFpr, params_.filterKind);
+    if (params_.probeMode != ProbeMode::EarlyExit) {
+      hierarchy.setProbeMode(params_.probeMode);
+    }
+    hierarchy.dictionary = base_.columnDictionary(column);
+    baseHierarchies_.try_emplace(column, std::move(hierarchy));
+  }
+  sw.stop();
+  spdlog::info("DatasetManager: base hierarchies of '{}' ready in {} µs.",
+               params_.dbName, sw.elapsedMicros());
+}
+
+void DatasetManager::close() {
+  for (auto& [column, hierarchy] : baseHierarchies_) {
+    hierarchy.deleteNodes();
+  }
+  baseHierarchies_.clear();
+  if (base_.isOpen()) {
+    base_.enableFileDeletions();
+    base_.closeDB();
+  }
+}
+
+// The base leaves, shared rather than copied, and no internal levels; the
+// refresh that follows builds those and reads only the clone's new files.
+// Shared leaves keep the base's file paths, which the base keeps pinned.
+BloomTree DatasetManager::shareHierarchy(const BloomTree& base,
+                                         const std::string& clonePath) const {
+  BloomTree clone = base;
+  clone.root = nullptr;
+  clone.coMatches = std::make_shared<CoMatchStats>();
+  clone.generation = std::make_shared<BloomTree::RetiredNodes>();
+  clone.borrowedLeaves = std::make_shared<const std::unordered_set<const Node*>>(
+      base.leafNodes.begin(), base.leafNodes.end());
+  for (auto& group : clone.levelGroups) {
+    for (auto& file : group.files) {
+      if (file.compare(0, params_.dbName.size(), params_.dbName) == 0) {
+        file = clonePath + file.substr(params_.dbName.size());
+      }
+    }
+    group.leaves.clear();
+    group.root = nullptr;
+  }
+  return clone;
+}
+
+std::unique_ptr<DatasetClone> DatasetManager::createClone(
+    const std::vector<std::tuple<std::string, std::string, std::string>>&
+        modifications,
+    CloneLayout layout) {
+  if (!base_.isOpen()) throw std::runtime_error("DatasetManager not open.");
+
+  StopWatch sw;
+  sw.start();
+  auto clone = std::make_unique<DatasetClone>();
+  clone->path = params_.dbName + "_clone_" + std::to_string(nextCloneId_++);
+  std::filesystem::remove_all(clone->path);
+
+  auto s = base_.createCheckpoint(clone->path);
+  if (!s.ok()) {
+    throw std::runtime_error("Failed to checkpoint '" + params_.dbName +
+                             "': " + s.ToString());
+  }
+  clone->db.openDB(clone->path, columns_);
+
+  if (layout == CloneLayout::Compacted) {
+    s = clone->db.applyModifications(modifications, params_.numRecords);
+    if (!s.ok()) {
+      releaseClone(std::move(clone));
+      throw std::runtime_error("Failed to modify clone: " + s.ToString());
+    }
+    TestParams cloneParams = params_;
+    cloneParams.dbName = clone->path;
+    clone->hierarchies =
+        buildHierarchies(scanSstFilesAsync(columns_, clone->db, cloneParams),
+                         bloomManager_, cloneParams, &clone->db);
+    sw.stop();
+    spdlog::info(
+        "DatasetManager: compacted clone '{}' with {} modifications ready in "
+        "{} µs.",
+        clone->path, modifications.size(), sw.elapsedMicros());
+    return clone;
+  }
+
+  s = clone->db.writeModifications(modifications);
+  if (!s.ok()) {
+    releaseClone(std::move(clone));
+    throw std::runtime_error("Failed to modify clone: " + s.ToString());
+  }
+  clone->db.flushAllColumnFamilies();
+
+  buildBaseHierarchies();
+  for (const auto& [column, base] : baseHierarchies_) {
+    BloomTree hierarchy = shareHierarchy(base, clone->path);
+    bloomManager_.refreshLevelAwareHierarchy(
+        hierarchy, clone->db.scanSSTFilesByLevel(clone->path, column),
+        params_.itemsPerPartition, hotLevels_, params_.sketchWidth,
+        params_.sketchDepth);
+    // the clone's dictionary may have grown with the modifications
+    hierarchy.dictionary = clone->db.columnDictionary(column);
+    clone->hierarchies.try_emplace(column, std::move(hierarchy));
+  }
+
+  sw.stop();
+  spdlog::info("DatasetManager: clone '{}' with {} modifications ready in {} µs.",
+               clone->path, modifications.size(), sw.elapsedMicros());
+  return clone;
+}
+
+void DatasetManager::releaseClone(std::unique_ptr<DatasetClone> clone) {
+  if (!clone) return;
+  for (auto& [column, hierarchy] : clone->hierarchies) {
+    hierarchy.deleteNodes();
+  }
+  clone->hierarchies.clear();
+  if (clone->db.isOpen()) clone->db.closeDB();
+
+  std::error_code ec;
+  std::filesystem::remove_all(clone->path, ec);
+  if (ec) {
+    spdlog::error("DatasetManager: could not remove clone '{}': {}",
+                  clone->path, ec.message());
+  }
+}
@@ -6,65 +6,221 @@
 #include <rocksdb/sst_file_reader.h>
 #include <rocksdb/status.h>
 #include <rocksdb/table_properties.h>
+#include <rocksdb/utilities/checkpoint.h>
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
 #include <boost/asio/post.hpp>
 #include <boost/asio/thread_pool.hpp>
+#include <chrono>
 #include <filesystem>
 #include <future>
+#include <mutex>
 #include <random>
 #include <stdexcept>
+#include <thread>
 #include <unordered_set>
 
 #include "algorithm.hpp"
+#include "memory_accounting.hpp"
+#include "metrics.hpp"
+#include "perf_counters.hpp"
+#include "sst_boundaries.hpp"
 #include "stopwatch.hpp"
 
 extern boost::asio::thread_pool globalThreadPool;
 
-void DBManager::compactAllColumnFamilies(size_t numRecords) {
-  if (!db_) throw std::runtime_error("DB not open");
+Counter& sstReaderOpens() {
+  static Counter& opens =
+      metrics().counter("hdb_sst_reader_opens_total", "SST readers opened");
+  return opens;
+}
+
+Counter& sstReaderOpenMicros() {
+  static Counter& openMicros = metrics().counter(
+      "hdb_sst_reader_open_micros_total", "Time spent opening SST readers");
+  return openMicros;
+}
+
+static rocksdb::Status openSstReader(rocksdb::SstFileReader& reader,
+                                     const std::string& filename) {
+  auto begin = std::chrono::steady_clock::now();
+  rocksdb::Status status = reader.Open(filename);
+  auto micros = std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - begin)
+                    .count();
+  sstReaderOpens().inc();
+  sstReaderOpenMicros().inc(static_cast<uint64_t>(micros));
+  return status;
+}
+
+CompactionSettings CompactionSettings::parallel() {
+  CompactionSettings settings;
+  settings.parallelism = 0;
+  settings.maxSubcompactions = 4;
+  settings.exclusiveManualCompaction = false;
+  settings.bottommostLevelCompaction =
+      rocksdb::BottommostLevelCompaction::kForceOptimized;
+  settings.backgroundJobs =
+      static_cast<int>(std::max(2u, std::thread::hardware_concurrency()));
+  return settings;
+}
+
+bool DBManager::compactColumnFamily(const std::string& column,
+                                    rocksdb::ColumnFamilyHandle* handle,
+                                    size_t numRecords,
+                                    const CompactionSettings& settings) {
+  uint64_t previousTargetFileSize = 0;
+  if (settings.targetFileSizeBase > 0) {
+    previousTargetFileSize = db_->GetOptions(handle).target_file_size_base;
+    auto s_opt = db_->SetOptions(
+        handle, {{"target_file_size_base",
+                  std::to_string(settings.targetFileSizeBase)}});
+    if (!s_opt.ok()) {
+      spdlog::warn("Could not set target_file_size_base for CF '{}': {}",
+                   column, s_opt.ToString());
+      previousTargetFileSize = 0;
+    }
+  }
+  bool ok = compactRange(column, handle, numRecords, settings);
+  if (previousTargetFileSize > 0) {
+    auto s_opt = db_->SetOptions(
+        handle, {{"target_file_size_base",
+                  std::to_string(previousTargetFileSize)}});
+    if (!s_opt.ok()) {
+      spdlog::warn("Could not restore target_file_size_base for CF '{}': {}",
+                   column, s_opt.ToString());
+    }
+  }
+  return ok;
+}
+
+bool DBManager::compactRange(const std::string& column,
+                             rocksdb::ColumnFamilyHandle* handle,
+                             size_t numRecords,
+                             const CompactionSettings& settings) {
   rocksdb::CompactRangeOptions opts;
+  opts.exclusive_manual_compaction = settings.exclusiveManualCompaction;
+  opts.max_subcompactions = settings.maxSubcompactions;
+  opts.bottommost_level_compaction = settings.bottommostLevelCompaction;
+
+  if (numRecords > 0) {
+    rocksdb::Slice begin;
+    const std::string index_str = std::to_string(numRecords);
+    const std::string prefixedIndex =
+        std::string(20 - index_str.size(), '0') + index_str;
+    const std::string endKeyStr = "key" + prefixedIndex;
+    rocksdb::Slice end(endKeyStr);
+
+    spdlog::info("Starting ranged compaction for CF '{}' up to key '{}'", column, endKeyStr);
+    auto status = db_->CompactRange(opts, handle, &begin, &end);
+    if (!status.ok()) {
+      spdlog::error("Ranged compaction failed for CF '{}': {}", column, status.ToString());
+      return false;
+    }
+    spdlog::debug("Ranged compaction succeeded for CF '{}'", column);
+    return true;
+  }
+
+  spdlog::info("Starting full compaction for CF '{}'", column);
+  auto status = db_->CompactRange(opts, handle, nullptr, nullptr);
+  if (!status.ok()) {
+    spdlog::error("Full compaction failed for CF '{}': {}", column, status.ToString());
+    return false;
+  }
+  spdlog::info("Full compaction succeeded for CF '{}'", column);
+  return true;
+}
+
+void DBManager::compactAllColumnFamilies(
+    size_t numRecords, const CompactionSettings& settings,
+    const CompactionProgressCallback& progress) {
+  if (!db_) throw std::runtime_error("DB not open");
+  StopWatch total;
+  total.start();
 
   auto s_enable_del = db_->EnableFileDeletions();
   if (!s_enable_del.ok()) {
       spdlog::warn("Failed to ensure file deletions are enabled: {}. DB size may grow.", s_enable_del.ToString());
   }
 
+  int previousBackgroundJobs = 0;
+  if (settings.backgroundJobs > 0) {
+    previousBackgroundJobs = db_->GetDBOptions().max_background_jobs;
+    auto s_opt = db_->SetDBOptions(
+        {{"max_background_jobs", std::to_string(settings.backgroundJobs)}});
+    if (!s_opt.ok()) {
+      spdlog::warn("Could not set max_background_jobs: {}", s_opt.ToString());
+      previousBackgroundJobs = 0;
+    }
+  }
+
+  std::vector<std::pair<std::string, rocksdb::ColumnFamilyHandle*>> columns;
   for (auto& kv : cf_handles_) {
-    auto* handle = kv.second.get();
-    auto s_flush = db_->Flush(rocksdb::FlushOptions(), handle);
-    if (!s_flush.ok()) {
-        spdlog::error("Flush failed for CF '{}': {}. Skipping compaction for this CF.", kv.first, s_flush.ToString());
-        continue;
-    }
-
-    rocksdb::Slice begin, end;
-    std::string endKeyStr;
-
-    if (numRecords > 0) {
-      begin = rocksdb::Slice();
-      const std::string index_str = std::to_string(numRecords);
-      const std::string prefixedIndex =
-          std::string(20 - index_str.size(), '0') + index_str;
-      endKeyStr = "key" + prefixedIndex;
-      end = rocksdb::Slice(endKeyStr);
-      
-      spdlog::info("Starting ranged compaction for CF '{}' up to key '{}'", kv.first, endKeyStr);
-      auto status = db_->CompactRange(opts, handle, &begin, &end);
-      if (!status.ok()) {
-        spdlog::error("Ranged compaction failed for CF '{}': {}", kv.first, status.ToString());
-      } else {
-        spdlog::debug("Ranged compaction succeeded for CF '{}'", kv.first);
-      }
-    } else {
-      spdlog::info("Starting full compaction for CF '{}'", kv.first);
-      auto status = db_->CompactRange(opts, handle, nullptr, nullptr);
-      if (!status.ok()) {
-        spdlog::error("Full compaction failed for CF '{}': {}", kv.first, status.ToString());
-      } else {
-        spdlog::info("Full compaction succeeded for CF '{}'", kv.first);
-      }
+    columns.emplace_back(kv.first, kv.second.get());
+  }
+  const size_t wave =
+      settings.parallelism == 0 ? columns.size() : settings.parallelism;
+
+  std::mutex progressMutex;
+  size_t completed = 0;
+
+  // CompactRange blocks until RocksDB's background threads finish the job,
+  // so each CF gets its own thread rather than a globalThreadPool slot.
+  for (size_t first = 0; first < columns.size(); first += wave) {
+    size_t last = std::min(first + wave, columns.size());
+    std::vector<std::future<void>> futures;
+    futures.reserve(last - first);
+
+    for (size_t i = first; i < last; ++i) {
+      futures.emplace_back(std::async(std::launch::async, [&, i]() {
+        const auto& [column, handle] = columns[i];
+        // sizes and throughput cover the compaction, the memtable is
+        // flushed first
+        auto s_flush = db_->Flush(rocksdb::FlushOptions(), handle);
+        if (!s_flush.ok()) {
+          spdlog::error(
+              "Flush failed for CF '{}': {}. Skipping compaction for this CF.",
+              column, s_flush.ToString());
+        }
+        rocksdb::ColumnFamilyMetaData before;
+        db_->GetColumnFamilyMetaData(handle, &before);
+
+        StopWatch sw;
+        sw.start();
+        bool ok = s_flush.ok() &&
+                  compactColumnFamily(column, handle, numRecords, settings);
+        sw.stop();
+
+        rocksdb::ColumnFamilyMetaData after;
+        db_->GetColumnFamilyMetaData(handle, &after);
+
+        CompactionProgress p;
+        p.column = column;
+        p.total = columns.size();
+        p.ok = ok;
+        p.elapsedMicros = sw.elapsedMicros();
+        p.bytesBefore = before.size;
+        p.bytesAfter = after.size;
+        p.mbPerSec = p.elapsedMicros > 0
+                         ? static_cast<double>(p.bytesBefore) /
+                               static_cast<double>(p.elapsedMicros)
+                         : 0.0;
+
+        std::lock_guard<std::mutex> lock(progressMutex);
+        p.completed = ++completed;
+        if (progress) {
+          progress(p);
+        } else {
+          spdlog::info(
+              "Compaction {}/{}: CF '{}' {} in {} µs, {} -> {} bytes ({:.2f} "
+              "MB/s)",
+              p.completed, p.total, p.column, p.ok ? "done" : "failed",
+              p.elapsedMicros, p.bytesBefore, p.bytesAfter, p.mbPerSec);
+        }
+      }));
     }
+    for (auto& fut : futures) fut.get();
   }
 
   spdlog::info("Waiting for all background compactions to finish across the DB...");
@@ -76,6 +232,19 @@ void DBManager::compactAllColumnFamilies(size_t numRecords) {
   } else {
     spdlog::info("All background compactions finished successfully.");
   }
+
+  if (previousBackgroundJobs > 0) {
+    auto s_opt = db_->SetDBOptions(
+        {{"max_background_jobs", std::to_string(previousBackgroundJobs)}});
+    if (!s_opt.ok()) {
+      spdlog::warn("Could not restore max_background_jobs: {}",
+                   s_opt.ToString());
+    }
+  }
+
+  total.stop();
+  spdlog::critical("Compacted {} column families in {} µs.", columns.size(),
+                   total.elapsedMicros());
 }
 
 void DBManager::openDB(const std::string& dbname,
@@ -94,9 +263,15 @@ void DBManager::openDB(const std::string& dbname,
 
   std::vector<std::string> cf_names = columns;
   cf_names.push_back("default");
+  cf_names.push_back(kDictionaryColumn);
+  cf_names.push_back(kIndexColumn);
+  // boundary samples let hierarchy builds split large SSTs across threads
+  rocksdb::ColumnFamilyOptions cfOptions;
+  cfOptions.table_properties_collector_factories.push_back(
+      std::make_shared<BoundarySampleCollectorFactory>());
   std::vector<rocksdb::ColumnFamilyDescriptor> cf_descriptors;
   for (const auto& name : cf_names) {
-    cf_descriptors.emplace_back(name, rocksdb::ColumnFamilyOptions());
+    cf_descriptors.emplace_back(name, cfOptions);
   }
 
   std::vector<rocksdb::ColumnFamilyHandle*> cf_handles_raw;
@@ -116,14 +291,16 @@ void DBManager::openDB(const std::string& dbname,
   for (size_t i = 0; i < cf_names.size(); ++i) {
     cf_handles_[cf_names[i]].reset(cf_handles_raw[i]);
   }
+  loadDictionaries();
+  loadIndexedColumns();
 
   sw.stop();
   spdlog::critical("RocksDB opened at path: {} with CFs, took {} µs", dbname,
                    sw.elapsedMicros());
 }
 
-void DBManager::insertRecords(int numRecords,
-                              std::vector<std::string> columns) {
+void DBManager::insertRecords(int numRecords, std::vector<std::string> columns,
+                              size_t cardinality) {
   if (!db_) throw std::runtime_error("DB not open.");
 
   StopWatch sw;
@@ -131,7 +308,7 @@ void DBManager::insertRecords(int numRecords,
   spdlog::info("Inserting {} records across {} CFs...", numRecords,
                columns.size());
 
-  rocksdb::WriteBatch batch;
+  StagedBatch staged;
   for (int i = 1; i <= numRecords; ++i) {
     // prefix index with 0s to ensure lexicographical order based on numRecords
     // size
@@ -140,22 +317,22 @@ void DBManager::insertRecords(int numRecords,
         std::string(20 - index.size(), '0') + std::to_string(i);
 
     const std::string key = "key" + prefixedIndex;
+    const std::string valueIndex =
+        cardinality > 0 ? std::to_string((i - 1) % cardinality + 1) : index;
     for (const auto& column : columns) {
-      const std::string value = column + "_value" + index;
-      auto handle = cf_handles_.at(column).get();
-      batch.Put(handle, key, value);
+      const std::string value = column + "_value" + valueIndex;
+      putColumnValue(column, key, value, staged, false);
     }
     if (i % 1000000 == 0) {
-      auto s = db_->Write(rocksdb::WriteOptions(), &batch);
+      auto s = writeBatch(staged);
       if (!s.ok())
         throw std::runtime_error("Batch write failed: " + s.ToString());
-      batch.Clear();
       spdlog::debug("Inserted {} records...", i);
     }
   }
 
-  if (batch.Count() > 0) {
-    auto s = db_->Write(rocksdb::WriteOptions(), &batch);
+  if (staged.batch.Count() > 0) {
+    auto s = writeBatch(staged);
     if (!s.ok())
       throw std::runtime_error("Final batch write failed: " + s.ToString());
   }
@@ -181,7 +358,7 @@ void DBManager::insertRecordsWithSearchTargets(
   spdlog::info("Inserting {} records across {} CFs... with {} search targets",
                numRecords, columns.size(), targetIndices.size());
 
-  rocksdb::WriteBatch batch;
+  StagedBatch staged;
   for (int i = 1; i <= numRecords; ++i) {
     bool isTarget = targetIndices.find(i) != targetIndices.end();
 
@@ -193,7 +370,6 @@ void DBManager::insertRecordsWithSearchTargets(
 
     const std::string key = "key" + prefixedIndex;
     for (const auto& column : columns) {
-      auto handle = cf_handles_.at(column).get();
       std::string value;
 
       if (isTarget) {
@@ -203,19 +379,18 @@ void DBManager::insertRecordsWithSearchTargets(
         value = column + "_value" + index;
       }
 
-      batch.Put(handle, key, value);
+      putColumnValue(column, key, value, staged, false);
     }
     if (i % 1000000 == 0) {
-      auto s = db_->Write(rocksdb::WriteOptions(), &batch);
+      auto s = writeBatch(staged);
       if (!s.ok())
         throw std::runtime_error("Batch write failed: " + s.ToString());
-      batch.Clear();
       spdlog::debug("Inserted {} records...", i);
     }
   }
 
-  if (batch.Count() > 0) {
-    auto s = db_->Write(rocksdb::WriteOptions(), &batch);
+  if (staged.batch.Count() > 0) {
+    auto s = writeBatch(staged);
     if (!s.ok())
       throw std::runtime_error("Final batch write failed: " + s.ToString());
   }
@@ -251,6 +426,28 @@ std::vector<std::string> DBManager::scanSSTFilesForColumn(
   return sst_files;
 }
 
+std::vector<std::vector<std::string>> DBManager::scanSSTFilesByLevel(
+    const std::string& dbname, const std::string& column) {
+  if (!db_) throw std::runtime_error("DB not open.");
+  if (cf_handles_.find(column) == cf_handles_.end())
+    throw std::runtime_error("Unknown Column Family: " + column);
+
+  rocksdb::ColumnFamilyMetaData meta;
+  db_->GetColumnFamilyMetaData(cf_handles_[column].get(), &meta);
+
+  std::vector<std::vector<std::string>> filesByLevel;
+  for (const auto& level : meta.levels) {
+    if (level.level >= static_cast<int>(filesByLevel.size())) {
+      filesByLevel.resize(level.level + 1);
+    }
+    for (const auto& file : level.files) {
+      filesByLevel[level.level].push_back(dbname + file.name);
+    }
+  }
+
+  return filesByLevel;
+}
+
 bool DBManager::checkValueWithoutBloomFilters(const std::string& value) {
   StopWatch sw;
   sw.start();
@@ -290,6 +487,11 @@ rocksdb::Status DBManager::closeDB() {
 
   if (db_) {
     cf_handles_.clear();  // Automatically deletes handles
+    dictionaries_.clear();
+    {
+      std::unique_lock<std::shared_mutex> lock(indexedColumnsMtx_);
+      indexedColumns_.clear();
+    }
     db_.reset();
     spdlog::debug("DB closed with Column Families.");
   }
@@ -307,7 +509,7 @@ bool DBManager::ScanFileForValue(const std::string& filename,
   options.env = rocksdb::Env::Default();
 
   rocksdb::SstFileReader reader(options);
-  rocksdb::Status status = reader.Open(filename);
+  rocksdb::Status status = openSstReader(reader, filename);
   if (!status.ok()) {
     throw std::runtime_error("Failed to open SSTable: " + status.ToString());
   }
@@ -351,13 +553,14 @@ bool DBManager::noBloomcheckValueInColumn(const std::string& column,
 
   rocksdb::ReadOptions readOptions;
   readOptions.fill_cache = false;
+  const std::string stored = queryValue(column, value);
 
   auto iter = std::unique_ptr<rocksdb::Iterator>(
       db_->NewIterator(readOptions, cf_it->second.get()));
 
   sw.start();
   for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
-    if (iter->value().ToString() == value) {
+    if (iter->value() == stored) {
       sw.stop();
       // spdlog::info("Found '{}...' in column '{}' in {} µs.", value.substr(0,
       // 30), column, sw.elapsedMicros());
@@ -379,10 +582,14 @@ std::vector<std::string> DBManager::scanForRecordsInColumns(
         "Number of columns and values must be equal and non-empty.");
   }
 
+  static QueryPlanMetrics planMetrics("scan");
+  QueryMetricsScope queryMetrics(planMetrics);
+  MemoryTagScope memoryTag(MemoryTag::QueryScratch);
   StopWatch sw;
   sw.start();
 
   std::vector<std::string> matchingKeys;
+  const std::vector<std::string> stored = queryValues(columns, values);
 
   // Use the first column as the base for scanning.
   auto baseIt = cf_handles_.find(columns[0]);
@@ -412,7 +619,7 @@ std::vector<std::string> DBManager::scanForRecordsInColumns(
       std::string candidateValue;
       auto status =
           db_->Get(readOptions, cfIt->second.get(), key, &candidateValue);
-      if (!status.ok() || candidateValue != values[i]) {
+      if (!status.ok() || candidateValue != stored[i]) {
         allMatch = false;
         break;
       }
@@ -438,7 +645,7 @@ std::vector<std::string> DBManager::scanFileForKeysWithValue(
   options.env = rocksdb::Env::Default();
 
   rocksdb::SstFileReader reader(options);
-  auto status = reader.Open(filename);
+  auto status = openSstReader(reader, filename);
   if (!status.ok()) {
     spdlog::error("Failed to open SSTable '{}': {}", filename,
                   status.ToString());
@@ -460,7 +667,8 @@ std::vector<std::string> DBManager::scanFileForKeysWithValue(
     std::string currentKey = iter->key().ToString();
     if (!rangeEnd.empty() && currentKey > rangeEnd) break;
 
-    if (iter->value().ToString() == value) {
+    // no copy of the value; with dictionary codes this is a 4-byte compare
+    if (iter->value() == value) {
       matchingKeys.push_back(currentKey);
     }
     iter->Next();
@@ -469,13 +677,222 @@ std::vector<std::string> DBManager::scanFileForKeysWithValue(
   return matchingKeys;
 }
 
+std::vector<std::string> DBManager::scanFileForKeysInValueRange(
+    const std::string& filename, const std::string& low,
+    const std::string& high, const std::string& rangeStart,
+    const std::string& rangeEnd) {
+  std::vector<std::string> matchingKeys;
+  rocksdb::Options options;
+  options.env = rocksdb::Env::Default();
+
+  rocksdb::SstFileReader reader(options);
+  auto status = openSstReader(reader, filename);
+  if (!status.ok()) {
+    spdlog::error("Failed to open SSTable '{}': {}", filename,
+                  status.ToString());
+    return {};
+  }
+
+  rocksdb::ReadOptions readOptions;
+  readOptions.fill_cache = false;
+
+  auto iter =
+      std::unique_ptr<rocksdb::Iterator>(reader.NewIterator(readOptions));
+  if (!rangeStart.empty()) {
+    iter->Seek(rangeStart);
+  } else {
+    iter->SeekToFirst();
+  }
+
+  while (iter->Valid()) {
+    std::string currentKey = iter->key().ToString();
+    if (!rangeEnd.empty() && currentKey > rangeEnd) break;
+
+    std::string currentValue = iter->value().ToString();
+    if (currentValue >= low && currentValue <= high) {
+      matchingKeys.push_back(currentKey);
+    }
+    iter->Next();
+  }
+
+  return matchingKeys;
+}
+
+std::vector<std::string> DBManager::scanFileForKeysMatchingText(
+    const std::string& filename, const std::string& pattern, bool prefixOnly,
+    const std::string& rangeStart, const std::string& rangeEnd) {
+  std::vector<std::string> matchingKeys;
+  rocksdb::Options options;
+  options.env = rocksdb::Env::Default();
+
+  rocksdb::SstFileReader reader(options);
+  auto status = openSstReader(reader, filename);
+  if (!status.ok()) {
+    spdlog::error("Failed to open SSTable '{}': {}", filename,
+                  status.ToString());
+    return {};
+  }
+
+  rocksdb::ReadOptions readOptions;
+  readOptions.fill_cache = false;
+
+  auto iter =
+      std::unique_ptr<rocksdb::Iterator>(reader.NewIterator(readOptions));
+  if (!rangeStart.empty()) {
+    iter->Seek(rangeStart);
+  } else {
+    iter->SeekToFirst();
+  }
+
+  while (iter->Valid()) {
+    std::string currentKey = iter->key().ToString();
+    if (!rangeEnd.empty() && currentKey > rangeEnd) break;
+
+    if (textMatches(iter->value().ToString(), pattern, prefixOnly)) {
+      matchingKeys.push_back(currentKey);
+    }
+    iter->Next();
+  }
+
+  return matchingKeys;
+}
+
+std::vector<std::string> DBManager::scanCandidatePartitions(
+    const std::vector<const Node*>& candidates, const std::string& startKey,
+    const std::string& endKey, const PartitionScanFn& scan) {
+  countSstChecks(candidates.size());
+
+  std::vector<std::future<std::vector<std::string>>> futures;
+  futures.reserve(candidates.size());
+
+  for (const auto* candidate : candidates) {
+    std::promise<std::vector<std::string>> promise;
+    futures.emplace_back(promise.get_future());
+
+    std::string filename = candidate->filename;
+    std::string scanStart =
+        startKey.empty() ? candidate->startKey
+                         : std::max(startKey, candidate->startKey);
+    std::string scanEnd =
+        endKey.empty() ? candidate->endKey : std::min(endKey, candidate->endKey);
+
+    ++gPoolQueuedTasks;
+    boost::asio::post(globalThreadPool,
+                      [&scan, filename, scanStart, scanEnd,
+                       p = std::move(promise)]() mutable {
+                        --gPoolQueuedTasks;
+                        PerfScope perf(PerfPhase::Scan);
+                        MemoryTagScope memoryTag(MemoryTag::QueryScratch);
+                        try {
+                          p.set_value(scan(filename, scanStart, scanEnd));
+                        } catch (...) {
+                          p.set_exception(std::current_exception());
+                        }
+                      });
+  }
+
+  MemoryTagScope resultTag(MemoryTag::Results);
+  std::vector<std::string> matchingKeys;
+  for (auto& fut : futures) {
+    try {
+      std::vector<std::string> keys = fut.get();
+      matchingKeys.insert(matchingKeys.end(), keys.begin(), keys.end());
+    } catch (const std::exception& e) {
+      spdlog::error("Exception during parallel SST scan: {}", e.what());
+    }
+  }
+  return matchingKeys;
+}
+
+std::vector<std::string> DBManager::findKeysInValueRange(
+    BloomTree& hierarchy, const std::string& low, const std::string& high,
+    const std::string& startKey, const std::string& endKey) {
+  static QueryPlanMetrics planMetrics("range");
+  QueryMetricsScope queryMetrics(planMetrics);
+  if (hierarchy.dictionary) {
+    throw std::runtime_error(
+        "Range predicates are not supported on dictionary-encoded columns.");
+  }
+  StopWatch sw;
+  sw.start();
+
+  std::vector<const Node*> candidates =
+      hierarchy.queryRangeNodes(low, high, startKey, endKey);
+  if (candidates.empty()) {
+    spdlog::info("No zone map in the hierarchy overlaps ['{}', '{}'].", low,
+                 high);
+    return {};
+  }
+
+  std::vector<std::string> matchingKeys = scanCandidatePartitions(
+      candidates, startKey, endKey,
+      [this, &low, &high](const std::string& filename,
+                          const std::string& scanStart,
+                          const std::string& scanEnd) {
+        return scanFileForKeysInValueRange(filename, low, high, scanStart,
+                                           scanEnd);
+      });
+
+  sw.stop();
+  spdlog::critical(
+      "Range query ['{}', '{}'] took {} µs, scanned {} partitions, found {} "
+      "keys.",
+      low, high, sw.elapsedMicros(), candidates.size(), matchingKeys.size());
+  return matchingKeys;
+}
+
+std::vector<std::string> DBManager::findKeysMatchingText(
+    BloomTree& hierarchy, const std::string& pattern, bool prefixOnly,
+    const std::string& startKey, const std::string& endKey) {
+  static QueryPlanMetrics planMetrics("text");
+  QueryMetricsScope queryMetrics(planMetrics);
+  if (hierarchy.dictionary) {
+    throw std::runtime_error(
+        "Text predicates are not supported on dictionary-encoded columns.");
+  }
+  StopWatch sw;
+  sw.start();
+
+  if (hierarchy.getTextMode() == TextFilterMode::None) {
+    spdlog::warn(
+        "Hierarchy has no text filter, '{}' will scan every partition in "
+        "range.",
+        pattern);
+  }
+
+  std::vector<const Node*> candidates =
+      hierarchy.queryTextNodes(pattern, prefixOnly, startKey, endKey);
+  if (candidates.empty()) {
+    spdlog::info("No candidates found in the hierarchy for pattern '{}'.",
+                 pattern);
+    return {};
+  }
+
+  std::vector<std::string> matchingKeys = scanCandidatePartitions(
+      candidates, startKey, endKey,
+      [this, &pattern, prefixOnly](const std::string& filename,
+                                   const std::string& scanStart,
+                                   const std::string& scanEnd) {
+        return scanFileForKeysMatchingText(filename, pattern, prefixOnly,
+                                           scanStart, scanEnd);
+      });
+
+  sw.stop();
+  spdlog::critical(
+      "Text query '{}' ({}) took {} µs, scanned {} partitions, found {} keys.",
+      pattern, prefixOnly ? "prefix" : "substring", sw.elapsedMicros(),
+      candidates.size(), matchingKeys.size());
+  return matchingKeys;
+}
+
 bool DBManager::findRecordInHierarchy(BloomTree& hierarchy,
-                                      const std::string& value,
+                                      const std::string& queryVal,
                                       const std::string& startKey,
                                       const std::string& endKey) {
   StopWatch sw;
   sw.start();
 
+  const std::string value = hierarchy.encodeQueryValue(queryVal);
   auto candidates = hierarchy.query(value, startKey, endKey);
   if (candidates.empty()) {
     spdlog::info("No candidates found in the hierarchy for '{}'.", value);
@@ -524,18 +941,63 @@ bool DBManager::findRecordInHierarchy(BloomTree& hierarchy,
   return false;
 }
 
+bool DBManager::keyMatchesColumns(const std::string& key,
+                                  const std::vector<std::string>& columns,
+                                  const std::vector<std::string>& values,
+                                  size_t firstColumn) {
+  rocksdb::ReadOptions readOptionsLocal;
+  readOptionsLocal.fill_cache = false;
+
+  for (size_t i = firstColumn; i < columns.size(); ++i) {
+    auto cf_it = cf_handles_.find(columns[i]);
+    if (cf_it == cf_handles_.end()) {
+      spdlog::warn(
+          "Column Family {} not found for key {} during Get operation in "
+          "findUsingSingleHierarchy.",
+          columns[i], key);
+      return false;
+    }
+    rocksdb::ColumnFamilyHandle* handle = cf_it->second.get();
+    std::string actual_value;
+    auto status = db_->Get(readOptionsLocal, handle, key, &actual_value);
+
+    if (!status.ok()) {
+      if (status.IsNotFound()) {
+        spdlog::debug("Key {} not found in column {} during Get operation.",
+                      key, columns[i]);
+      } else {
+        spdlog::warn("RocksDB Get failed for key {} in column {}: {}", key,
+                     columns[i], status.ToString());
+      }
+      return false;
+    }
+    if (actual_value != values[i]) return false;
+  }
+  return true;
+}
+
 std::vector<std::string> DBManager::findUsingSingleHierarchy(
     BloomTree& hierarchy, const std::vector<std::string>& columns,
-    const std::vector<std::string>& values) {
-  if (columns.size() != values.size() || columns.empty()) {
+    const std::vector<std::string>& queryVals, const std::string& startKey,
+    const std::string& endKey) {
+  if (columns.size() != queryVals.size() || columns.empty()) {
     throw std::runtime_error(
         "Number of columns and values must be equal and non-empty.");
   }
+  const std::vector<std::string> values = queryValues(columns, queryVals);
 
+  static QueryPlanMetrics planMetrics("single");
+  QueryMetricsScope queryMetrics(planMetrics);
+  QueryCounters counters;
+  QueryCounterScope countScope(counters);
   StopWatch sw;
   sw.start();
 
-  std::vector<const Node*> candidates = hierarchy.queryNodes(values[0], "", "");
+  std::vector<const Node*> candidates;
+  {
+    PerfScope perf(PerfPhase::Filter);
+    candidates = hierarchy.queryNodes(values[0], startKey, endKey);
+  }
   if (candidates.empty()) {
     spdlog::info("No candidates found in the hierarchy for '{}'.", values[0]);
     return {};
@@ -544,14 +1006,12 @@ std::vector<std::string> DBManager::findUsingSingleHierarchy(
   std::vector<std::string> allKeys;
 
   // Count SSTable checks
-  extern std::atomic<size_t> gSSTCheckCount;
-  gSSTCheckCount.store(0);
-  gSSTCheckCount += candidates.size();  // Increment by the number of SST files
-                                        // we are about to process.
+  countSstChecks(candidates.size());  // Increment by the number of SST files
+                                      // we are about to process.
   spdlog::info(
       "SSTables to check based on hierarchy for primary column: {}, current "
       "total checked: {}",
-      candidates.size(), gSSTCheckCount.load());
+      candidates.size(), counters.sstChecks.load());
 
   std::vector<std::future<std::vector<std::string>>> sst_scan_futures;
   sst_scan_futures.reserve(candidates.size());
@@ -565,15 +1025,28 @@ std::vector<std::string> DBManager::findUsingSingleHierarchy(
     // Capture necessary data by value for the lambda
     std::string filename = candidate_node->filename;
     std::string value_to_scan = values[0];
-    std::string start_key = candidate_node->startKey;
-    std::string end_key = candidate_node->endKey;
-
+    std::string start_key = startKey.empty()
+                                ? candidate_node->startKey
+                                : std::max(startKey, candidate_node->startKey);
+    std::string end_key = endKey.empty()
+                              ? candidate_node->endKey
+                              : std::min(endKey, candidate_node->endKey);
+    bool wholeLeaf = start_key == candidate_node->startKey &&
+                     end_key == candidate_node->endKey;
+
+    ++gPoolQueuedTasks;
     boost::asio::post(globalThreadPool,
-                      [this, filename, value_to_scan, start_key, end_key,
+                      [this, candidate_node, filename, value_to_scan,
+                       start_key, end_key, wholeLeaf,
                        p_sst_keys = std::move(promise_sst_keys)]() mutable {
+                        --gPoolQueuedTasks;
+                        PerfScope perf(PerfPhase::Scan);
+                        MemoryTagScope memoryTag(MemoryTag::QueryScratch);
                         try {
                           auto keys = scanFileForKeysWithValue(
                               filename, value_to_scan, start_key, end_key);
+                          candidate_node->recordScanResult(!keys.empty(),
+                                                           wholeLeaf);
                           p_sst_keys.set_value(keys);
                         } catch (...) {
                           try {
@@ -585,14 +1058,17 @@ std::vector<std::string> DBManager::findUsingSingleHierarchy(
   }
 
   allKeys.reserve(100);
-  for (auto& fut_sst_keys : sst_scan_futures) {
+  std::vector<const Node*> hitLeaves;
+  for (size_t i = 0; i < sst_scan_futures.size(); ++i) {
     try {
-      std::vector<std::string> keys_from_sst = fut_sst_keys.get();
+      std::vector<std::string> keys_from_sst = sst_scan_futures[i].get();
+      if (!keys_from_sst.empty()) hitLeaves.push_back(candidates[i]);
       allKeys.insert(allKeys.end(), keys_from_sst.begin(), keys_from_sst.end());
     } catch (const std::exception& e) {
       spdlog::error("Exception during parallel SST scan: {}", e.what());
     }
   }
+  hierarchy.coMatches->record(hitLeaves);
 
   spdlog::info("Total keys collected from primary column scan: {}",
                allKeys.size());
@@ -605,51 +1081,15 @@ std::vector<std::string> DBManager::findUsingSingleHierarchy(
     std::promise<std::string> promise;
     futures.emplace_back(promise.get_future());
 
+    ++gPoolQueuedTasks;
     boost::asio::post(globalThreadPool, [this, key, captured_columns = columns,
                                          captured_values = values,
                                          p = std::move(promise)]() mutable {
-      rocksdb::ReadOptions readOptionsLocal;
-      readOptionsLocal.fill_cache = false;
-      bool all_columns_match = true;
-
-      if (captured_columns.size() > 1) {
-        for (size_t i = 1; i < captured_columns.size(); ++i) {
-          auto cf_it = cf_handles_.find(captured_columns[i]);
-          if (cf_it == cf_handles_.end()) {
-            spdlog::warn(
-                "Column Family {} not found for key {} during Get operation in "
-                "findUsingSingleHierarchy.",
-                captured_columns[i], key);
-            all_columns_match = false;
-            break;
-          }
-          rocksdb::ColumnFamilyHandle* handle = cf_it->second.get();
-          std::string actual_value;
-          auto status = db_->Get(readOptionsLocal, handle, key, &actual_value);
-
-          if (!status.ok()) {
-            if (status.IsNotFound()) {
-              spdlog::debug(
-                  "Key {} not found in column {} during Get operation.", key,
-                  captured_columns[i]);
-            } else {
-              spdlog::warn("RocksDB Get failed for key {} in column {}: {}",
-                           key, captured_columns[i], status.ToString());
-            }
-            all_columns_match = false;
-            break;
-          }
-          if (actual_value != captured_values[i]) {
-            all_columns_match = false;
-            break;
-          }
-        }
-      }
-      // If all_columns_match is still true, it means:
-      // 1. There was only one column (already verified by
-      // scanFileForKeysWithValue), OR
-      // 2. All subsequent columns also matched their respective values for the
-      // given key.
+      --gPoolQueuedTasks;
+      PerfScope perf(PerfPhase::Verify);
+      MemoryTagScope memoryTag(MemoryTag::QueryScratch);
+      bool all_columns_match =
+          keyMatchesColumns(key, captured_columns, captured_values);
       if (all_columns_match) {
         p.set_value(key);
       } else {
@@ -659,6 +1099,7 @@ std::vector<std::string> DBManager::findUsingSingleHierarchy(
   }
 
   // Wait for all asynchronous tasks to finish and collect matching keys.
+  MemoryTagScope resultTag(MemoryTag::Results);
   std::vector<std::string> matchingKeys;
   for (auto& fut : futures) {
     std::string res = fut.get();
@@ -673,11 +1114,315 @@ std::vector<std::string> DBManager::findUsingSingleHierarchy(
   spdlog::info(
       "Bloom filters checked: {} (total), {} (leaves only), SSTables checked: "
       "{}",
-      gBloomCheckCount.load(), gLeafBloomCheckCount.load(),
-      gSSTCheckCount.load());
+      counters.bloomChecks.load(), counters.leafBloomChecks.load(),
+      counters.sstChecks.load());
   return matchingKeys;
 }
 
+void DBManager::enableDictionaryEncoding(const std::string& column) {
+  if (!db_) throw std::runtime_error("DB not open.");
+  if (dictionaries_.count(column)) return;
+  auto cf_it = cf_handles_.find(column);
+  if (cf_it == cf_handles_.end()) {
+    throw std::runtime_error("Column family " + column + " not found.");
+  }
+  // values already stored would not be codes, and queries would miss them
+  std::unique_ptr<rocksdb::Iterator> iter(
+      db_->NewIterator(rocksdb::ReadOptions(), cf_it->second.get()));
+  iter->SeekToFirst();
+  if (iter->Valid()) {
+    throw std::runtime_error("Column " + column +
+                             " already holds values; enable dictionary "
+                             "encoding before the first write.");
+  }
+  // a key without the '\0' separator marks the column as encoded
+  auto s = db_->Put(rocksdb::WriteOptions(),
+                    cf_handles_.at(kDictionaryColumn).get(), column, "");
+  if (!s.ok()) {
+    throw std::runtime_error("Failed to enable dictionary encoding: " +
+                             s.ToString());
+  }
+  dictionaries_[column] = std::make_shared<ValueDictionary>();
+  spdlog::info("Dictionary encoding enabled for column '{}'.", column);
+}
+
+std::shared_ptr<ValueDictionary> DBManager::columnDictionary(
+    const std::string& column) const {
+  auto it = dictionaries_.find(column);
+  return it == dictionaries_.end() ? nullptr : it->second;
+}
+
+std::string DBManager::queryValue(const std::string& column,
+                                  const std::string& value) const {
+  auto it = dictionaries_.find(column);
+  return it == dictionaries_.end() ? value : it->second->encode(value);
+}
+
+std::vector<std::string> DBManager::queryValues(
+    const std::vector<std::string>& columns,
+    const std::vector<std::string>& values) const {
+  std::vector<std::string> stored;
+  stored.reserve(values.size());
+  for (size_t i = 0; i < values.size(); ++i) {
+    stored.push_back(i < columns.size() ? queryValue(columns[i], values[i])
+                                        : values[i]);
+  }
+  return stored;
+}
+
+std::string DBManager::storedValue(const std::string& column,
+                                   const std::string& value,
+                                   StagedBatch& staged) {
+  auto it = dictionaries_.find(column);
+  if (it == dictionaries_.end()) return value;
+  bool unpublished = false;
+  std::string code = it->second->reserve(value, &unpublished);
+  if (unpublished && staged.newCodes.emplace(it->second.get(), value).second) {
+    staged.batch.Put(cf_handles_.at(kDictionaryColumn).get(),
+                     column + std::string(1, '\0') + code, value);
+  }
+  return code;
+}
+
+rocksdb::Status DBManager::writeBatch(StagedBatch& staged,
+                                      const rocksdb::WriteOptions& options) {
+  auto s = db_->Write(options, &staged.batch);
+  if (!s.ok()) return s;
+  for (const auto& [dictionary, value] : staged.newCodes) {
+    dictionary->publish(value);
+  }
+  staged.newCodes.clear();
+  staged.batch.Clear();
+  return s;
+}
+
+// dictionary CF: "<column>" -> "" marks an encoded column,
+// "<column>\0<code>" -> value is one entry
+void DBManager::loadDictionaries() {
+  dictionaries_.clear();
+  rocksdb::ReadOptions readOptions;
+  readOptions.fill_cache = false;
+  std::unique_ptr<rocksdb::Iterator> iter(db_->NewIterator(
+      readOptions, cf_handles_.at(kDictionaryColumn).get()));
+  size_t entries = 0;
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    std::string key = iter->key().ToString();
+    size_t sep = key.find('\0');
+    auto& dictionary = dictionaries_[key.substr(0, sep)];
+    if (!dictionary) dictionary = std::make_shared<ValueDictionary>();
+    if (sep == std::string::npos) continue;
+    dictionary->restore(key.substr(sep + 1), iter->value().ToString());
+    ++entries;
+  }
+  if (!dictionaries_.empty()) {
+    spdlog::info("Loaded {} dictionary entries for {} encoded columns.",
+                 entries, dictionaries_.size());
+  }
+}
+
+// Index CF: "\0<column>" -> "" marks an indexed column; entries are
+// "<column>\0<value length, 4 bytes BE><stored value><key>" -> "", so one
+// value's keys are contiguous and in key order.
+static std::string indexPrefix(const std::string& column,
+                               const std::string& stored) {
+  std::string prefix = column;
+  prefix.push_back('\0');
+  prefix += ValueDictionary::codeString(static_cast<uint32_t>(stored.size()));
+  prefix += stored;
+  return prefix;
+}
+
+void DBManager::putColumnValue(const std::string& column,
+                               const std::string& key, const std::string& value,
+                               StagedBatch& staged, bool mayExist) {
+  rocksdb::WriteBatch& batch = staged.batch;
+  rocksdb::ColumnFamilyHandle* handle = cf_handles_.at(column).get();
+  const std::string stored = storedValue(column, value, staged);
+  batch.Put(handle, key, stored);
+  valueBytesWritten_ += key.size() + stored.size();
+  if (!hasSecondaryIndex(column)) return;
+
+  rocksdb::ColumnFamilyHandle* indexHandle = cf_handles_.at(kIndexColumn).get();
+  if (mayExist) {
+    std::string previous;
+    auto s = db_->Get(rocksdb::ReadOptions(), handle, key, &previous);
+    if (s.ok()) {
+      if (previous == stored) return;
+      batch.Delete(indexHandle, indexPrefix(column, previous) + key);
+    }
+  }
+  const std::string entry = indexPrefix(column, stored) + key;
+  batch.Put(indexHandle, entry, "");
+  indexBytesWritten_ += entry.size();
+}
+
+void DBManager::enableSecondaryIndex(const std::string& column) {
+  if (!db_) throw std::runtime_error("DB not open.");
+  if (hasSecondaryIndex(column)) return;
+  auto cf_it = cf_handles_.find(column);
+  if (cf_it == cf_handles_.end()) {
+    throw std::runtime_error("Column family " + column + " not found.");
+  }
+
+  StopWatch sw;
+  sw.start();
+  rocksdb::ColumnFamilyHandle* indexHandle = cf_handles_.at(kIndexColumn).get();
+  rocksdb::ReadOptions readOptions;
+  readOptions.fill_cache = false;
+  std::unique_ptr<rocksdb::Iterator> iter(
+      db_->NewIterator(readOptions, cf_it->second.get()));
+
+  rocksdb::WriteBatch batch;
+  size_t entries = 0;
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    const std::string entry =
+        indexPrefix(column, iter->value().ToString()) + iter->key().ToString();
+    batch.Put(indexHandle, entry, "");
+    indexBytesWritten_ += entry.size();
+    if (++entries % 1000000 == 0) {
+      auto s = db_->Write(rocksdb::WriteOptions(), &batch);
+      if (!s.ok())
+        throw std::runtime_error("Index backfill failed: " + s.ToString());
+      batch.Clear();
+    }
+  }
+  // the marker goes last: an interrupted backfill leaves the column unindexed
+  batch.Put(indexHandle, std::string(1, '\0') + column, "");
+  auto s = db_->Write(rocksdb::WriteOptions(), &batch);
+  if (!s.ok()) throw std::runtime_error("Index backfill failed: " + s.ToString());
+  {
+    std::unique_lock<std::shared_mutex> lock(indexedColumnsMtx_);
+    indexedColumns_.insert(column);
+  }
+
+  sw.stop();
+  spdlog::info("Secondary index on '{}': {} entries backfilled in {} µs.",
+               column, entries, sw.elapsedMicros());
+}
+
+bool DBManager::hasSecondaryIndex(const std::string& column) const {
+  std::shared_lock<std::shared_mutex> lock(indexedColumnsMtx_);
+  return indexedColumns_.count(column) > 0;
+}
+
+std::vector<std::string> DBManager::indexPostings(const std::string& column,
+                                                  const std::string& stored) {
+  std::vector<std::string> keys;
+  const std::string prefix = indexPrefix(column, stored);
+  std::unique_ptr<rocksdb::Iterator> iter(db_->NewIterator(
+      rocksdb::ReadOptions(), cf_handles_.at(kIndexColumn).get()));
+  for (iter->Seek(prefix); iter->Valid() && iter->key().starts_with(prefix);
+       iter->Next()) {
+    keys.emplace_back(iter->key().data() + prefix.size(),
+                      iter->key().size() - prefix.size());
+  }
+  return keys;
+}
+
+std::vector<std::string> DBManager::indexLookup(const std::string& column,
+                                                const std::string& value) {
+  if (!hasSecondaryIndex(column)) {
+    throw std::runtime_error("Column " + column + " has no secondary index.");
+  }
+  const std::string stored = queryValue(column, value);
+  std::vector<std::string> keys;
+  for (auto& key : indexPostings(column, stored)) {
+    if (keyMatchesColumns(key, {column}, {stored}, 0)) {
+      keys.push_back(std::move(key));
+    }
+  }
+  return keys;
+}
+
+std::vector<std::string> DBManager::findUsingSecondaryIndex(
+    const std::vector<std::string>& columns,
+    const std::vector<std::string>& values) {
+  static QueryPlanMetrics planMetrics("index");
+  QueryMetricsScope queryMetrics(planMetrics);
+  if (columns.size() != values.size() || columns.empty()) {
+    throw std::runtime_error(
+        "Number of columns and values must be equal and non-empty.");
+  }
+  const std::vector<std::string> stored = queryValues(columns, values);
+
+  std::vector<std::string> keys;
+  // indexed columns, then the unindexed ones. Postings can be stale (see
+  // putColumnValue), so the indexed columns are checked as well.
+  std::vector<std::string> checkColumns;
+  std::vector<std::string> checkValues;
+  // read once, an index enabled meanwhile must not drop a column
+  std::vector<bool> indexed(columns.size());
+  for (size_t i = 0; i < columns.size(); ++i) {
+    indexed[i] = hasSecondaryIndex(columns[i]);
+    if (!indexed[i]) continue;
+    std::vector<std::string> postings = indexPostings(columns[i], stored[i]);
+    bool first = checkColumns.empty();
+    checkColumns.push_back(columns[i]);
+    checkValues.push_back(stored[i]);
+    if (first) {
+      keys = std::move(postings);
+    } else {
+      // both lists are in key order
+      std::vector<std::string> merged;
+      std::set_intersection(keys.begin(), keys.end(), postings.begin(),
+                            postings.end(), std::back_inserter(merged));
+      keys.swap(merged);
+    }
+    if (keys.empty()) return {};
+  }
+  if (checkColumns.empty()) {
+    throw std::runtime_error("None of the queried columns has a secondary index.");
+  }
+
+  for (size_t i = 0; i < columns.size(); ++i) {
+    if (indexed[i]) continue;
+    checkColumns.push_back(columns[i]);
+    checkValues.push_back(stored[i]);
+  }
+
+  std::vector<std::string> matchingKeys;
+  for (const auto& key : keys) {
+    if (keyMatchesColumns(key, checkColumns, checkValues, 0)) {
+      matchingKeys.push_back(key);
+    }
+  }
+  return matchingKeys;
+}
+
+SecondaryIndexStats DBManager::secondaryIndexStats() {
+  SecondaryIndexStats stats;
+  stats.valueBytesWritten = valueBytesWritten_;
+  stats.indexBytesWritten = indexBytesWritten_;
+  if (!db_) return stats;
+  rocksdb::ColumnFamilyHandle* indexHandle = cf_handles_.at(kIndexColumn).get();
+  rocksdb::ColumnFamilyMetaData meta;
+  db_->GetColumnFamilyMetaData(indexHandle, &meta);
+  stats.indexBytes = meta.size;
+  uint64_t memtableBytes = 0;
+  if (db_->GetIntProperty(indexHandle,
+                          rocksdb::DB::Properties::kCurSizeAllMemTables,
+                          &memtableBytes)) {
+    stats.indexBytes += memtableBytes;
+  }
+  return stats;
+}
+
+void DBManager::loadIndexedColumns() {
+  std::unique_lock<std::shared_mutex> lock(indexedColumnsMtx_);
+  indexedColumns_.clear();
+  std::unique_ptr<rocksdb::Iterator> iter(db_->NewIterator(
+      rocksdb::ReadOptions(), cf_handles_.at(kIndexColumn).get()));
+  // markers start with '\0' and sort before every entry
+  for (iter->Seek(std::string(1, '\0'));
+       iter->Valid() && iter->key().size() > 0 && iter->key()[0] == '\0';
+       iter->Next()) {
+    indexedColumns_.insert(iter->key().ToString().substr(1));
+  }
+  if (!indexedColumns_.empty()) {
+    spdlog::info("{} columns have a secondary index.", indexedColumns_.size());
+  }
+}
+
 std::string DBManager::getValue(const std::string& column_family_name,
                                 const std::string& key) {
   rocksdb::PinnableSlice value;
@@ -690,7 +1435,8 @@ std::string DBManager::getValue(const std::string& column_family_name,
   rocksdb::Status status =
       db_->Get(read_options, cf_handle, rocksdb::Slice(key), &value);
   if (status.ok()) {
-    return value.ToString();
+    auto dictionary = columnDictionary(column_family_name);
+    return dictionary ? dictionary->decode(value.ToString()) : value.ToString();
   }
   return "";  // Or throw an exception / return status
 }
@@ -704,6 +1450,133 @@ rocksdb::ColumnFamilyHandle* DBManager::getColumnFamilyHandle(
   return nullptr;  // Or throw an exception
 }
 
+rocksdb::Status DBManager::writeModifications(
+    const std::vector<std::tuple<std::string, std::string, std::string>>&
+        modifications) {
+  if (!db_) return rocksdb::Status::InvalidArgument("DB not open");
+
+  StagedBatch staged;
+  for (const auto& [key, column_name, value] : modifications) {
+    auto it = cf_handles_.find(column_name);
+    if (it == cf_handles_.end()) {
+      spdlog::error(
+          "WriteModifications: Column family '{}' not found for key '{}'. "
+          "Skipping.",
+          column_name, key);
+      continue;
+    }
+    putColumnValue(column_name, key, value, staged, true);
+  }
+  return writeBatch(staged);
+}
+
+void DBManager::flushAllColumnFamilies(bool wait) {
+  if (!db_) throw std::runtime_error("DB not open.");
+  rocksdb::FlushOptions flushOptions;
+  flushOptions.wait = wait;
+  for (const auto& [name, handle] : cf_handles_) {
+    auto s = db_->Flush(flushOptions, handle.get());
+    if (!s.ok()) {
+      spdlog::warn("Flush of column '{}' failed: {}", name, s.ToString());
+    }
+  }
+}
+
+rocksdb::Status DBManager::createCheckpoint(const std::string& checkpointDir) {
+  if (!db_) return rocksdb::Status::InvalidArgument("DB not open");
+
+  StopWatch sw;
+  sw.start();
+  rocksdb::Checkpoint* rawCheckpoint = nullptr;
+  auto s = rocksdb::Checkpoint::Create(db_.get(), &rawCheckpoint);
+  if (!s.ok()) return s;
+  std::unique_ptr<rocksdb::Checkpoint> checkpoint(rawCheckpoint);
+  // log_size_for_flush = 0: memtables are flushed, so the clone is SSTs only
+  s = checkpoint->CreateCheckpoint(checkpointDir, 0);
+  sw.stop();
+  spdlog::info("Checkpoint '{}' created in {} µs.", checkpointDir,
+               sw.elapsedMicros());
+  return s;
+}
+
+rocksdb::Status DBManager::disableFileDeletions() {
+  if (!db_) return rocksdb::Status::InvalidArgument("DB not open");
+  return db_->DisableFileDeletions();
+}
+
+rocksdb::Status DBManager::enableFileDeletions() {
+  if (!db_) return rocksdb::Status::InvalidArgument("DB not open");
+  return db_->EnableFileDeletions();
+}
+
+RocksDBMemoryStats DBManager::getRocksDBMemoryStats() {
+  RocksDBMemoryStats stats;
+  if (!db_) return stats;
+
+  // every column family has its own default block cache
+  uint64_t value = 0;
+  for (const auto& [name, handle] : cf_handles_) {
+    if (db_->GetIntProperty(handle.get(),
+                            rocksdb::DB::Properties::kBlockCacheUsage, &value)) {
+      stats.blockCacheBytes += value;
+    }
+    if (db_->GetIntProperty(handle.get(),
+                            rocksdb::DB::Properties::kEstimateTableReadersMem,
+                            &value)) {
+      stats.tableReaderBytes += value;
+    }
+    if (db_->GetIntProperty(handle.get(),
+                            rocksdb::DB::Properties::kCurSizeAllMemTables,
+                            &value)) {
+      stats.memtableBytes += value;
+    }
+  }
+  return stats;
+}
+
+WriteStallStats DBManager::getWriteStallStats() {
+  WriteStallStats stats;
+  if (!db_) return stats;
+
+  uint64_t value = 0;
+  if (db_->GetIntProperty(rocksdb::DB::Properties::kActualDelayedWriteRate,
+                          &value)) {
+    stats.delayedWriteRate = value;
+  }
+  for (const auto& [name, handle] : cf_handles_) {
+    if (db_->GetIntProperty(handle.get(),
+                            rocksdb::DB::Properties::kIsWriteStopped, &value)) {
+      stats.writeStopped = stats.writeStopped || value != 0;
+    }
+    if (db_->GetIntProperty(
+            handle.get(),
+            rocksdb::DB::Properties::kEstimatePendingCompactionBytes,
+            &value)) {
+      stats.pendingCompactionBytes += value;
+    }
+    if (db_->GetIntProperty(handle.get(),
+                            rocksdb::DB::Properties::kNumImmutableMemTable,
+                            &value)) {
+      stats.immutableMemtables += value;
+    }
+    if (db_->GetIntProperty(
+            handle.get(),
+            rocksdb::DB::Properties::kNumFilesAtLevelPrefix + "0", &value)) {
+      stats.level0Files += value;
+    }
+  }
+  // DB-wide counters, reported through any column family
+  if (db_->GetIntProperty(rocksdb::DB::Properties::kNumRunningCompactions,
+                          &value)) {
+    stats.runningCompactions = value;
+  }
+  if (db_->GetIntProperty(rocksdb::DB::Properties::kNumRunningFlushes,
+                          &value)) {
+    stats.runningFlushes = value;
+  }
+  return stats;
+}
+
 rocksdb::Status DBManager::applyModifications(
     const std::vector<std::tuple<std::string, std::string, std::string>>&
         modifications, size_t numRecords) {
@@ -723,7 +1596,10 @@ rocksdb::Status DBManager::applyModifications(
           column_name, key);
       continue;
     }
-    rocksdb::Status s = db_->Put(write_options, handle, key, value);
+    // one batch, so new dictionary and index entries land with the value
+    StagedBatch staged;
+    putColumnValue(column_name, key, value, staged, true);
+    rocksdb::Status s = writeBatch(staged, write_options);
     if (!s.ok()) {
       spdlog::error(
           "ApplyModifications: Failed to Put key '{}' in column '{}': {}", key,
@@ -754,7 +1630,10 @@ rocksdb::Status DBManager::revertModifications(
           column_name, key);
       continue;
     }
-    rocksdb::Status s = db_->Put(write_options, handle, key, value);
+    // one batch, so new dictionary and index entries land with the value
+    StagedBatch staged;
+    putColumnValue(column_name, key, value, staged, true);
+    rocksdb::Status s = writeBatch(staged, write_options);
     if (!s.ok()) {
       spdlog::error(
           "RevertModifications: Failed to Put key '{}' in column '{}': {}", key,
@@ -2,6 +2,7 @@
 
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
 #include <boost/asio/post.hpp>
 #include <boost/asio/thread_pool.hpp>
 #include <chrono>
@@ -29,6 +30,11 @@ void writeCsvExp3Headers() {
                  "numRecords,bloomCreationTime,dbCreationTime");
 }
 
+void writeExp3BuildScalingHeaders() {
+  writeCsvHeader("csv/exp_3_build_scaling.csv",
+                 "numRecords,column,sstFiles,buildThreads,buildTime");
+}
+
 void writeExp1BasicMetricsHeaders() {
   writeCsvHeader("csv/exp_1_basic_metrics.csv",
                  "dbSize,globalScanTime,hierarchicalSingleTime,hierarchicalMultiTime");
@@ -78,6 +84,7 @@ void writeExp1TimingComparisonHeaders() {
 void runExp1(std::string baseDir, bool initMode, std::string sharedDbName,
              int defaultNumRecords, bool skipDbScan) {
   writeCsvHeaders();
+  writeExp3BuildScalingHeaders();
   writeExp1BasicMetricsHeaders();
   writeExp1BasicChecksHeaders();
   writeExp1PatternTimingsHeaders();
@@ -125,7 +132,8 @@ void runExp1(std::string baseDir, bool initMode, std::string sharedDbName,
     std::map<std::string, std::vector<std::string>> columnSstFiles =
         scanSstFilesAsync(columns, dbManager, params);
     std::map<std::string, BloomTree> hierarchies;
-    hierarchies = buildHierarchies(columnSstFiles, bloomManager, params);
+    hierarchies = buildHierarchies(columnSstFiles, bloomManager, params,
+                                   &dbManager);
     stopwatch.stop();
     auto bloomCreationTime = stopwatch.elapsedMicros();
 
@@ -162,6 +170,32 @@ void runExp1(std::string baseDir, bool initMode, std::string sharedDbName,
             << bloomCreationTime << "\n";
     outExp3.close();
 
+    // Rebuilds the first column's hierarchy with a growing thread budget;
+    // after compaction it has few files, so this shows whether the build
+    // scales with threads rather than files.
+    std::ofstream buildScaling("csv/exp_3_build_scaling.csv", std::ios::app);
+    if (!buildScaling) {
+      spdlog::error(
+          "ExpBloomMetrics: Nie udało się otworzyć pliku wynikowego!");
+      return;
+    }
+    const std::vector<std::string>& scalingFiles = columnSstFiles.at(columns[0]);
+    for (size_t threads = 1;; threads = std::min(threads * 2, globalThreadPoolSize)) {
+      stopwatch.start();
+      BloomTree rebuilt = bloomManager.createPartitionedHierarchy(
+          scalingFiles, params.itemsPerPartition, params.bloomSize,
+          params.numHashFunctions, params.bloomTreeRatio, TextFilterMode::None,
+          params.ngramSize, params.sketchWidth, params.sketchDepth,
+          params.foldTargetFpr, params.filterKind, threads);
+      stopwatch.stop();
+      buildScaling << params.numRecords << "," << columns[0] << ","
+                   << scalingFiles.size() << "," << threads << ","
+                   << stopwatch.elapsedMicros() << "\n";
+      rebuilt.deleteNodes();
+      if (threads == globalThreadPoolSize) break;
+    }
+    buildScaling.close();
+
     // Run standard queries first
     AggregatedQueryTimings timings = runStandardQueries(
         dbManager, hierarchies, columns, dbSize, 10, skipDbScan);
@@ -0,0 +1,271 @@
+#include <spdlog/spdlog.h>
+
+#include <atomic>
+#include <boost/asio/thread_pool.hpp>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <random>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <unordered_set>
+#include <vector>
+
+#include "algorithm.hpp"
+#include "bloomTree.hpp"
+#include "bloom_manager.hpp"
+#include "dataset_manager.hpp"
+#include "db_manager.hpp"
+#include "exp_utils.hpp"
+#include "metrics.hpp"
+#include "stopwatch.hpp"
+#include "test_params.hpp"
+
+extern boost::asio::thread_pool globalThreadPool;
+
+void writeExp10TimelineHeaders() {
+  writeCsvHeader("csv/exp_10_mixed_timeline.csv",
+                 "numRecords,elapsedMs,queries,queryQps,queryP50,queryP99,queryMax,"
+                 "writes,writeRecordsPerSec,writeBatchP50,writeBatchP99,"
+                 "writeStopped,delayedWriteRate,pendingCompactionBytes,"
+                 "runningCompactions,runningFlushes,immutableMemtables,level0Files,"
+                 "unindexedSstFiles,writesSinceRefresh,refreshAgeMs,lastRefreshMicros");
+}
+
+namespace {
+
+// Latencies collected by the worker threads, drained once per window.
+struct WindowStats {
+  std::mutex mtx;
+  std::vector<long long> queryLatencies;
+  std::vector<long long> writeLatencies;
+  size_t writtenRecords = 0;
+
+  void addQuery(long long micros) {
+    std::lock_guard<std::mutex> lock(mtx);
+    queryLatencies.push_back(micros);
+  }
+  void addWrite(long long micros, size_t records) {
+    std::lock_guard<std::mutex> lock(mtx);
+    writeLatencies.push_back(micros);
+    writtenRecords += records;
+  }
+  void drain(std::vector<long long>& queries, std::vector<long long>& writes,
+             size_t& records) {
+    std::lock_guard<std::mutex> lock(mtx);
+    queries.swap(queryLatencies);
+    writes.swap(writeLatencies);
+    records = writtenRecords;
+    queryLatencies.clear();
+    writeLatencies.clear();
+    writtenRecords = 0;
+  }
+};
+
+std::string exp10Key(size_t index) {
+  std::string s = std::to_string(index);
+  return "key" + std::string(20 - s.size(), '0') + s;
+}
+
+}  // namespace
+
+// Ingest, background flush/compaction, hierarchy refresh and queries all run
+// at once for durationSeconds, on a checkpoint clone of the shared DB so the
+// writes never reach it. Queries hold the hierarchy lock shared; a refresh
+// takes it exclusively, so refresh pauses show up as query latency. File
+// deletions stay disabled between refreshes: compaction can't remove an SST
+// that a leaf still points at.
+void runExp10(const std::string& dbPath, size_t dbSize, bool skipDbScan) {
+  const std::vector<std::string> columns = {"phone", "mail", "address"};
+  const int durationSeconds = 60;
+  const int numQueryClients = 4;
+  const size_t writeBatchRecords = 500;
+  const size_t targetWritesPerSec = 20000;
+  const auto flushInterval = std::chrono::seconds(2);
+  const auto refreshInterval = std::chrono::seconds(5);
+  const auto windowLength = std::chrono::seconds(1);
+  const double realDataPercentage = 50.0;
+
+  writeExp10TimelineHeaders();
+
+  BloomManager bloomManager;
+  TestParams params = {dbPath, static_cast<int>(dbSize), 3, 1, 100000, 4000000, 3};
+
+  DatasetManager dataset(params, columns);
+  dataset.open();
+  std::unique_ptr<DatasetClone> clone = dataset.createClone({});
+  DBManager& dbManager = clone->db;
+  std::map<std::string, BloomTree>& hierarchies = clone->hierarchies;
+
+  std::shared_mutex hierarchyLock;
+  std::atomic<bool> running{true};
+  std::atomic<size_t> writesSinceRefresh{0};
+  std::atomic<long long> lastRefreshMicros{0};
+  std::atomic<long long> lastRefreshAtMs{0};
+  WindowStats window;
+  auto begin = std::chrono::steady_clock::now();
+  auto elapsedMs = [&]() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now() - begin)
+        .count();
+  };
+
+  // steady ingest of new records past the existing key space
+  std::thread writer([&]() {
+    size_t nextIndex = dbSize + 1;
+    auto batchPeriod = std::chrono::microseconds(
+        1000000 * writeBatchRecords / std::max<size_t>(targetWritesPerSec, 1));
+    auto nextBatch = std::chrono::steady_clock::now();
+    while (running) {
+      std::vector<std::tuple<std::string, std::string, std::string>> mods;
+      mods.reserve(writeBatchRecords * columns.size());
+      for (size_t i = 0; i < writeBatchRecords; ++i, ++nextIndex) {
+        std::string key = exp10Key(nextIndex);
+        for (const auto& column : columns) {
+          mods.emplace_back(key, column, column + "_value" + std::to_string(nextIndex));
+        }
+      }
+      StopWatch sw;
+      sw.start();
+      auto status = dbManager.writeModifications(mods);
+      sw.stop();
+      if (!status.ok()) {
+        spdlog::error("Exp10: write batch failed: {}", status.ToString());
+      }
+      window.addWrite(sw.elapsedMicros(), writeBatchRecords);
+      writesSinceRefresh += writeBatchRecords;
+
+      nextBatch += batchPeriod;
+      std::this_thread::sleep_until(nextBatch);
+    }
+  });
+
+  // turns memtables into L0 files so compaction has work to do
+  std::thread flusher([&]() {
+    while (running) {
+      std::this_thread::sleep_for(flushInterval);
+      if (running) dbManager.flushAllColumnFamilies(false);
+    }
+  });
+
+  // Brings the hierarchies up to date with the files on disk. With no query
+  // running, files compacted away since the last refresh are released, then
+  // deletions are disabled again before the live files are listed, so every
+  // leaf's file stays on disk until the next refresh.
+  auto refreshHierarchies = [&]() {
+    std::unique_lock<std::shared_mutex> lock(hierarchyLock);
+    dbManager.enableFileDeletions();
+    auto status = dbManager.disableFileDeletions();
+    if (!status.ok()) {
+      spdlog::error("Exp10: cannot disable file deletions: {}", status.ToString());
+    }
+    for (const auto& column : columns) {
+      bloomManager.refreshLevelAwareHierarchy(
+          hierarchies.at(column), dbManager.scanSSTFilesByLevel(clone->path, column),
+          params.itemsPerPartition);
+      exportHierarchyMetrics(column, hierarchies.at(column));
+    }
+  };
+  // the clone may have compacted while its hierarchies were built
+  refreshHierarchies();
+
+  std::thread refresher([&]() {
+    while (running) {
+      std::this_thread::sleep_for(refreshInterval);
+      if (!running) break;
+      size_t pendingWrites = writesSinceRefresh.exchange(0);
+      StopWatch sw;
+      sw.start();
+      refreshHierarchies();
+      sw.stop();
+      lastRefreshMicros = sw.elapsedMicros();
+      lastRefreshAtMs = elapsedMs();
+      spdlog::info("Exp10: refreshed hierarchies in {} µs covering {} new writes.",
+                   sw.elapsedMicros(), pendingWrites);
+    }
+  });
+
+  std::vector<std::thread> clients;
+  for (int client = 0; client < numQueryClients; ++client) {
+    clients.emplace_back([&, client]() {
+      std::mt19937 generator(4321 + client);
+      std::uniform_int_distribution<size_t> idDist(1, dbSize);
+      std::uniform_real_distribution<double> realDist(0.0, 100.0);
+      while (running) {
+        size_t id = idDist(generator);
+        std::string suffix = realDist(generator) < realDataPercentage
+                                 ? "_value" + std::to_string(id)
+                                 : "_wrong" + std::to_string(id);
+        std::vector<std::string> values;
+        for (const auto& column : columns) values.push_back(column + suffix);
+
+        StopWatch sw;
+        sw.start();
+        {
+          std::shared_lock<std::shared_mutex> lock(hierarchyLock);
+          std::vector<BloomTree> trees;
+          for (const auto& column : columns) trees.push_back(hierarchies.at(column));
+          multiColumnQueryHierarchical(trees, values, "", "", dbManager);
+        }
+        sw.stop();
+        window.addQuery(sw.elapsedMicros());
+      }
+    });
+  }
+
+  // one timeline row per window
+  std::ofstream out("csv/exp_10_mixed_timeline.csv", std::ios::app);
+  auto nextWindow = std::chrono::steady_clock::now();
+  while (elapsedMs() < durationSeconds * 1000LL) {
+    nextWindow += windowLength;
+    std::this_thread::sleep_until(nextWindow);
+
+    std::vector<long long> queries, writes;
+    size_t records = 0;
+    window.drain(queries, writes, records);
+    LatencyPercentiles q = calculateLatencyPercentiles(queries);
+    LatencyPercentiles w = calculateLatencyPercentiles(writes);
+    WriteStallStats stall = dbManager.getWriteStallStats();
+
+    size_t unindexed = 0;
+    {
+      std::shared_lock<std::shared_mutex> lock(hierarchyLock);
+      for (const auto& column : columns) {
+        std::unordered_set<std::string> indexed;
+        for (const Node* leaf : hierarchies.at(column).leafNodes) {
+          indexed.insert(leaf->filename);
+        }
+        for (const auto& level : dbManager.scanSSTFilesByLevel(clone->path, column)) {
+          for (const auto& file : level) unindexed += indexed.count(file) == 0;
+        }
+      }
+    }
+
+    double windowSec = std::chrono::duration<double>(windowLength).count();
+    long long now = elapsedMs();
+    if (out) {
+      out << dbSize << "," << now << "," << queries.size() << ","
+          << queries.size() / windowSec << "," << q.p50 << "," << q.p99 << ","
+          << q.max << "," << records << "," << records / windowSec << ","
+          << w.p50 << "," << w.p99 << "," << (stall.writeStopped ? 1 : 0) << ","
+          << stall.delayedWriteRate << "," << stall.pendingCompactionBytes << ","
+          << stall.runningCompactions << "," << stall.runningFlushes << ","
+          << stall.immutableMemtables << "," << stall.level0Files << ","
+          << unindexed << "," << writesSinceRefresh.load() << ","
+          << now - lastRefreshAtMs.load() << "," << lastRefreshMicros.load() << "\n";
+      out.flush();
+    }
+  }
+
+  running = false;
+  writer.join();
+  flusher.join();
+  refresher.join();
+  for (auto& t : clients) t.join();
+
+  dbManager.enableFileDeletions();
+  dataset.releaseClone(std::move(clone));
+}
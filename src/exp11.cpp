@@ -0,0 +1,216 @@
+#include <spdlog/spdlog.h>
+
+#include <atomic>
+#include <boost/asio/post.hpp>
+#include <boost/asio/thread_pool.hpp>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "algorithm.hpp"
+#include "bloomTree.hpp"
+#include "bloom_manager.hpp"
+#include "db_manager.hpp"
+#include "exp_utils.hpp"
+#include "stopwatch.hpp"
+#include "test_params.hpp"
+
+extern void clearBloomFilterFiles(const std::string& dbDir);
+extern boost::asio::thread_pool globalThreadPool;
+
+void writeExp11OpenLoopHeaders() {
+  writeCsvHeader("csv/exp_11_open_loop.csv",
+                 "numRecords,arrival,targetQps,issued,completed,achievedQps,"
+                 "latencyAvg,latencyP50,latencyP95,latencyP99,latencyMax,"
+                 "serviceP50,serviceP99,saturated,queryBudgetMicros,partial");
+}
+
+void writeExp11SaturationHeaders() {
+  writeCsvHeader("csv/exp_11_saturation.csv",
+                 "numRecords,arrival,hardwareThreads,sloP99Micros,maxSustainableQps");
+}
+
+namespace {
+
+enum class Arrival { Constant, Poisson };
+
+struct OpenLoopResult {
+  double targetQps = 0.0;
+  size_t issued = 0;
+  size_t completed = 0;
+  double achievedQps = 0.0;
+  LatencyPercentiles latency;  // from the intended send time
+  LatencyPercentiles service;  // from the actual start
+};
+
+// Issues query(i) at the target rate regardless of how many are still
+// running, so a slow system builds a queue instead of slowing the
+// generator down. Latency counts from the scheduled send time, which keeps
+// queueing delay in the numbers (no coordinated omission). Queries run on
+// their own pool because they block on globalThreadPool work.
+OpenLoopResult runOpenLoop(double targetQps, Arrival arrival,
+                           std::chrono::milliseconds duration,
+                           size_t maxConcurrency,
+                           const std::function<void(size_t)>& query) {
+  using Clock = std::chrono::steady_clock;
+  OpenLoopResult result;
+  result.targetQps = targetQps;
+
+  boost::asio::thread_pool clientPool(maxConcurrency);
+  std::mutex mtx;
+  std::vector<long long> latencies;
+  std::vector<long long> serviceTimes;
+  std::atomic<size_t> completed{0};
+
+  std::mt19937 generator(99);
+  std::exponential_distribution<double> gap(targetQps);
+  double meanGapSec = 1.0 / targetQps;
+
+  Clock::time_point begin = Clock::now();
+  Clock::time_point end = begin + duration;
+  Clock::time_point intended = begin;
+  size_t issued = 0;
+
+  while (intended < end) {
+    std::this_thread::sleep_until(intended);
+    boost::asio::post(clientPool, [&, intended, i = issued]() {
+      Clock::time_point started = Clock::now();
+      query(i);
+      Clock::time_point finished = Clock::now();
+      std::lock_guard<std::mutex> lock(mtx);
+      latencies.push_back(
+          std::chrono::duration_cast<std::chrono::microseconds>(finished - intended)
+              .count());
+      serviceTimes.push_back(
+          std::chrono::duration_cast<std::chrono::microseconds>(finished - started)
+              .count());
+      ++completed;
+    });
+    ++issued;
+
+    double step = arrival == Arrival::Poisson ? gap(generator) : meanGapSec;
+    intended += std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(step));
+  }
+
+  // queries still queued count against the run, so wait for all of them
+  clientPool.join();
+  double elapsedSec = std::chrono::duration<double>(Clock::now() - begin).count();
+
+  result.issued = issued;
+  result.completed = completed.load();
+  result.achievedQps = elapsedSec > 0 ? result.completed / elapsedSec : 0.0;
+  result.latency = calculateLatencyPercentiles(std::move(latencies));
+  result.service = calculateLatencyPercentiles(std::move(serviceTimes));
+  return result;
+}
+
+}  // namespace
+
+// Sweeps the arrival rate upward until the system saturates: the p99 from
+// intended send time exceeds the SLO or throughput falls behind the target.
+// With a query budget every query is time-bounded from its start, and the
+// partial answers are counted per rate.
+void runExp11(const std::string& dbPath, size_t dbSize, bool skipDbScan,
+              long long queryBudgetMicros) {
+  const std::vector<std::string> columns = {"phone", "mail", "address"};
+  const std::vector<double> targetRates = {5, 10, 20, 40, 80, 160, 320, 640};
+  const std::vector<Arrival> arrivals = {Arrival::Poisson, Arrival::Constant};
+  const auto runLength = std::chrono::seconds(20);
+  const size_t maxConcurrency = 256;
+  const long long sloP99Micros = 500000;
+  const double minAchievedRatio = 0.95;
+  const double realDataPercentage = 50.0;
+
+  writeExp11OpenLoopHeaders();
+  writeExp11SaturationHeaders();
+
+  DBManager dbManager;
+  BloomManager bloomManager;
+  TestParams params = {dbPath, static_cast<int>(dbSize), 3, 1, 100000, 4000000, 3};
+
+  clearBloomFilterFiles(params.dbName);
+  dbManager.openDB(params.dbName);
+
+  std::map<std::string, std::vector<std::string>> columnSstFiles =
+      scanSstFilesAsync(columns, dbManager, params);
+  std::map<std::string, BloomTree> hierarchies =
+      buildHierarchies(columnSstFiles, bloomManager, params, &dbManager);
+
+  // values drawn up front so the generator thread does no extra work
+  std::mt19937 generator(7);
+  std::uniform_int_distribution<size_t> idDist(1, dbSize);
+  std::uniform_real_distribution<double> realDist(0.0, 100.0);
+  std::vector<std::vector<std::string>> queryValues(4096);
+  for (auto& values : queryValues) {
+    size_t id = idDist(generator);
+    std::string suffix = realDist(generator) < realDataPercentage
+                             ? "_value" + std::to_string(id)
+                             : "_wrong" + std::to_string(id);
+    for (const auto& column : columns) values.push_back(column + suffix);
+  }
+
+  std::atomic<size_t> partialAnswers{0};
+  auto query = [&](size_t i) {
+    std::vector<BloomTree> trees;
+    for (const auto& column : columns) trees.push_back(hierarchies.at(column));
+    if (queryBudgetMicros > 0) {
+      BoundedQueryResult r = multiColumnQueryHierarchicalBounded(
+          trees, queryValues[i % queryValues.size()], "", "", dbManager,
+          std::chrono::microseconds(queryBudgetMicros));
+      if (!r.complete()) ++partialAnswers;
+      return;
+    }
+    multiColumnQueryHierarchical(trees, queryValues[i % queryValues.size()], "",
+                                 "", dbManager);
+  };
+
+  std::ofstream out("csv/exp_11_open_loop.csv", std::ios::app);
+  std::ofstream saturation("csv/exp_11_saturation.csv", std::ios::app);
+
+  for (Arrival arrival : arrivals) {
+    const char* arrivalName = arrival == Arrival::Poisson ? "poisson" : "constant";
+    double maxSustainable = 0.0;
+
+    for (double rate : targetRates) {
+      partialAnswers = 0;
+      OpenLoopResult r = runOpenLoop(
+          rate, arrival, std::chrono::duration_cast<std::chrono::milliseconds>(runLength),
+          maxConcurrency, query);
+      bool saturated = r.latency.p99 > sloP99Micros ||
+                       r.achievedQps < minAchievedRatio * rate;
+
+      spdlog::info(
+          "Exp11: {} arrivals at {} q/s: achieved {:.1f} q/s, p99 {} µs (service p99 {} µs){}",
+          arrivalName, rate, r.achievedQps, r.latency.p99, r.service.p99,
+          saturated ? ", saturated" : "");
+
+      if (out) {
+        out << dbSize << "," << arrivalName << "," << rate << "," << r.issued << ","
+            << r.completed << "," << r.achievedQps << "," << r.latency.average << ","
+            << r.latency.p50 << "," << r.latency.p95 << "," << r.latency.p99 << ","
+            << r.latency.max << "," << r.service.p50 << "," << r.service.p99 << ","
+            << (saturated ? 1 : 0) << "," << queryBudgetMicros << ","
+            << partialAnswers.load() << "\n";
+        out.flush();
+      }
+
+      if (saturated) break;
+      maxSustainable = rate;
+    }
+
+    if (saturation) {
+      saturation << dbSize << "," << arrivalName << ","
+                 << std::thread::hardware_concurrency() << "," << sloP99Micros << ","
+                 << maxSustainable << "\n";
+    }
+  }
+
+  dbManager.closeDB();
+}
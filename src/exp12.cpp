@@ -0,0 +1,311 @@
+#include "exp12.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <array>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "algorithm.hpp"
+#include "bloomTree.hpp"
+#include "bloom_manager.hpp"
+#include "db_manager.hpp"
+#include "exp_utils.hpp"
+#include "filter_monitor.hpp"
+#include "perf_counters.hpp"
+#include "query_log.hpp"
+#include "stopwatch.hpp"
+#include "test_params.hpp"
+
+extern void clearBloomFilterFiles(const std::string& dbDir);
+
+void writeExp12ReplayHeaders() {
+  writeCsvHeader("csv/exp_12_replay.csv",
+                 "config,pass,query,arrivalMicros,startLagMicros,numColumns,"
+                 "multiTime,multiBloomChecks,multiLeafBloomChecks,multiSSTChecks,"
+                 "multiMatches,singleTime,singleBloomChecks,"
+                 "singleLeafBloomChecks,singleSSTChecks,singleMatches");
+}
+
+void writeExp12SummaryHeaders() {
+  writeCsvHeader("csv/exp_12_replay_summary.csv",
+                 "config,pass,timed,queries,skipped,"
+                 "multiP50,multiP95,multiP99,multiMax,multiAvg,"
+                 "singleP50,singleP99,avgMultiBloomChecks,avgMultiSSTChecks,"
+                 "avgSingleBloomChecks,avgSingleSSTChecks");
+}
+
+void writeExp12FilterHeaders() {
+  writeCsvHeader("csv/exp_12_filter_leaves.csv",
+                 "hierarchy,file,startKey,endKey,items,probes,passes,scans,"
+                 "hits,observedFpr,predictedFpr,overBudget");
+  writeCsvHeader("csv/exp_12_filter_levels.csv",
+                 "hierarchy,depth,nodes,probes,passes,hits,passRate,"
+                 "observedFpr,avgPredictedFpr");
+}
+
+void writeExp12PerfHeaders() {
+  writeCsvHeader("csv/exp_12_perf.csv",
+                 "config,pass,query,path,phase," + perfCsvHeader("") +
+                     ",multiplexed");
+}
+
+namespace {
+
+// queries with hits per column before its internal levels are replanned
+constexpr uint64_t kRestructureAfter = 200;
+// the log is replayed this many times; the hierarchies adapt between passes
+constexpr size_t kReplayPasses = 2;
+
+struct ReplayConfig {
+  std::string label;
+  ProbeMode probeMode = ProbeMode::EarlyExit;
+  double foldTargetFpr = 0.0;
+  FilterKind filterKind = FilterKind::Bloom;
+};
+
+struct ReplayRow {
+  size_t pass = 0;
+  size_t query = 0;
+  uint64_t arrivalMicros = 0;
+  long long startLagMicros = 0;
+  size_t numColumns = 0;
+  long long multiTime = 0;
+  size_t multiBloomChecks = 0;
+  size_t multiLeafBloomChecks = 0;
+  size_t multiSSTChecks = 0;
+  size_t multiMatches = 0;
+  long long singleTime = 0;
+  size_t singleBloomChecks = 0;
+  size_t singleLeafBloomChecks = 0;
+  size_t singleSSTChecks = 0;
+  size_t singleMatches = 0;
+  // hardware counters per phase, filled with --perf-counters
+  PhasePerfCounts multiPerf{};
+  PhasePerfCounts singlePerf{};
+  bool multiPerfMultiplexed = false;
+  bool singlePerfMultiplexed = false;
+};
+
+// One pass over the log. The hierarchies stay fixed during it, so every
+// config answers the same queries with the same trees; leaf rebuilds and
+// restructures are applied between passes (adaptHierarchies).
+//
+// In timed mode a query that starts after its recorded arrival reports the
+// difference as startLagMicros.
+std::vector<ReplayRow> replay(const std::vector<QueryLogRecord>& log,
+                              DBManager& dbManager,
+                              std::map<std::string, BloomTree>& hierarchies,
+                              bool timed, size_t pass, size_t& skipped) {
+  using Clock = std::chrono::steady_clock;
+  std::vector<ReplayRow> rows;
+  rows.reserve(log.size());
+  skipped = 0;
+  StopWatch stopwatch;
+  Clock::time_point begin = Clock::now();
+
+  for (size_t i = 0; i < log.size(); ++i) {
+    const QueryLogRecord& record = log[i];
+    std::vector<BloomTree> trees;
+    for (const auto& column : record.columns) {
+      auto it = hierarchies.find(column);
+      if (it == hierarchies.end()) break;
+      trees.push_back(it->second);
+    }
+    if (trees.empty() || trees.size() != record.columns.size()) {
+      ++skipped;
+      continue;
+    }
+
+    ReplayRow row;
+    row.pass = pass;
+    row.query = i;
+    row.arrivalMicros = record.arrivalMicros;
+    row.numColumns = record.columns.size();
+    if (timed) {
+      Clock::time_point intended =
+          begin + std::chrono::microseconds(record.arrivalMicros);
+      std::this_thread::sleep_until(intended);
+      row.startLagMicros = std::chrono::duration_cast<std::chrono::microseconds>(
+                               Clock::now() - intended)
+                               .count();
+    }
+
+    QueryCounters multiCounters;
+    QueryCounterScope multiCountScope(multiCounters);
+    resetPerfCounters();
+    stopwatch.start();
+    row.multiMatches = multiColumnQueryHierarchical(trees, record.values,
+                                                    record.startKey,
+                                                    record.endKey, dbManager)
+                           .size();
+    stopwatch.stop();
+    row.multiTime = stopwatch.elapsedMicros();
+    row.multiBloomChecks = multiCounters.bloomChecks.load();
+    row.multiLeafBloomChecks = multiCounters.leafBloomChecks.load();
+    row.multiSSTChecks = multiCounters.sstChecks.load();
+    row.multiPerf = perfCountersByPhase();
+    row.multiPerfMultiplexed = perfCountersMultiplexed();
+
+    QueryCounters singleCounters;
+    QueryCounterScope singleCountScope(singleCounters);
+    resetPerfCounters();
+    stopwatch.start();
+    row.singleMatches = dbManager
+                            .findUsingSingleHierarchy(
+                                trees[0], record.columns, record.values,
+                                record.startKey, record.endKey)
+                            .size();
+    stopwatch.stop();
+    row.singleTime = stopwatch.elapsedMicros();
+    row.singleBloomChecks = singleCounters.bloomChecks.load();
+    row.singleLeafBloomChecks = singleCounters.leafBloomChecks.load();
+    row.singleSSTChecks = singleCounters.sstChecks.load();
+    row.singlePerf = perfCountersByPhase();
+    row.singlePerfMultiplexed = perfCountersMultiplexed();
+
+    rows.push_back(row);
+  }
+  return rows;
+}
+
+// Between passes: rebuilds the leaves the monitor finds over budget and
+// replans the internal levels of hierarchies that saw enough queries.
+// Returns the number of leaves rebuilt.
+size_t adaptHierarchies(std::map<std::string, BloomTree>& hierarchies,
+                        FilterMonitor& monitor, BloomManager& bloomManager) {
+  std::vector<std::future<std::vector<LeafRebuild>>> pending;
+  for (auto& [column, hierarchy] : hierarchies) {
+    std::vector<Node*> due = monitor.evaluate(hierarchy);
+    if (!due.empty()) pending.push_back(monitor.scheduleRebuild(std::move(due)));
+  }
+  size_t rebuilt = 0;
+  for (auto& rebuilds : pending) {
+    rebuilt += monitor.installRebuilds(rebuilds.get());
+  }
+  for (auto& [column, hierarchy] : hierarchies) {
+    bloomManager.maybeRestructure(hierarchy, kRestructureAfter);
+    bloomManager.finishRestructure(hierarchy);
+  }
+  return rebuilt;
+}
+
+}  // namespace
+
+void runExp12(const std::string& dbPath, size_t dbSize,
+              const std::string& queryLogPath, bool timed) {
+  const std::vector<std::string> columns = {"phone", "mail", "address"};
+  const std::vector<ReplayConfig> configs = {
+      {"bloom", ProbeMode::EarlyExit, 0.0, FilterKind::Bloom},
+      {"bloom_branchfree", ProbeMode::BranchFree, 0.0, FilterKind::Bloom},
+      {"bloom_folded", ProbeMode::EarlyExit, 0.01, FilterKind::Bloom},
+      {"quotient", ProbeMode::EarlyExit, 0.0, FilterKind::Quotient},
+  };
+
+  std::vector<QueryLogRecord> log = readQueryLog(queryLogPath);
+  if (log.empty()) {
+    spdlog::warn("Exp12: query log '{}' is empty, nothing to replay.",
+                 queryLogPath);
+    return;
+  }
+
+  writeExp12ReplayHeaders();
+  writeExp12SummaryHeaders();
+  writeExp12FilterHeaders();
+  if (perfCountersEnabled()) writeExp12PerfHeaders();
+
+  DBManager dbManager;
+  BloomManager bloomManager;
+  dbManager.openDB(dbPath, columns);
+
+  for (const auto& config : configs) {
+    TestParams params = {dbPath, static_cast<int>(dbSize), 3, 1, 100000, 4000000, 3};
+    params.probeMode = config.probeMode;
+    params.foldTargetFpr = config.foldTargetFpr;
+    params.filterKind = config.filterKind;
+
+    clearBloomFilterFiles(params.dbName);
+    std::map<std::string, BloomTree> hierarchies = buildHierarchies(
+        scanSstFilesAsync(columns, dbManager, params), bloomManager, params,
+        &dbManager);
+
+    // leaves over budget after a pass are rebuilt before the next one
+    FilterMonitor monitor(2.0, 100, 1);
+    std::ofstream out("csv/exp_12_replay.csv", std::ios::app);
+    std::ofstream summary("csv/exp_12_replay_summary.csv", std::ios::app);
+    std::ofstream perfOut;
+    if (perfCountersEnabled()) {
+      perfOut.open("csv/exp_12_perf.csv", std::ios::app);
+    }
+
+    for (size_t pass = 0; pass < kReplayPasses; ++pass) {
+      if (pass > 0) {
+        size_t rebuilt = adaptHierarchies(hierarchies, monitor, bloomManager);
+        spdlog::info("Exp12: config '{}' adapted before pass {}: {} leaf "
+                     "filters rebuilt.",
+                     config.label, pass, rebuilt);
+      }
+      size_t skipped = 0;
+      std::vector<ReplayRow> rows =
+          replay(log, dbManager, hierarchies, timed, pass, skipped);
+      spdlog::info("Exp12: config '{}' pass {} replayed {} queries ({} "
+                   "skipped).",
+                   config.label, pass, rows.size(), skipped);
+
+      std::vector<long long> multiTimes, singleTimes;
+      double multiBloom = 0, multiSST = 0, singleBloom = 0, singleSST = 0;
+      for (const auto& row : rows) {
+        out << config.label << "," << row.pass << "," << row.query << ","
+            << row.arrivalMicros << "," << row.startLagMicros << ","
+            << row.numColumns << "," << row.multiTime << ","
+            << row.multiBloomChecks << "," << row.multiLeafBloomChecks << ","
+            << row.multiSSTChecks << "," << row.multiMatches << ","
+            << row.singleTime << "," << row.singleBloomChecks << ","
+            << row.singleLeafBloomChecks << "," << row.singleSSTChecks << ","
+            << row.singleMatches << "\n";
+        for (size_t phase = 0; perfOut.is_open() && phase < kPerfPhases;
+             ++phase) {
+          const char* name = perfPhaseName(static_cast<PerfPhase>(phase));
+          perfOut << config.label << "," << row.pass << "," << row.query
+                  << ",multi," << name << ","
+                  << perfCsvValues(row.multiPerf[phase]) << ","
+                  << row.multiPerfMultiplexed << "\n";
+          perfOut << config.label << "," << row.pass << "," << row.query
+                  << ",single," << name << ","
+                  << perfCsvValues(row.singlePerf[phase]) << ","
+                  << row.singlePerfMultiplexed << "\n";
+        }
+        multiTimes.push_back(row.multiTime);
+        singleTimes.push_back(row.singleTime);
+        multiBloom += row.multiBloomChecks;
+        multiSST += row.multiSSTChecks;
+        singleBloom += row.singleBloomChecks;
+        singleSST += row.singleSSTChecks;
+      }
+
+      double n = rows.empty() ? 1.0 : static_cast<double>(rows.size());
+      LatencyPercentiles multi = calculateLatencyPercentiles(multiTimes);
+      LatencyPercentiles single = calculateLatencyPercentiles(singleTimes);
+      summary << config.label << "," << pass << "," << (timed ? 1 : 0) << ","
+              << rows.size() << "," << skipped << "," << multi.p50 << ","
+              << multi.p95 << "," << multi.p99 << "," << multi.max << ","
+              << multi.average << "," << single.p50 << "," << single.p99
+              << "," << multiBloom / n << "," << multiSST / n << ","
+              << singleBloom / n << "," << singleSST / n << "\n";
+    }
+
+    for (const auto& column : columns) {
+      const std::string label = config.label + ":" + column;
+      monitor.writeLeafStatsCsv("csv/exp_12_filter_leaves.csv", label,
+                                hierarchies.at(column));
+      monitor.writeLevelStatsCsv("csv/exp_12_filter_levels.csv", label,
+                                 hierarchies.at(column));
+    }
+  }
+
+  dbManager.closeDB();
+}
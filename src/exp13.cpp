@@ -0,0 +1,156 @@
+#include "exp13.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "algorithm.hpp"
+#include "bloomTree.hpp"
+#include "bloom_manager.hpp"
+#include "db_manager.hpp"
+#include "exp_utils.hpp"
+#include "stopwatch.hpp"
+#include "test_params.hpp"
+
+extern void clearBloomFilterFiles(const std::string& dbDir);
+
+void writeExp13Headers() {
+  writeCsvHeader("csv/exp_13_dictionary.csv",
+                 "numRecords,cardinality,encoded,sstBytes,insertTime,"
+                 "buildTime,filterMemory,dictionaryMemory,queries,"
+                 "avgMultiTime,avgSingleTime,avgScanTime,matches");
+}
+
+namespace {
+
+size_t columnSstBytes(DBManager& dbManager, const std::string& dbPath,
+                      const std::vector<std::string>& columns) {
+  size_t bytes = 0;
+  for (const auto& column : columns) {
+    for (const auto& file : dbManager.scanSSTFilesForColumn(dbPath, column)) {
+      std::error_code ec;
+      auto size = std::filesystem::file_size(file, ec);
+      if (!ec) bytes += size;
+    }
+  }
+  return bytes;
+}
+
+}  // namespace
+
+void runExp13(const std::string& baseDir, size_t dbSize) {
+  const std::vector<std::string> columns = {"phone", "mail", "address"};
+  const std::vector<size_t> cardinalities = {100, 10000, 1000000};
+  const int numQueries = 50;
+  // full scans read every record, fewer of them
+  const int numScans = 3;
+
+  writeExp13Headers();
+
+  for (size_t cardinality : cardinalities) {
+    // the same values are queried on both databases
+    std::mt19937 rng(static_cast<unsigned>(cardinality));
+    std::uniform_int_distribution<size_t> pick(1, cardinality);
+    std::vector<std::vector<std::string>> queryValues(numQueries);
+    for (auto& values : queryValues) {
+      size_t v = pick(rng);
+      for (const auto& column : columns) {
+        values.push_back(column + "_value" + std::to_string(v));
+      }
+    }
+
+    for (bool encoded : {false, true}) {
+      const std::string dbPath = baseDir + "/exp13_" +
+                                 std::to_string(cardinality) +
+                                 (encoded ? "_dict" : "_plain");
+      std::filesystem::remove_all(dbPath);
+      clearBloomFilterFiles(dbPath);
+
+      DBManager dbManager;
+      BloomManager bloomManager;
+      TestParams params = {dbPath, static_cast<int>(dbSize), 3, 1, 100000,
+                           4000000, 3};
+
+      StopWatch sw;
+      sw.start();
+      dbManager.openDB(dbPath, columns);
+      if (encoded) {
+        for (const auto& column : columns) {
+          dbManager.enableDictionaryEncoding(column);
+        }
+      }
+      dbManager.insertRecords(static_cast<int>(dbSize), columns, cardinality);
+      dbManager.compactAllColumnFamilies(dbSize);
+      sw.stop();
+      const auto insertTime = sw.elapsedMicros();
+      const size_t sstBytes = columnSstBytes(dbManager, dbPath, columns);
+
+      sw.start();
+      std::map<std::string, BloomTree> hierarchies = buildHierarchies(
+          scanSstFilesAsync(columns, dbManager, params), bloomManager, params,
+          &dbManager);
+      sw.stop();
+      const auto buildTime = sw.elapsedMicros();
+
+      size_t filterMemory = 0;
+      size_t dictionaryMemory = 0;
+      std::vector<BloomTree> trees;
+      for (const auto& column : columns) {
+        const BloomTree& tree = hierarchies.at(column);
+        filterMemory += tree.memorySize();
+        if (tree.dictionary) dictionaryMemory += tree.dictionary->memorySize();
+        trees.push_back(tree);
+      }
+
+      long long multiTotal = 0;
+      long long singleTotal = 0;
+      long long scanTotal = 0;
+      size_t matches = 0;
+      for (int q = 0; q < numQueries; ++q) {
+        const auto& values = queryValues[q];
+        sw.start();
+        matches += multiColumnQueryHierarchical(trees, values, "", "",
+                                                dbManager)
+                       .size();
+        sw.stop();
+        multiTotal += sw.elapsedMicros();
+
+        sw.start();
+        dbManager.findUsingSingleHierarchy(hierarchies.at(columns[0]), columns,
+                                           values);
+        sw.stop();
+        singleTotal += sw.elapsedMicros();
+
+        if (q < numScans) {
+          sw.start();
+          dbManager.scanForRecordsInColumns(columns, values);
+          sw.stop();
+          scanTotal += sw.elapsedMicros();
+        }
+      }
+
+      std::ofstream out("csv/exp_13_dictionary.csv", std::ios::app);
+      if (!out) {
+        spdlog::error("Exp13: Nie udało się otworzyć pliku wynikowego!");
+        return;
+      }
+      out << dbSize << "," << cardinality << "," << (encoded ? 1 : 0) << ","
+          << sstBytes << "," << insertTime << "," << buildTime << ","
+          << filterMemory << "," << dictionaryMemory << "," << numQueries
+          << "," << multiTotal / numQueries << "," << singleTotal / numQueries
+          << "," << scanTotal / numScans << "," << matches << "\n";
+      spdlog::info(
+          "Exp13: cardinality {} {}: {} SST bytes, query avg {} µs, scan avg "
+          "{} µs",
+          cardinality, encoded ? "encoded" : "plain", sstBytes,
+          multiTotal / numQueries, scanTotal / numScans);
+
+      dbManager.closeDB();
+    }
+  }
+}
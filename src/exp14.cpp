@@ -0,0 +1,221 @@
+#include "exp14.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <random>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "algorithm.hpp"
+#include "bloomTree.hpp"
+#include "bloom_manager.hpp"
+#include "db_manager.hpp"
+#include "exp_utils.hpp"
+#include "stopwatch.hpp"
+#include "test_params.hpp"
+
+extern void clearBloomFilterFiles(const std::string& dbDir);
+
+void writeExp14Headers() {
+  writeCsvHeader("csv/exp_14_index_vs_hierarchy.csv",
+                 "numRecords,cardinality,engine,structureDiskBytes,"
+                 "structureMemoryBytes,buildTime,writeRecords,writeTime,"
+                 "writeAmplification,queries,avgRealTime,avgFalseTime,"
+                 "p50Time,p99Time,avgMatches");
+}
+
+namespace {
+
+struct EngineRow {
+  std::string engine;
+  size_t diskBytes = 0;
+  size_t memoryBytes = 0;
+  long long buildTime = 0;
+  long long writeTime = 0;
+  double writeAmplification = 1.0;
+};
+
+struct QueryRun {
+  double avgReal = 0.0;
+  double avgFalse = 0.0;
+  LatencyPercentiles latency;
+  double avgMatches = 0.0;
+};
+
+using QueryFn =
+    std::function<std::vector<std::string>(const std::vector<std::string>&)>;
+
+QueryRun timeQueries(const std::vector<std::vector<std::string>>& queries,
+                     size_t realQueries, const QueryFn& query) {
+  QueryRun run;
+  std::vector<long long> times;
+  size_t matches = 0;
+  long long realTotal = 0;
+  long long falseTotal = 0;
+  for (size_t q = 0; q < queries.size(); ++q) {
+    StopWatch sw;
+    sw.start();
+    matches += query(queries[q]).size();
+    sw.stop();
+    times.push_back(sw.elapsedMicros());
+    (q < realQueries ? realTotal : falseTotal) += sw.elapsedMicros();
+  }
+  size_t falseQueries = queries.size() - realQueries;
+  run.avgReal = realQueries ? static_cast<double>(realTotal) / realQueries : 0;
+  run.avgFalse =
+      falseQueries ? static_cast<double>(falseTotal) / falseQueries : 0;
+  run.avgMatches =
+      queries.empty() ? 0 : static_cast<double>(matches) / queries.size();
+  run.latency = calculateLatencyPercentiles(std::move(times));
+  return run;
+}
+
+// new keys past the loaded ones, so the timed write is the same for every
+// engine
+std::vector<std::tuple<std::string, std::string, std::string>> exp14Writes(
+    const std::vector<std::string>& columns, size_t first, size_t count) {
+  std::vector<std::tuple<std::string, std::string, std::string>> mods;
+  for (size_t i = first; i < first + count; ++i) {
+    std::string index = std::to_string(i);
+    std::string key = "key" + std::string(20 - index.size(), '0') + index;
+    for (const auto& column : columns) {
+      mods.emplace_back(key, column, column + "_value" + index);
+    }
+  }
+  return mods;
+}
+
+}  // namespace
+
+void runExp14(const std::string& baseDir, size_t dbSize) {
+  const std::vector<std::string> columns = {"phone", "mail", "address"};
+  const std::vector<size_t> cardinalities = {0, 1000};
+  const size_t numQueries = 100;
+  const size_t numScanQueries = 4;
+  const size_t writeRecords = 100000;
+
+  writeExp14Headers();
+
+  for (size_t cardinality : cardinalities) {
+    const std::string dbPath =
+        baseDir + "/exp14_" + std::to_string(cardinality);
+    std::filesystem::remove_all(dbPath);
+    clearBloomFilterFiles(dbPath);
+
+    DBManager dbManager;
+    BloomManager bloomManager;
+    TestParams params = {dbPath, static_cast<int>(dbSize), 3, 1, 100000,
+                         4000000, 3};
+    dbManager.openDB(dbPath, columns);
+    dbManager.insertRecords(static_cast<int>(dbSize), columns, cardinality);
+    dbManager.compactAllColumnFamilies(dbSize);
+
+    // half present (the same index in every column), half absent
+    const size_t valueRange = cardinality > 0 ? cardinality : dbSize;
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<size_t> pick(1, valueRange);
+    std::vector<std::vector<std::string>> queries(numQueries);
+    const size_t realQueries = numQueries / 2;
+    for (size_t q = 0; q < numQueries; ++q) {
+      size_t v = pick(rng);
+      for (const auto& column : columns) {
+        queries[q].push_back(column + (q < realQueries ? "_value" : "_absent") +
+                             std::to_string(v));
+      }
+    }
+    std::vector<std::vector<std::string>> scanQueries(
+        queries.begin(), queries.begin() + numScanQueries / 2);
+    scanQueries.insert(scanQueries.end(), queries.begin() + realQueries,
+                       queries.begin() + realQueries + numScanQueries / 2);
+
+    EngineRow scan{"scan"};
+    QueryRun scanRun =
+        timeQueries(scanQueries, numScanQueries / 2, [&](const auto& values) {
+          return dbManager.scanForRecordsInColumns(columns, values);
+        });
+
+    EngineRow hierarchy{"hierarchy"};
+    StopWatch sw;
+    sw.start();
+    std::map<std::string, BloomTree> hierarchies = buildHierarchies(
+        scanSstFilesAsync(columns, dbManager, params), bloomManager, params,
+        &dbManager);
+    sw.stop();
+    hierarchy.buildTime = sw.elapsedMicros();
+    std::vector<BloomTree> trees;
+    for (const auto& column : columns) {
+      hierarchy.diskBytes += hierarchies.at(column).diskSize();
+      hierarchy.memoryBytes += hierarchies.at(column).memorySize();
+      trees.push_back(hierarchies.at(column));
+    }
+    QueryRun hierarchyRun =
+        timeQueries(queries, realQueries, [&](const auto& values) {
+          return multiColumnQueryHierarchical(trees, values, "", "", dbManager);
+        });
+
+    // without an index a write is just the values; the hierarchy picks them
+    // up on its next refresh
+    sw.start();
+    dbManager.writeModifications(exp14Writes(columns, dbSize + 1, writeRecords));
+    sw.stop();
+    scan.writeTime = hierarchy.writeTime = sw.elapsedMicros();
+
+    EngineRow index{"index"};
+    // the writes above are flushed first, so only the index build is timed
+    dbManager.flushAllColumnFamilies();
+    sw.start();
+    for (const auto& column : columns) {
+      dbManager.enableSecondaryIndex(column);
+    }
+    dbManager.flushAllColumnFamilies();
+    sw.stop();
+    index.buildTime = sw.elapsedMicros();
+
+    SecondaryIndexStats before = dbManager.secondaryIndexStats();
+    index.diskBytes = before.indexBytes;
+    sw.start();
+    dbManager.writeModifications(
+        exp14Writes(columns, dbSize + writeRecords + 1, writeRecords));
+    sw.stop();
+    index.writeTime = sw.elapsedMicros();
+    SecondaryIndexStats after = dbManager.secondaryIndexStats();
+    uint64_t valueBytes = after.valueBytesWritten - before.valueBytesWritten;
+    uint64_t indexBytes = after.indexBytesWritten - before.indexBytesWritten;
+    index.writeAmplification =
+        valueBytes ? static_cast<double>(valueBytes + indexBytes) / valueBytes
+                   : 0.0;
+    QueryRun indexRun =
+        timeQueries(queries, realQueries, [&](const auto& values) {
+          return dbManager.findUsingSecondaryIndex(columns, values);
+        });
+
+    const std::vector<std::pair<EngineRow, QueryRun>> rows = {
+        {scan, scanRun}, {hierarchy, hierarchyRun}, {index, indexRun}};
+    std::ofstream out("csv/exp_14_index_vs_hierarchy.csv", std::ios::app);
+    if (!out) {
+      spdlog::error("Exp14: Nie udało się otworzyć pliku wynikowego!");
+      return;
+    }
+    for (const auto& [row, run] : rows) {
+      size_t queriesRun =
+          row.engine == "scan" ? scanQueries.size() : queries.size();
+      out << dbSize << "," << cardinality << "," << row.engine << ","
+          << row.diskBytes << "," << row.memoryBytes << "," << row.buildTime
+          << "," << writeRecords << "," << row.writeTime << ","
+          << row.writeAmplification << "," << queriesRun << "," << run.avgReal
+          << "," << run.avgFalse << "," << run.latency.p50 << ","
+          << run.latency.p99 << "," << run.avgMatches << "\n";
+      spdlog::info(
+          "Exp14: cardinality {} {}: {} bytes, build {} µs, p50 {} µs, p99 {} "
+          "µs",
+          cardinality, row.engine, row.diskBytes + row.memoryBytes,
+          row.buildTime, run.latency.p50, run.latency.p99);
+    }
+    dbManager.closeDB();
+  }
+}
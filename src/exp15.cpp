@@ -0,0 +1,200 @@
+#include "exp15.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "algorithm.hpp"
+#include "bloomTree.hpp"
+#include "bloom_manager.hpp"
+#include "db_manager.hpp"
+#include "exp_utils.hpp"
+#include "stopwatch.hpp"
+#include "test_params.hpp"
+
+extern void clearBloomFilterFiles(const std::string& dbDir);
+
+void writeExp15Headers() {
+  writeCsvHeader("csv/exp_15_predicates.csv",
+                 "numRecords,kind,column,pattern,totalLeaves,candidateLeaves,"
+                 "pruningRate,matches,time");
+  writeCsvHeader("csv/exp_15_count_estimates.csv",
+                 "numRecords,columns,values,estimate,lowerBound,errorBound,"
+                 "confidence,leafCombos,exactCount,estimateTime,exactTime");
+}
+
+namespace {
+
+struct PredicateRow {
+  std::string kind;
+  std::string column;
+  std::string pattern;
+  size_t totalLeaves = 0;
+  size_t candidateLeaves = 0;
+  size_t matches = 0;
+  long long time = 0;
+};
+
+void appendPredicateRow(size_t dbSize, const PredicateRow& row) {
+  std::ofstream out("csv/exp_15_predicates.csv", std::ios::app);
+  if (!out) {
+    spdlog::error("Exp15: Nie udało się otworzyć pliku wynikowego!");
+    return;
+  }
+  double pruningRate =
+      row.totalLeaves == 0
+          ? 0.0
+          : 1.0 - static_cast<double>(row.candidateLeaves) / row.totalLeaves;
+  out << dbSize << "," << row.kind << "," << row.column << "," << row.pattern
+      << "," << row.totalLeaves << "," << row.candidateLeaves << ","
+      << pruningRate << "," << row.matches << "," << row.time << "\n";
+  spdlog::info("Exp15: {} '{}' on {}: {}/{} leaves, {} matches, {} µs",
+               row.kind, row.pattern, row.column, row.candidateLeaves,
+               row.totalLeaves, row.matches, row.time);
+}
+
+// Zone maps compare values byte-wise, so a numeric range over the
+// generated, unpadded "<column>_value<N>" values is not a value range.
+// Prefix ranges [p, p + "\xff"] are: they hold exactly the values starting
+// with p, and shorter prefixes make wider ranges.
+std::vector<std::string> rangePrefixes(const std::string& column) {
+  return {column + "_value123456", column + "_value12345",
+          column + "_value1234", column + "_value123", column + "_value12"};
+}
+
+// Equality queries for the count estimates: one to three columns of the
+// same record, columns of different records (no match) and an absent value.
+std::vector<std::vector<std::string>> countQueries(
+    const std::vector<std::string>& columns) {
+  return {{columns[0] + "_value4242"},
+          {columns[0] + "_value4242", columns[1] + "_value4242"},
+          {columns[0] + "_value4242", columns[1] + "_value4242",
+           columns[2] + "_value4242"},
+          {columns[0] + "_value4242", columns[1] + "_value2424"},
+          {columns[0] + "_absent"}};
+}
+
+// Substring patterns over the n-gram filtered column, from present and long
+// (few candidate leaves) to short (every leaf) and absent.
+std::vector<std::string> textPatterns(const std::string& column) {
+  return {column + "_value9876543", "9876543", "98765", "_value", "@absent"};
+}
+
+}  // namespace
+
+void runExp15(const std::string& dbPath, size_t dbSize) {
+  const std::vector<std::string> columns = {"phone", "mail", "address"};
+  const std::string textColumn = "mail";
+
+  writeExp15Headers();
+
+  DBManager dbManager;
+  BloomManager bloomManager;
+  TestParams params = {dbPath, static_cast<int>(dbSize), 3, 1, 100000, 4000000, 3};
+  params.ngramColumns = {textColumn};
+  // sketches for the count estimates; ~8 overcount per 100k-item leaf
+  params.sketchWidth = 32768;
+
+  clearBloomFilterFiles(params.dbName);
+  dbManager.openDB(params.dbName);
+  std::map<std::string, BloomTree> hierarchies = buildHierarchies(
+      scanSstFilesAsync(columns, dbManager, params), bloomManager, params,
+      &dbManager);
+
+  // single-column ranges
+  for (const auto& column : columns) {
+    BloomTree& tree = hierarchies.at(column);
+    for (const auto& prefix : rangePrefixes(column)) {
+      const std::string high = prefix + "\xff";
+      PredicateRow row{"range", column, prefix, tree.leafNodes.size()};
+      row.candidateLeaves = tree.queryRangeNodes(prefix, high, "", "").size();
+      StopWatch sw;
+      sw.start();
+      row.matches = dbManager.findKeysInValueRange(tree, prefix, high).size();
+      sw.stop();
+      row.time = sw.elapsedMicros();
+      appendPredicateRow(dbSize, row);
+    }
+  }
+
+  // substring and prefix predicates, pruned with the n-gram filters
+  BloomTree& textTree = hierarchies.at(textColumn);
+  for (bool prefixOnly : {false, true}) {
+    for (const auto& pattern : textPatterns(textColumn)) {
+      PredicateRow row{prefixOnly ? "prefix" : "contains", textColumn, pattern,
+                       textTree.leafNodes.size()};
+      row.candidateLeaves =
+          textTree.queryTextNodes(pattern, prefixOnly, "", "").size();
+      StopWatch sw;
+      sw.start();
+      row.matches =
+          dbManager.findKeysMatchingText(textTree, pattern, prefixOnly).size();
+      sw.stop();
+      row.time = sw.elapsedMicros();
+      appendPredicateRow(dbSize, row);
+    }
+  }
+
+  // range on the first column, equality on the second: the combination
+  // prunes more than either predicate alone
+  std::vector<BloomTree> trees = {hierarchies.at(columns[0]),
+                                  hierarchies.at(columns[1])};
+  for (const auto& prefix : rangePrefixes(columns[0])) {
+    // the record whose index is the prefix's number is in the range
+    const std::string number = prefix.substr(columns[0].size() + 6);
+    std::vector<ColumnPredicate> predicates = {
+        ColumnPredicate::between(prefix, prefix + "\xff"),
+        ColumnPredicate::equal(columns[1] + "_value" + number)};
+    PredicateRow row{"range_and_equal", columns[0] + "+" + columns[1], prefix,
+                     trees[0].leafNodes.size()};
+    QueryCounters counters;
+    QueryCounterScope countScope(counters);
+    StopWatch sw;
+    sw.start();
+    row.matches = multiColumnQueryHierarchical(trees, predicates, "", "",
+                                               dbManager)
+                      .size();
+    sw.stop();
+    row.time = sw.elapsedMicros();
+    // leaf combos scanned, each touching one leaf per column
+    row.candidateLeaves = counters.sstChecks.load() / trees.size();
+    appendPredicateRow(dbSize, row);
+  }
+
+  // count estimates from the leaf sketches against the exact count
+  std::ofstream counts("csv/exp_15_count_estimates.csv", std::ios::app);
+  if (!counts) {
+    spdlog::error("Exp15: Nie udało się otworzyć pliku wynikowego!");
+    dbManager.closeDB();
+    return;
+  }
+  for (const auto& values : countQueries(columns)) {
+    std::vector<BloomTree> countTrees;
+    std::string columnList;
+    std::string valueList;
+    for (size_t i = 0; i < values.size(); ++i) {
+      countTrees.push_back(hierarchies.at(columns[i]));
+      columnList += (i ? "+" : "") + columns[i];
+      valueList += (i ? "+" : "") + values[i];
+    }
+    CountEstimate estimate =
+        estimateMultiColumnCount(countTrees, values, "", "", dbManager);
+    StopWatch sw;
+    sw.start();
+    size_t exactCount =
+        multiColumnQueryHierarchical(countTrees, values, "", "", dbManager)
+            .size();
+    sw.stop();
+    counts << dbSize << "," << columnList << "," << valueList << ","
+           << estimate.estimate << "," << estimate.lowerBound << ","
+           << estimate.errorBound << "," << estimate.confidence << ","
+           << estimate.leafCombos << "," << exactCount << ","
+           << estimate.elapsedMicros << "," << sw.elapsedMicros() << "\n";
+  }
+  counts.close();
+
+  dbManager.closeDB();
+}
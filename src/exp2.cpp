@@ -19,6 +19,7 @@
 #include "bloom_manager.hpp"
 #include "db_manager.hpp"
 #include "exp_utils.hpp"
+#include "memory_accounting.hpp"
 
 extern void clearBloomFilterFiles(const std::string& dbDir);
 extern boost::asio::thread_pool globalThreadPool;
@@ -41,6 +42,8 @@ void runExp2(const std::string& dbPath, size_t dbSize) {
                                                  1000000};
 
   writeCSVheaders();
+  // exp2 measures no timings, so the accounting overhead does not matter
+  enableMemoryAccounting(true);
 
   DBManager dbManager;
   BloomManager bloomManager;
@@ -60,7 +63,9 @@ void runExp2(const std::string& dbPath, size_t dbSize) {
     std::map<std::string, std::vector<std::string>> columnSstFiles =
         scanSstFilesAsync(columns, dbManager, params);
 
-    hierarchies = buildHierarchies(columnSstFiles, bloomManager, params);
+    resetMemoryPeaks();
+    hierarchies = buildHierarchies(columnSstFiles, bloomManager, params,
+                                   &dbManager);
 
     size_t totalDiskBloomSize = 0;
     size_t totalMemoryBloomSize = 0;
@@ -84,6 +89,10 @@ void runExp2(const std::string& dbPath, size_t dbSize) {
                                          params.itemsPerPartition)
         << "," << totalDiskBloomSize << "," << totalMemoryBloomSize << "\n";
     out.close();
+
+    appendMemoryCsvRows("csv/exp_2_memory.csv",
+                        std::to_string(dbSize) + "," + std::to_string(items),
+                        dbManager);
   }
   spdlog::info("ExpBloomMetrics: Closing database '{}'.", dbPath);
   dbManager.closeDB();  // Close DB once after all iterations
@@ -92,4 +101,5 @@ void runExp2(const std::string& dbPath, size_t dbSize) {
 void writeCSVheaders() {
   writeCsvHeader("csv/exp_2_bloom_metrics.csv", 
                  "dbSize,itemsPerPartition,leafs,falsePositive,diskBloomSize,memoryBloomSize");
+  writeMemoryCsvHeader("csv/exp_2_memory.csv", "dbSize,itemsPerPartition");
 }
\ No newline at end of file
@@ -32,7 +32,6 @@ struct TestParams {
 };
 
 extern void clearBloomFilterFiles(const std::string& dbDir);
-extern std::atomic<size_t> gBloomCheckCount;
 extern boost::asio::thread_pool globalThreadPool;
 
 void runExp4(std::string baseDir, bool initMode) {
@@ -108,30 +107,24 @@ void runExp4(std::string baseDir, bool initMode) {
         std::vector<std::string> globalMatches = dbManager.scanForRecordsInColumns(columns, expectedValues);
         stopwatch.stop();
         auto globalScanTime = stopwatch.elapsedMicros();
-        size_t bloomChecks = gBloomCheckCount.load();
-        spdlog::info("Global Total bloom‐filter checks this query: {}", bloomChecks);
-        // Reset for the next experiment if you like:
-        gBloomCheckCount = 0;
         // --- Hierarchical Multi-Column Query ---
+        QueryCounters multiCounters;
+        QueryCounterScope multiCountScope(multiCounters);
         stopwatch.start();
         std::vector<std::string> hierarchicalMatches = multiColumnQueryHierarchical(queryTrees, expectedValues, "", "", dbManager);
         stopwatch.stop();
         auto hierarchicalMultiTime = stopwatch.elapsedMicros();
-        bloomChecks = gBloomCheckCount.load();
-        spdlog::info("Multi Total bloom‐filter checks this query: {}", bloomChecks);
+        spdlog::info("Multi Total bloom‐filter checks this query: {}", multiCounters.bloomChecks.load());
 
-        // Reset for the next experiment if you like:
-        gBloomCheckCount = 0;
         // --- Hierarchical Single Column Query ---
+        QueryCounters singleCounters;
+        QueryCounterScope singleCountScope(singleCounters);
         stopwatch.start();
         std::vector<std::string> singlehierarchyMatches = dbManager.findUsingSingleHierarchy(queryTrees[0], columns, expectedValues);
         stopwatch.stop();
         auto hierarchicalSingleTime = stopwatch.elapsedMicros();
-        bloomChecks = gBloomCheckCount.load();
-        spdlog::info("Single Total bloom‐filter checks this query: {}", bloomChecks);
+        spdlog::info("Single Total bloom‐filter checks this query: {}", singleCounters.bloomChecks.load());
 
-        // Reset for the next experiment if you like:
-        gBloomCheckCount = 0;
         // Zapis wyników do pliku CSV
         out << params.numRecords << ","
             << dbSize << ","
@@ -70,6 +70,10 @@ void writeExp5TimingComparisonHeaders() {
                  "avgHierarchicalMultiTime,avgHierarchicalSingleTime");
 }
 
+void writeExp5PerfHeaders() {
+  writePerfCsvHeader("csv/exp_5_perf.csv", "numRecords,itemsPerPartition");
+}
+
 void runExp5(const std::string& dbPath, size_t dbSizeParam, bool skipDbScan) {
   const std::vector<std::string> columns = {"phone", "mail", "address"};
   const size_t bloomFilterSize = 4'000'000;
@@ -84,6 +88,7 @@ void runExp5(const std::string& dbPath, size_t dbSizeParam, bool skipDbScan) {
   writeExp5RealDataPerColumnHeaders();
   writeExp5PartitionEfficiencyHeaders();
   writeExp5TimingComparisonHeaders();
+  if (perfCountersEnabled()) writeExp5PerfHeaders();
 
   DBManager dbManager;
   BloomManager bloomManager;
@@ -101,11 +106,21 @@ void runExp5(const std::string& dbPath, size_t dbSizeParam, bool skipDbScan) {
         scanSstFilesAsync(columns, dbManager, params);
 
     std::map<std::string, BloomTree> hierarchies =
-        buildHierarchies(columnSstFiles, bloomManager, params);
+        buildHierarchies(columnSstFiles, bloomManager, params, &dbManager);
 
     // Run standard queries first
     AggregatedQueryTimings timings = runStandardQueries(
         dbManager, hierarchies, columns, dbSizeParam, numQueryRuns, skipDbScan);
+    if (perfCountersEnabled()) {
+      const std::string perfPrefix = std::to_string(params.numRecords) + "," +
+                                     std::to_string(currentItemsPerPartition);
+      appendPerfCsvRows("csv/exp_5_perf.csv", perfPrefix, "multi",
+                        timings.multiPerf, timings.runs,
+                        timings.perfMultiplexed);
+      appendPerfCsvRows("csv/exp_5_perf.csv", perfPrefix, "single",
+                        timings.singlePerf, timings.runs,
+                        timings.perfMultiplexed);
+    }
 
     double falsePositiveProb = getProbabilityOfFalsePositive(
         params.bloomSize, params.numHashFunctions, params.itemsPerPartition);
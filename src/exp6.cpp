@@ -17,6 +17,7 @@
 #include "bloom_manager.hpp"
 #include "db_manager.hpp"
 #include "exp_utils.hpp"
+#include "memory_accounting.hpp"
 #include "stopwatch.hpp"
 #include "test_params.hpp"
 
@@ -70,6 +71,14 @@ void writeExp6TimingComparisonHeaders() {
                  "avgHierarchicalMultiTime,avgHierarchicalSingleTime");
 }
 
+void writeExp6MemoryHeaders() {
+  writeMemoryCsvHeader("csv/exp_6_memory.csv", "numRecords,bloomSize,phase");
+}
+
+void writeExp6PerfHeaders() {
+  writePerfCsvHeader("csv/exp_6_perf.csv", "numRecords,bloomSize");
+}
+
 void runExp6(const std::string& dbPath, size_t dbSize, bool skipDbScan) {
   const std::vector<std::string> columns = {"phone", "mail", "address"};
   const std::vector<size_t> bloomSizes = {2000000, 4000000, 8000000};
@@ -83,6 +92,9 @@ void runExp6(const std::string& dbPath, size_t dbSize, bool skipDbScan) {
   writeExp6RealDataPerColumnHeaders();
   writeExp6SizeEfficiencyHeaders();
   writeExp6TimingComparisonHeaders();
+  // only with --memory-accounting, the hooks would skew the timings
+  if (memoryAccountingEnabled()) writeExp6MemoryHeaders();
+  if (perfCountersEnabled()) writeExp6PerfHeaders();
 
   DBManager dbManager;
   BloomManager bloomManager;
@@ -100,12 +112,32 @@ void runExp6(const std::string& dbPath, size_t dbSize, bool skipDbScan) {
     std::map<std::string, std::vector<std::string>> columnSstFiles =
         scanSstFilesAsync(columns, dbManager, params);
 
+    resetMemoryPeaks();
     std::map<std::string, BloomTree> hierarchies =
-        buildHierarchies(columnSstFiles, bloomManager, params);
+        buildHierarchies(columnSstFiles, bloomManager, params, &dbManager);
+    const std::string memoryPrefix =
+        std::to_string(dbSize) + "," + std::to_string(bloomSize);
+    if (memoryAccountingEnabled()) {
+      appendMemoryCsvRows("csv/exp_6_memory.csv", memoryPrefix + ",build",
+                          dbManager);
+      resetMemoryPeaks();
+    }
 
     // Run standard queries first
     AggregatedQueryTimings timings = runStandardQueries(
         dbManager, hierarchies, columns, dbSize, numQueryRuns, skipDbScan);
+    if (memoryAccountingEnabled()) {
+      appendMemoryCsvRows("csv/exp_6_memory.csv", memoryPrefix + ",query",
+                          dbManager);
+    }
+    if (perfCountersEnabled()) {
+      appendPerfCsvRows("csv/exp_6_perf.csv", memoryPrefix, "multi",
+                        timings.multiPerf, timings.runs,
+                        timings.perfMultiplexed);
+      appendPerfCsvRows("csv/exp_6_perf.csv", memoryPrefix, "single",
+                        timings.singlePerf, timings.runs,
+                        timings.perfMultiplexed);
+    }
 
     double falsePositiveProb = getProbabilityOfFalsePositive(
         params.bloomSize, params.numHashFunctions, params.itemsPerPartition);
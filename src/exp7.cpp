@@ -21,6 +21,7 @@
 #include "algorithm.hpp"
 #include "bloomTree.hpp"
 #include "bloom_manager.hpp"
+#include "dataset_manager.hpp"
 #include "db_manager.hpp"
 #include "exp_utils.hpp"
 #include "stopwatch.hpp"
@@ -28,9 +29,6 @@
 
 extern void clearBloomFilterFiles(const std::string& dbDir);
 extern boost::asio::thread_pool globalThreadPool;
-extern std::atomic<size_t> gBloomCheckCount;
-extern std::atomic<size_t> gLeafBloomCheckCount;
-extern std::atomic<size_t> gSSTCheckCount;
 
 void writeExp7ChecksCSVHeaders() {
   writeCsvHeader(
@@ -101,8 +99,7 @@ void runExp7(const std::string& dbPathToUse, size_t dbSizeToUse,
       4000000,  // bloomSize - default or from a config
       3         // numHashFunctions - default or from a config
   };
-  DBManager dbManager;
-  BloomManager bloomManager;
+  DatasetManager dataset(params, columns);
 
   writeExp7ChecksCSVHeaders();
   writeExp7DerivedMetricsCSVHeaders();
@@ -111,10 +108,11 @@ void runExp7(const std::string& dbPathToUse, size_t dbSizeToUse,
   writeExp7OverviewCSVHeaders();
   writeExp7SelectedAvgChecksCSVHeaders();
 
+  // the base stays untouched; each trial gets a checkpoint clone with its
+  // target values flushed to new L0 files, and only their leaves are built
+  dataset.open();
+
   for (const auto& numTargetRecords : targetItemsLoopVar) {
-    dbManager.openDB(params.dbName, columns);
-    std::vector<std::tuple<std::string, std::string, std::string>>
-        originalDataToRevert;
     std::vector<std::tuple<std::string, std::string, std::string>>
         modificationsToApply;
     std::vector<std::string> currentExpectedValues;
@@ -124,42 +122,34 @@ void runExp7(const std::string& dbPathToUse, size_t dbSizeToUse,
       std::string currentKey =
           createPrefixedKeyExp7(recordIndex, params.numRecords);
       for (const auto& column : columns) {
-        try {
-          std::string originalValue = dbManager.getValue(column, currentKey);
-          originalDataToRevert.emplace_back(currentKey, column, originalValue);
-          spdlog::info("Exp7: Stored original for key '{}', col '{}': '{}'",
-                       currentKey, column, originalValue);
-        } catch (const std::exception& e) {
-          spdlog::warn(
-              "Exp7: Failed to get original value for key '{}', col '{}': {}. "
-              "Storing empty for revert.",
-              currentKey, column, e.what());
-          originalDataToRevert.emplace_back(currentKey, column, "");
-        }
         std::string targetValue = column + "_target";
         modificationsToApply.emplace_back(currentKey, column, targetValue);
         currentExpectedValues.push_back(targetValue);
       }
     }
 
-    spdlog::info("Exp7: Applying modifications to DB...");
-    rocksdb::Status s_modify =
-        dbManager.applyModifications(modificationsToApply, params.numRecords);
-    if (!s_modify.ok()) {
+    spdlog::info("Exp7: Cloning dataset with {} modifications...",
+                 modificationsToApply.size());
+    std::unique_ptr<DatasetClone> clone;
+    try {
+      clone = dataset.createClone(modificationsToApply, CloneLayout::Flushed);
+    } catch (const std::exception& e) {
       spdlog::error("Exp7: Failed to apply modifications to target records: {}",
-                    s_modify.ToString());
-      dbManager.closeDB();
+                    e.what());
       return;
     }
+    DBManager& dbManager = clone->db;
+    const std::map<std::string, BloomTree>& hierarchies = clone->hierarchies;
 
-    clearBloomFilterFiles(params.dbName);
-
-    std::map<std::string, BloomTree> hierarchies;
-
-    std::map<std::string, std::vector<std::string>> columnSstFiles =
-        scanSstFilesAsync(columns, dbManager, params);
+    std::map<std::string, std::vector<std::string>> columnSstFiles;
+    for (const auto& column : columns) {
+      for (const auto& level :
+           dbManager.scanSSTFilesByLevel(clone->path, column)) {
+        columnSstFiles[column].insert(columnSstFiles[column].end(),
+                                      level.begin(), level.end());
+      }
+    }
 
-    hierarchies = buildHierarchies(columnSstFiles, bloomManager, params);
     std::vector<std::string> targetColumns;
     for (const auto& column : columns) {
       targetColumns.push_back(column + "_target");
@@ -291,8 +281,7 @@ void runExp7(const std::string& dbPathToUse, size_t dbSizeToUse,
         << timings.singleCol_nonLeafBloomChecksStats.average << ","
         << timings.singleCol_sstChecksStats.average << "\n";
 
-    dbManager.revertModifications(originalDataToRevert, params.numRecords);
-    dbManager.closeDB();
+    dataset.releaseClone(std::move(clone));
     checks_csv_out.close();
     derived_csv_out.close();
     per_column_csv_out.close();
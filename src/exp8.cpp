@@ -17,6 +17,7 @@
 #include "bloom_manager.hpp"
 #include "db_manager.hpp"
 #include "exp_utils.hpp"
+#include "memory_accounting.hpp"
 #include "stopwatch.hpp"
 
 extern void clearBloomFilterFiles(const std::string& dbDir);
@@ -70,6 +71,14 @@ void writeExp8TimingComparisonHeaders() {
                  "avgHierarchicalMultiTime,avgHierarchicalSingleTime");
 }
 
+void writeExp8MemoryHeaders() {
+  writeMemoryCsvHeader("csv/exp_8_memory.csv", "numRecords,numColumns,phase");
+}
+
+void writeExp8PerfHeaders() {
+  writePerfCsvHeader("csv/exp_8_perf.csv", "numRecords,numColumns");
+}
+
 void runExp8(std::string baseDir, bool initMode, bool skipDbScan) {
   const int dbSize = 50'000'000;
   const int maxColumns = 10;
@@ -86,6 +95,9 @@ void runExp8(std::string baseDir, bool initMode, bool skipDbScan) {
   writeExp8RealDataPerColumnHeaders();
   writeExp8ScalabilityHeaders();
   writeExp8TimingComparisonHeaders();
+  // only with --memory-accounting, the hooks would skew the timings
+  if (memoryAccountingEnabled()) writeExp8MemoryHeaders();
+  if (perfCountersEnabled()) writeExp8PerfHeaders();
 
   std::vector<std::string> allColumnNames;
   for (int i = 0; i < maxColumns; ++i) {
@@ -145,12 +157,28 @@ void runExp8(std::string baseDir, bool initMode, bool skipDbScan) {
     std::map<std::string, std::vector<std::string>> columnSstFiles =
         scanSstFilesAsync(currentColumns, dbManager, params);
 
+    resetMemoryPeaks();
     std::map<std::string, BloomTree> hierarchies =
-        buildHierarchies(columnSstFiles, bloomManager, params);
+        buildHierarchies(columnSstFiles, bloomManager, params, &dbManager);
+    const std::string memoryPrefix =
+        std::to_string(params.numRecords) + "," + std::to_string(numCol);
+    if (memoryAccountingEnabled()) {
+      appendMemoryCsvRows("csv/exp_8_memory.csv", memoryPrefix + ",build",
+                          dbManager);
+      resetMemoryPeaks();
+    }
 
     // Run standard queries first
     AggregatedQueryTimings timings = runStandardQueries(
         dbManager, hierarchies, currentColumns, dbSize, 100, skipDbScan);
+    if (perfCountersEnabled()) {
+      appendPerfCsvRows("csv/exp_8_perf.csv", memoryPrefix, "multi",
+                        timings.multiPerf, timings.runs,
+                        timings.perfMultiplexed);
+      appendPerfCsvRows("csv/exp_8_perf.csv", memoryPrefix, "single",
+                        timings.singlePerf, timings.runs,
+                        timings.perfMultiplexed);
+    }
 
     // Write basic performance metrics
     std::ofstream basic_timings("csv/exp_8_basic_timings.csv", std::ios::app);
@@ -247,6 +275,12 @@ void runExp8(std::string baseDir, bool initMode, bool skipDbScan) {
     scalability_summary.close();
     timing_comparison.close();
 
+    // covers both the standard queries and the comprehensive analysis
+    if (memoryAccountingEnabled()) {
+      appendMemoryCsvRows("csv/exp_8_memory.csv", memoryPrefix + ",query",
+                          dbManager);
+    }
+
     dbManager.closeDB();
   }
 }
\ No newline at end of file
@@ -0,0 +1,281 @@
+#include <spdlog/spdlog.h>
+
+#include <atomic>
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/detached.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/thread_pool.hpp>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "algorithm.hpp"
+#include "async_query.hpp"
+#include "bloomTree.hpp"
+#include "bloom_manager.hpp"
+#include "db_manager.hpp"
+#include "exp_utils.hpp"
+#include "stopwatch.hpp"
+#include "test_params.hpp"
+
+extern void clearBloomFilterFiles(const std::string& dbDir);
+extern boost::asio::thread_pool globalThreadPool;
+
+void writeExp9ConcurrencyHeaders() {
+  writeCsvHeader("csv/exp_9_concurrency.csv",
+                 "numRecords,numClients,numQueries,wallTimeMicros,throughputQps,"
+                 "latencyAvg,latencyP50,latencyP95,latencyP99,latencyMax,"
+                 "multiLatencyP50,multiLatencyP99,singleLatencyP50,singleLatencyP99,"
+                 "poolDelayP50,poolDelayP99,poolDelayMax,"
+                 "sstReaderOpens,avgSstOpenMicros,atomicNsPerOp,"
+                 "bloomChecks,sstChecks");
+}
+
+// clients mix both paths, so counters are per query over the whole run
+void writeExp9PerfHeaders() {
+  writePerfCsvHeader("csv/exp_9_perf.csv", "numRecords,clientKind,concurrency");
+}
+
+void writeExp9AsyncHeaders() {
+  writeCsvHeader("csv/exp_9_async.csv",
+                 "numRecords,loopThreads,inFlight,numQueries,wallTimeMicros,"
+                 "throughputQps,latencyAvg,latencyP50,latencyP95,latencyP99,"
+                 "latencyMax,poolDelayP99");
+}
+
+// Keeps inFlight coroutine queries going on an io_context served by
+// loopThreads threads, until numQueries have finished. Queries alternate
+// between the multi-column and the single-hierarchy path like the thread
+// clients, but no thread waits on a future.
+static void runAsyncClients(
+    DBManager& dbManager, const std::map<std::string, BloomTree>& hierarchies,
+    const std::vector<std::string>& columns, size_t dbSize, int loopThreads,
+    size_t inFlight, size_t numQueries, double realDataPercentage) {
+  std::mt19937 generator(4321);
+  std::uniform_int_distribution<size_t> idDist(1, dbSize);
+  std::uniform_real_distribution<double> realDist(0.0, 100.0);
+  std::vector<std::vector<std::string>> queryValues(numQueries);
+  for (auto& values : queryValues) {
+    size_t id = idDist(generator);
+    std::string suffix = realDist(generator) < realDataPercentage
+                             ? "_value" + std::to_string(id)
+                             : "_wrong" + std::to_string(id);
+    for (const auto& column : columns) values.push_back(column + suffix);
+  }
+
+  std::vector<long long> latencies(numQueries);
+  std::atomic<size_t> nextQuery{0};
+  boost::asio::io_context loop;
+
+  auto client = [&]() -> boost::asio::awaitable<void> {
+    std::vector<BloomTree> trees;
+    for (const auto& column : columns) trees.push_back(hierarchies.at(column));
+    for (size_t q = nextQuery++; q < numQueries; q = nextQuery++) {
+      StopWatch sw;
+      sw.start();
+      if (q % 2 == 0) {
+        co_await multiColumnQueryHierarchicalAsync(trees, queryValues[q], "",
+                                                   "", dbManager);
+      } else {
+        co_await findUsingSingleHierarchyAsync(dbManager, trees.front(),
+                                               columns, queryValues[q]);
+      }
+      sw.stop();
+      latencies[q] = sw.elapsedMicros();
+    }
+  };
+
+  resetPerfCounters();
+  PoolDelayProbe probe;
+  StopWatch wall;
+  wall.start();
+  for (size_t i = 0; i < inFlight; ++i) {
+    boost::asio::co_spawn(loop, client(), boost::asio::detached);
+  }
+  std::vector<std::thread> loopRunners;
+  for (int t = 0; t < loopThreads; ++t) {
+    loopRunners.emplace_back([&loop]() { loop.run(); });
+  }
+  for (auto& t : loopRunners) t.join();
+  wall.stop();
+  probe.stop();
+
+  LatencyPercentiles total = calculateLatencyPercentiles(latencies);
+  LatencyPercentiles poolDelay = probe.poolDelayMicros();
+  long long wallMicros = wall.elapsedMicros();
+  double throughput = wallMicros > 0 ? numQueries * 1e6 / wallMicros : 0.0;
+
+  spdlog::info(
+      "Exp9: {} coroutines on {} loop threads, {} queries in {} µs: {:.1f} q/s, "
+      "p50 {} µs, p99 {} µs",
+      inFlight, loopThreads, numQueries, wallMicros, throughput, total.p50,
+      total.p99);
+
+  std::ofstream out("csv/exp_9_async.csv", std::ios::app);
+  if (out) {
+    out << dbSize << "," << loopThreads << "," << inFlight << "," << numQueries
+        << "," << wallMicros << "," << throughput << "," << total.average << ","
+        << total.p50 << "," << total.p95 << "," << total.p99 << ","
+        << total.max << "," << poolDelay.p99 << "\n";
+  }
+  if (perfCountersEnabled()) {
+    appendPerfCsvRows("csv/exp_9_perf.csv",
+                      std::to_string(dbSize) + ",async," +
+                          std::to_string(inFlight),
+                      "mixed", perfCountersByPhase(), numQueries,
+                      perfCountersMultiplexed());
+  }
+}
+
+// Runs queriesPerClient queries from each of numClients threads at once.
+// Clients alternate between the multi-column and the single-hierarchy path;
+// realDataPercentage of the queries ask for values that exist.
+static void runConcurrentClients(
+    DBManager& dbManager, const std::map<std::string, BloomTree>& hierarchies,
+    const std::vector<std::string>& columns, size_t dbSize, int numClients,
+    int queriesPerClient, double realDataPercentage) {
+  std::vector<std::vector<long long>> multiLatencies(numClients);
+  std::vector<std::vector<long long>> singleLatencies(numClients);
+
+  uint64_t opensBefore = sstReaderOpens().value();
+  uint64_t openMicrosBefore = sstReaderOpenMicros().value();
+  // the clients run concurrently, so the run's checks are read off the
+  // monotonic totals
+  size_t bloomChecksBefore = gBloomCheckCount.load();
+  size_t sstChecksBefore = gSSTCheckCount.load();
+  resetPerfCounters();
+
+  PoolDelayProbe probe;
+  StopWatch wall;
+  wall.start();
+
+  std::vector<std::thread> clients;
+  clients.reserve(numClients);
+  for (int client = 0; client < numClients; ++client) {
+    clients.emplace_back([&, client]() {
+      // tree copies share nodes; each client only needs its own vector
+      std::vector<BloomTree> trees;
+      for (const auto& column : columns) trees.push_back(hierarchies.at(column));
+      BloomTree& primary = trees.front();
+
+      std::mt19937 generator(1234 + client);
+      std::uniform_int_distribution<size_t> idDist(1, dbSize);
+      std::uniform_real_distribution<double> realDist(0.0, 100.0);
+
+      for (int q = 0; q < queriesPerClient; ++q) {
+        size_t id = idDist(generator);
+        std::string suffix = realDist(generator) < realDataPercentage
+                                 ? "_value" + std::to_string(id)
+                                 : "_wrong" + std::to_string(id);
+        std::vector<std::string> values;
+        for (const auto& column : columns) values.push_back(column + suffix);
+
+        StopWatch sw;
+        sw.start();
+        if (q % 2 == 0) {
+          multiColumnQueryHierarchical(trees, values, "", "", dbManager);
+          sw.stop();
+          multiLatencies[client].push_back(sw.elapsedMicros());
+        } else {
+          dbManager.findUsingSingleHierarchy(primary, columns, values);
+          sw.stop();
+          singleLatencies[client].push_back(sw.elapsedMicros());
+        }
+      }
+    });
+  }
+  for (auto& t : clients) t.join();
+
+  wall.stop();
+  probe.stop();
+
+  std::vector<long long> all, multi, single;
+  for (int client = 0; client < numClients; ++client) {
+    multi.insert(multi.end(), multiLatencies[client].begin(), multiLatencies[client].end());
+    single.insert(single.end(), singleLatencies[client].begin(), singleLatencies[client].end());
+  }
+  all.insert(all.end(), multi.begin(), multi.end());
+  all.insert(all.end(), single.begin(), single.end());
+
+  LatencyPercentiles total = calculateLatencyPercentiles(all);
+  LatencyPercentiles multiStats = calculateLatencyPercentiles(multi);
+  LatencyPercentiles singleStats = calculateLatencyPercentiles(single);
+  LatencyPercentiles poolDelay = probe.poolDelayMicros();
+
+  long long wallMicros = wall.elapsedMicros();
+  double throughput = wallMicros > 0 ? all.size() * 1e6 / wallMicros : 0.0;
+  uint64_t opens = sstReaderOpens().value() - opensBefore;
+  double avgOpenMicros =
+      opens > 0 ? static_cast<double>(sstReaderOpenMicros().value() - openMicrosBefore) / opens
+                : 0.0;
+
+  spdlog::info(
+      "Exp9: {} clients, {} queries in {} µs: {:.1f} q/s, p50 {} µs, p99 {} µs, "
+      "pool delay p99 {} µs, {} SST opens",
+      numClients, all.size(), wallMicros, throughput, total.p50, total.p99,
+      poolDelay.p99, opens);
+
+  std::ofstream out("csv/exp_9_concurrency.csv", std::ios::app);
+  if (out) {
+    out << dbSize << "," << numClients << "," << all.size() << "," << wallMicros << ","
+        << throughput << "," << total.average << "," << total.p50 << "," << total.p95 << ","
+        << total.p99 << "," << total.max << "," << multiStats.p50 << "," << multiStats.p99 << ","
+        << singleStats.p50 << "," << singleStats.p99 << "," << poolDelay.p50 << ","
+        << poolDelay.p99 << "," << poolDelay.max << "," << opens << "," << avgOpenMicros << ","
+        << probe.atomicNanosPerOp() << "," << gBloomCheckCount.load() - bloomChecksBefore << ","
+        << gSSTCheckCount.load() - sstChecksBefore << "\n";
+  }
+  if (perfCountersEnabled()) {
+    appendPerfCsvRows("csv/exp_9_perf.csv",
+                      std::to_string(dbSize) + ",threads," +
+                          std::to_string(numClients),
+                      "mixed", perfCountersByPhase(), all.size(),
+                      perfCountersMultiplexed());
+  }
+}
+
+void runExp9(const std::string& dbPath, size_t dbSize, bool skipDbScan,
+             bool asyncClients) {
+  const std::vector<std::string> columns = {"phone", "mail", "address"};
+  const std::vector<int> clientCounts = {1, 8, 32, 64};
+  const int queriesPerClient = 20;
+  const double realDataPercentage = 50.0;
+
+  writeExp9ConcurrencyHeaders();
+  if (asyncClients) writeExp9AsyncHeaders();
+  if (perfCountersEnabled()) writeExp9PerfHeaders();
+
+  DBManager dbManager;
+  BloomManager bloomManager;
+
+  TestParams params = {dbPath, static_cast<int>(dbSize), 3, 1, 100000, 4000000, 3};
+  spdlog::info("Exp9: Concurrent clients on database '{}'", params.dbName);
+
+  clearBloomFilterFiles(params.dbName);
+  dbManager.openDB(params.dbName);
+
+  std::map<std::string, std::vector<std::string>> columnSstFiles =
+      scanSstFilesAsync(columns, dbManager, params);
+  std::map<std::string, BloomTree> hierarchies =
+      buildHierarchies(columnSstFiles, bloomManager, params, &dbManager);
+
+  for (int numClients : clientCounts) {
+    runConcurrentClients(dbManager, hierarchies, columns, dbSize, numClients,
+                         queriesPerClient, realDataPercentage);
+  }
+
+  if (asyncClients) {
+    const int loopThreads = 2;
+    const std::vector<size_t> inFlightCounts = {64, 512, 4096};
+    for (size_t inFlight : inFlightCounts) {
+      runAsyncClients(dbManager, hierarchies, columns, dbSize, loopThreads,
+                      inFlight, inFlight * 4, realDataPercentage);
+    }
+  }
+
+  dbManager.closeDB();
+}
@@ -5,6 +5,7 @@
 #include <boost/asio/post.hpp>
 #include <boost/asio/thread_pool.hpp>
 #include <chrono>
+#include <algorithm>
 #include <cmath>
 #include <fstream>
 #include <random>
@@ -15,12 +16,12 @@
 #include "bloomTree.hpp"
 #include "bloom_manager.hpp"
 #include "db_manager.hpp"
+#include "memory_accounting.hpp"
+#include "metrics.hpp"
+#include "query_log.hpp"
 #include "stopwatch.hpp"
 
 extern boost::asio::thread_pool globalThreadPool;
-extern std::atomic<size_t> gBloomCheckCount;
-extern std::atomic<size_t> gLeafBloomCheckCount;
-extern std::atomic<size_t> gSSTCheckCount;
 
 std::map<std::string, std::vector<std::string>> scanSstFilesAsync(
     const std::vector<std::string>& columns, DBManager& dbManager,
@@ -51,12 +52,24 @@ std::map<std::string, std::vector<std::string>> scanSstFilesAsync(
 
 std::map<std::string, BloomTree> buildHierarchies(
     const std::map<std::string, std::vector<std::string>>& columnSstFiles,
-    BloomManager& bloomManager, const TestParams& params) {
+    BloomManager& bloomManager, const TestParams& params,
+    const DBManager* dbManager) {
   std::map<std::string, BloomTree> hierarchies;
   for (const auto& [column, sstFiles] : columnSstFiles) {
+    bool ngram = std::find(params.ngramColumns.begin(),
+                           params.ngramColumns.end(),
+                           column) != params.ngramColumns.end();
     BloomTree hierarchy = bloomManager.createPartitionedHierarchy(
         sstFiles, params.itemsPerPartition, params.bloomSize,
-        params.numHashFunctions, params.bloomTreeRatio);
+        params.numHashFunctions, params.bloomTreeRatio,
+        ngram ? TextFilterMode::NGram : TextFilterMode::None,
+        params.ngramSize, params.sketchWidth, params.sketchDepth,
+        params.foldTargetFpr, params.filterKind);
+    if (params.probeMode != ProbeMode::EarlyExit) {
+      hierarchy.setProbeMode(params.probeMode);
+    }
+    if (dbManager) hierarchy.dictionary = dbManager->columnDictionary(column);
+    exportHierarchyMetrics(column, hierarchy);
     spdlog::info("Hierarchy built for column: {}", column);
     hierarchies.try_emplace(column, std::move(hierarchy));
   }
@@ -154,6 +167,16 @@ CountStatistics calculateCountStatistics(const std::vector<T>& values) {
   return stats;
 }
 
+static void addPerfCountsSince(const PhasePerfCounts& before,
+                               PhasePerfCounts& sum) {
+  PhasePerfCounts now = perfCountersByPhase();
+  for (size_t phase = 0; phase < kPerfPhases; ++phase) {
+    for (size_t event = 0; event < kPerfEvents; ++event) {
+      sum[phase][event] += now[phase][event] - before[phase][event];
+    }
+  }
+}
+
 AggregatedQueryTimings runStandardQueries(
     DBManager& dbManager, const std::map<std::string, BloomTree>& hierarchies,
     const std::vector<std::string>& columns, size_t dbSize, int numRuns,
@@ -224,6 +247,7 @@ AggregatedQueryTimings runStandardQueries(
   std::mt19937 generator(rd());
   std::uniform_int_distribution<size_t> distribution(1, dbSize);
 
+  resetPerfCounters();
   StopWatch stopwatch;
   std::vector<std::string> currentExpectedValues;
   long long globalScanTime = 0;
@@ -242,6 +266,8 @@ AggregatedQueryTimings runStandardQueries(
       currentExpectedValues.push_back(column + currentExpectedValueSuffix);
     }
 
+    captureQuery(columns, currentExpectedValues);
+
     // --- Global Scan Query ---
     if (!skipDbScan && i == 0) {
       stopwatch.start();
@@ -255,36 +281,38 @@ AggregatedQueryTimings runStandardQueries(
     globalScanTimes.push_back(globalScanTime);
 
     // --- Hierarchical Multi-Column Query ---
-    gBloomCheckCount = 0;
-    gLeafBloomCheckCount = 0;
-    gSSTCheckCount = 0;
+    QueryCounters multiCounters;
+    QueryCounterScope multiCountScope(multiCounters);
+    PhasePerfCounts perfBefore = perfCountersByPhase();
     stopwatch.start();
     [[maybe_unused]] std::vector<std::string> hierarchicalMatches =
         multiColumnQueryHierarchical(queryTrees, currentExpectedValues, "", "",
                                      dbManager);
     stopwatch.stop();
     hierarchicalMultiTimes.push_back(stopwatch.elapsedMicros());
-    multiCol_bloomChecks_vec.push_back(gBloomCheckCount.load());
-    multiCol_leafBloomChecks_vec.push_back(gLeafBloomCheckCount.load());
-    multiCol_sstChecks_vec.push_back(gSSTCheckCount.load());
-    multiCol_nonLeafBloomChecks_vec.push_back(gBloomCheckCount.load() - gLeafBloomCheckCount.load());
+    multiCol_bloomChecks_vec.push_back(multiCounters.bloomChecks.load());
+    multiCol_leafBloomChecks_vec.push_back(multiCounters.leafBloomChecks.load());
+    multiCol_sstChecks_vec.push_back(multiCounters.sstChecks.load());
+    multiCol_nonLeafBloomChecks_vec.push_back(multiCounters.bloomChecks.load() - multiCounters.leafBloomChecks.load());
+    addPerfCountsSince(perfBefore, aggregated_timings.multiPerf);
 
     // --- Hierarchical Single Column Query ---
     // Ensure queryTrees[0] is valid before dereferencing. Already checked by
     // queryTrees.empty()
-    gBloomCheckCount = 0;
-    gLeafBloomCheckCount = 0;
-    gSSTCheckCount = 0;
+    QueryCounters singleCounters;
+    QueryCounterScope singleCountScope(singleCounters);
+    perfBefore = perfCountersByPhase();
     stopwatch.start();
     [[maybe_unused]] std::vector<std::string> singlehierarchyMatches =
         dbManager.findUsingSingleHierarchy(queryTrees[0], columns,
                                            currentExpectedValues);
     stopwatch.stop();
     hierarchicalSingleTimes.push_back(stopwatch.elapsedMicros());
-    singleCol_bloomChecks_vec.push_back(gBloomCheckCount.load());
-    singleCol_leafBloomChecks_vec.push_back(gLeafBloomCheckCount.load());
-    singleCol_sstChecks_vec.push_back(gSSTCheckCount.load());
-    singleCol_nonLeafBloomChecks_vec.push_back(gBloomCheckCount.load() - gLeafBloomCheckCount.load());
+    singleCol_bloomChecks_vec.push_back(singleCounters.bloomChecks.load());
+    singleCol_leafBloomChecks_vec.push_back(singleCounters.leafBloomChecks.load());
+    singleCol_sstChecks_vec.push_back(singleCounters.sstChecks.load());
+    singleCol_nonLeafBloomChecks_vec.push_back(singleCounters.bloomChecks.load() - singleCounters.leafBloomChecks.load());
+    addPerfCountsSince(perfBefore, aggregated_timings.singlePerf);
 
     std::this_thread::sleep_for(std::chrono::milliseconds(100));
   }
@@ -317,6 +345,8 @@ AggregatedQueryTimings runStandardQueries(
 
   // Store number of columns for reference
   aggregated_timings.numColumns = columns.size();
+  aggregated_timings.runs = numRuns;
+  aggregated_timings.perfMultiplexed = perfCountersMultiplexed();
 
   // Calculate per-column statistics (divide by column count)
   double numCols = static_cast<double>(columns.size());
@@ -409,9 +439,12 @@ AggregatedQueryTimings runStandardQueriesWithTarget(
     return aggregated_timings;
   }
 
+  resetPerfCounters();
   StopWatch stopwatch;
   long long globalScanTime = 0;
   for (int i = 0; i < numRuns; ++i) {
+    captureQuery(columns, currentExpectedValues);
+
     // --- Global Scan Query ---
     if (!skipDbScan && i == 0) {
       stopwatch.start();
@@ -425,36 +458,38 @@ AggregatedQueryTimings runStandardQueriesWithTarget(
     globalScanTimes.push_back(globalScanTime);
 
     // --- Hierarchical Multi-Column Query ---
-    gBloomCheckCount = 0;
-    gLeafBloomCheckCount = 0;
-    gSSTCheckCount = 0;
+    QueryCounters multiCounters;
+    QueryCounterScope multiCountScope(multiCounters);
+    PhasePerfCounts perfBefore = perfCountersByPhase();
     stopwatch.start();
     [[maybe_unused]] std::vector<std::string> hierarchicalMatches =
         multiColumnQueryHierarchical(queryTrees, currentExpectedValues, "", "",
                                      dbManager);
     stopwatch.stop();
     hierarchicalMultiTimes.push_back(stopwatch.elapsedMicros());
-    multiCol_bloomChecks_vec.push_back(gBloomCheckCount.load());
-    multiCol_leafBloomChecks_vec.push_back(gLeafBloomCheckCount.load());
-    multiCol_sstChecks_vec.push_back(gSSTCheckCount.load());
-    multiCol_nonLeafBloomChecks_vec.push_back(gBloomCheckCount.load() - gLeafBloomCheckCount.load());
+    multiCol_bloomChecks_vec.push_back(multiCounters.bloomChecks.load());
+    multiCol_leafBloomChecks_vec.push_back(multiCounters.leafBloomChecks.load());
+    multiCol_sstChecks_vec.push_back(multiCounters.sstChecks.load());
+    multiCol_nonLeafBloomChecks_vec.push_back(multiCounters.bloomChecks.load() - multiCounters.leafBloomChecks.load());
+    addPerfCountsSince(perfBefore, aggregated_timings.multiPerf);
 
     // --- Hierarchical Single Column Query ---
     // Ensure queryTrees[0] is valid before dereferencing. Already checked by
     // queryTrees.empty()
-    gBloomCheckCount = 0;
-    gLeafBloomCheckCount = 0;
-    gSSTCheckCount = 0;
+    QueryCounters singleCounters;
+    QueryCounterScope singleCountScope(singleCounters);
+    perfBefore = perfCountersByPhase();
     stopwatch.start();
     [[maybe_unused]] std::vector<std::string> singlehierarchyMatches =
         dbManager.findUsingSingleHierarchy(queryTrees[0], columns,
                                            currentExpectedValues);
     stopwatch.stop();
     hierarchicalSingleTimes.push_back(stopwatch.elapsedMicros());
-    singleCol_bloomChecks_vec.push_back(gBloomCheckCount.load());
-    singleCol_leafBloomChecks_vec.push_back(gLeafBloomCheckCount.load());
-    singleCol_sstChecks_vec.push_back(gSSTCheckCount.load());
-    singleCol_nonLeafBloomChecks_vec.push_back(gBloomCheckCount.load() - gLeafBloomCheckCount.load());
+    singleCol_bloomChecks_vec.push_back(singleCounters.bloomChecks.load());
+    singleCol_leafBloomChecks_vec.push_back(singleCounters.leafBloomChecks.load());
+    singleCol_sstChecks_vec.push_back(singleCounters.sstChecks.load());
+    singleCol_nonLeafBloomChecks_vec.push_back(singleCounters.bloomChecks.load() - singleCounters.leafBloomChecks.load());
+    addPerfCountsSince(perfBefore, aggregated_timings.singlePerf);
 
     std::this_thread::sleep_for(std::chrono::milliseconds(100));
   }
@@ -487,6 +522,8 @@ AggregatedQueryTimings runStandardQueriesWithTarget(
 
   // Store number of columns for reference
   aggregated_timings.numColumns = columns.size();
+  aggregated_timings.runs = numRuns;
+  aggregated_timings.perfMultiplexed = perfCountersMultiplexed();
 
   // Calculate per-column statistics (divide by column count)
   double numCols = static_cast<double>(columns.size());
@@ -678,19 +715,20 @@ std::vector<PatternQueryResult> runPatternQueriesWithCsvData(
     PatternQueryResult result;
     result.percent = percentageExisting;
 
+    captureQuery(columns, currentExpectedValues);
+
     // --- Hierarchical Multi-Column Query ---
-    gBloomCheckCount = 0;
-    gLeafBloomCheckCount = 0;
-    gSSTCheckCount = 0;
+    QueryCounters multiCounters;
+    QueryCounterScope multiCountScope(multiCounters);
     stopwatch.start();
     [[maybe_unused]] std::vector<std::string> hierarchicalMatches =
         multiColumnQueryHierarchical(queryTrees, currentExpectedValues, "", "",
                                      dbManager);
     stopwatch.stop();
     result.hierarchicalMultiTime = stopwatch.elapsedMicros();
-    result.multiCol_bloomChecks = gBloomCheckCount.load();
-    result.multiCol_leafBloomChecks = gLeafBloomCheckCount.load();
-    result.multiCol_sstChecks = gSSTCheckCount.load();
+    result.multiCol_bloomChecks = multiCounters.bloomChecks.load();
+    result.multiCol_leafBloomChecks = multiCounters.leafBloomChecks.load();
+    result.multiCol_sstChecks = multiCounters.sstChecks.load();
 
     // Calculate derived metrics
     result.multiCol_nonLeafBloomChecks = result.multiCol_bloomChecks - result.multiCol_leafBloomChecks;
@@ -703,18 +741,17 @@ std::vector<PatternQueryResult> runPatternQueriesWithCsvData(
     result.multiCol_nonLeafBloomChecksPerColumn = static_cast<double>(result.multiCol_nonLeafBloomChecks) / numCols;
 
     // --- Hierarchical Single Column Query ---
-    gBloomCheckCount = 0;
-    gLeafBloomCheckCount = 0;
-    gSSTCheckCount = 0;
+    QueryCounters singleCounters;
+    QueryCounterScope singleCountScope(singleCounters);
     stopwatch.start();
     [[maybe_unused]] std::vector<std::string> singlehierarchyMatches =
         dbManager.findUsingSingleHierarchy(queryTrees[0], columns,
                                            currentExpectedValues);
     stopwatch.stop();
     result.hierarchicalSingleTime = stopwatch.elapsedMicros();
-    result.singleCol_bloomChecks = gBloomCheckCount.load();
-    result.singleCol_leafBloomChecks = gLeafBloomCheckCount.load();
-    result.singleCol_sstChecks = gSSTCheckCount.load();
+    result.singleCol_bloomChecks = singleCounters.bloomChecks.load();
+    result.singleCol_leafBloomChecks = singleCounters.leafBloomChecks.load();
+    result.singleCol_sstChecks = singleCounters.sstChecks.load();
 
     // Calculate derived metrics
     result.singleCol_nonLeafBloomChecks = result.singleCol_bloomChecks - result.singleCol_leafBloomChecks;
@@ -848,19 +885,20 @@ std::vector<MixedQueryResult> runMixedQueriesWithCsvData(
     result.queryIndex = queryIdx;
     result.isRealData = useRealData;
 
+    captureQuery(columns, currentExpectedValues);
+
     // --- Hierarchical Multi-Column Query ---
-    gBloomCheckCount = 0;
-    gLeafBloomCheckCount = 0;
-    gSSTCheckCount = 0;
+    QueryCounters multiCounters;
+    QueryCounterScope multiCountScope(multiCounters);
     stopwatch.start();
     [[maybe_unused]] std::vector<std::string> hierarchicalMatches =
         multiColumnQueryHierarchical(queryTrees, currentExpectedValues, "", "",
                                      dbManager);
     stopwatch.stop();
     result.hierarchicalMultiTime = stopwatch.elapsedMicros();
-    result.multiCol_bloomChecks = gBloomCheckCount.load();
-    result.multiCol_leafBloomChecks = gLeafBloomCheckCount.load();
-    result.multiCol_sstChecks = gSSTCheckCount.load();
+    result.multiCol_bloomChecks = multiCounters.bloomChecks.load();
+    result.multiCol_leafBloomChecks = multiCounters.leafBloomChecks.load();
+    result.multiCol_sstChecks = multiCounters.sstChecks.load();
 
     // Calculate derived metrics
     result.multiCol_nonLeafBloomChecks = result.multiCol_bloomChecks - result.multiCol_leafBloomChecks;
@@ -873,18 +911,17 @@ std::vector<MixedQueryResult> runMixedQueriesWithCsvData(
     result.multiCol_nonLeafBloomChecksPerColumn = static_cast<double>(result.multiCol_nonLeafBloomChecks) / numCols;
 
     // --- Hierarchical Single Column Query ---
-    gBloomCheckCount = 0;
-    gLeafBloomCheckCount = 0;
-    gSSTCheckCount = 0;
+    QueryCounters singleCounters;
+    QueryCounterScope singleCountScope(singleCounters);
     stopwatch.start();
     [[maybe_unused]] std::vector<std::string> singlehierarchyMatches =
         dbManager.findUsingSingleHierarchy(queryTrees[0], columns,
                                            currentExpectedValues);
     stopwatch.stop();
     result.hierarchicalSingleTime = stopwatch.elapsedMicros();
-    result.singleCol_bloomChecks = gBloomCheckCount.load();
-    result.singleCol_leafBloomChecks = gLeafBloomCheckCount.load();
-    result.singleCol_sstChecks = gSSTCheckCount.load();
+    result.singleCol_bloomChecks = singleCounters.bloomChecks.load();
+    result.singleCol_leafBloomChecks = singleCounters.leafBloomChecks.load();
+    result.singleCol_sstChecks = singleCounters.sstChecks.load();
 
     // Calculate derived metrics
     result.singleCol_nonLeafBloomChecks = result.singleCol_bloomChecks - result.singleCol_leafBloomChecks;
@@ -1041,4 +1078,133 @@ std::vector<AccumulatedQueryMetrics> runComprehensiveQueryAnalysis(
   
   spdlog::info("Comprehensive analysis completed with {} scenarios", accumulatedResults.size());
   return accumulatedResults;
-}
\ No newline at end of file
+}
+
+LatencyPercentiles calculateLatencyPercentiles(std::vector<long long> values) {
+  LatencyPercentiles result;
+  if (values.empty()) return result;
+  std::sort(values.begin(), values.end());
+  auto at = [&](double q) {
+    size_t idx = static_cast<size_t>(std::ceil(q * values.size()));
+    return values[std::min(values.size() - 1, idx == 0 ? 0 : idx - 1)];
+  };
+  result.p50 = at(0.50);
+  result.p95 = at(0.95);
+  result.p99 = at(0.99);
+  result.max = values.back();
+  long double sum = 0;
+  for (long long v : values) sum += v;
+  result.average = static_cast<double>(sum / values.size());
+  return result;
+}
+
+PoolDelayProbe::PoolDelayProbe(std::chrono::milliseconds interval)
+    : interval(interval) {
+  sampler = std::thread([this]() {
+    while (running.load()) {
+      auto posted = std::chrono::steady_clock::now();
+      auto started = std::make_shared<std::promise<std::chrono::steady_clock::time_point>>();
+      auto startedFuture = started->get_future();
+      boost::asio::post(globalThreadPool, [started]() {
+        started->set_value(std::chrono::steady_clock::now());
+      });
+      long long delay = std::chrono::duration_cast<std::chrono::microseconds>(
+                            startedFuture.get() - posted)
+                            .count();
+
+      constexpr int kOps = 256;
+      auto begin = std::chrono::steady_clock::now();
+      for (int i = 0; i < kOps; ++i) {
+        gBloomCheckCount.fetch_add(0, std::memory_order_relaxed);
+      }
+      double nsPerOp = std::chrono::duration<double, std::nano>(
+                           std::chrono::steady_clock::now() - begin)
+                           .count() /
+                       kOps;
+      {
+        std::lock_guard<std::mutex> lock(mtx);
+        delays.push_back(delay);
+        atomicSamples.push_back(nsPerOp);
+      }
+      std::this_thread::sleep_for(this->interval);
+    }
+  });
+}
+
+PoolDelayProbe::~PoolDelayProbe() { stop(); }
+
+void PoolDelayProbe::stop() {
+  running = false;
+  if (sampler.joinable()) sampler.join();
+}
+
+LatencyPercentiles PoolDelayProbe::poolDelayMicros() const {
+  std::lock_guard<std::mutex> lock(mtx);
+  return calculateLatencyPercentiles(delays);
+}
+
+double PoolDelayProbe::atomicNanosPerOp() const {
+  std::lock_guard<std::mutex> lock(mtx);
+  if (atomicSamples.empty()) return 0.0;
+  double sum = 0.0;
+  for (double v : atomicSamples) sum += v;
+  return sum / atomicSamples.size();
+}
+
+void writeMemoryCsvHeader(const std::string& filename,
+                          const std::string& prefixColumns) {
+  writeCsvHeader(filename, prefixColumns +
+                               ",tag,liveBytes,peakBytes,allocations,"
+                               "allocatedBytes,allocatedBytesPerSec");
+}
+
+void writePerfCsvHeader(const std::string& filename,
+                        const std::string& prefixColumns) {
+  writeCsvHeader(filename, prefixColumns + ",path,phase," + perfCsvHeader("") +
+                               ",multiplexed");
+}
+
+void appendPerfCsvRows(const std::string& filename,
+                       const std::string& prefixValues, const std::string& path,
+                       const PhasePerfCounts& counts, size_t queries,
+                       bool multiplexed) {
+  std::ofstream out(filename, std::ios::app);
+  if (!out) {
+    spdlog::error("Utils: Nie udało się otworzyć pliku '{}' do dopisywania!",
+                  filename);
+    return;
+  }
+  for (size_t phase = 0; phase < kPerfPhases; ++phase) {
+    PerfCounts perQuery = counts[phase];
+    for (auto& count : perQuery) count /= std::max<size_t>(queries, 1);
+    out << prefixValues << "," << path << ","
+        << perfPhaseName(static_cast<PerfPhase>(phase)) << ","
+        << perfCsvValues(perQuery) << "," << multiplexed << "\n";
+  }
+}
+
+void appendMemoryCsvRows(const std::string& filename,
+                         const std::string& prefixValues, DBManager& dbManager) {
+  std::ofstream out(filename, std::ios::app);
+  if (!out) {
+    spdlog::error("Utils: Nie udało się otworzyć pliku '{}' do dopisywania!",
+                  filename);
+    return;
+  }
+  for (size_t i = 0; i < kMemoryTags; ++i) {
+    MemoryTag tag = static_cast<MemoryTag>(i);
+    MemoryTagStats stats = memoryStats(tag);
+    out << prefixValues << "," << memoryTagName(tag) << "," << stats.liveBytes
+        << "," << stats.peakBytes << "," << stats.allocations << ","
+        << stats.allocatedBytes << "," << stats.allocatedBytesPerSec << "\n";
+    spdlog::info("Memory [{}]: live {} B, peak {} B, {} allocations", memoryTagName(tag),
+                 stats.liveBytes, stats.peakBytes, stats.allocations);
+  }
+  RocksDBMemoryStats rocks = dbManager.getRocksDBMemoryStats();
+  out << prefixValues << ",rocksdb_block_cache," << rocks.blockCacheBytes
+      << ",0,0,0,0\n";
+  out << prefixValues << ",rocksdb_table_readers," << rocks.tableReaderBytes
+      << ",0,0,0,0\n";
+  out << prefixValues << ",rocksdb_memtables," << rocks.memtableBytes
+      << ",0,0,0,0\n";
+}
@@ -0,0 +1,233 @@
+#include "filter_monitor.hpp"
+
+#include <rocksdb/sst_file_reader.h>
+#include <spdlog/spdlog.h>
+
+#include <boost/asio/post.hpp>
+#include <boost/asio/thread_pool.hpp>
+#include <chrono>
+#include <fstream>
+#include <memory>
+
+#include "exp_utils.hpp"
+
+extern boost::asio::thread_pool globalThreadPool;
+
+static void collectLeaves(const Node* node, std::vector<const Node*>& out) {
+  if (!node) return;
+  if (node->children.empty()) {
+    out.push_back(node);
+    return;
+  }
+  for (const Node* child : node->children) collectLeaves(child, out);
+}
+
+std::vector<LeafFilterStats> FilterMonitor::leafStats(
+    const BloomTree& tree) const {
+  std::vector<const Node*> leaves;
+  collectLeaves(tree.root, leaves);
+
+  std::vector<LeafFilterStats> stats;
+  stats.reserve(leaves.size());
+  for (const Node* leaf : leaves) {
+    LeafFilterStats s;
+    s.leaf = leaf;
+    s.probes = leaf->probeCount.load(std::memory_order_relaxed);
+    s.passes = std::min(leaf->passCount.load(std::memory_order_relaxed), s.probes);
+    s.scans = std::min(leaf->scanCount.load(std::memory_order_relaxed), s.passes);
+    s.hits = std::min(leaf->hitCount.load(std::memory_order_relaxed), s.scans);
+    uint64_t falsePositives = s.scans - s.hits;
+    uint64_t negatives = s.probes - s.passes + falsePositives;
+    s.observedFpr =
+        negatives > 0 ? static_cast<double>(falsePositives) / negatives : 0.0;
+    s.predictedFpr = leaf->qfilter
+                         ? leaf->qfilter->estimatedFpr()
+                         : getProbabilityOfFalsePositive(
+                               leaf->bloom.bitArraySize,
+                               leaf->bloom.numHashFunctions, leaf->itemCount);
+    s.overBudget = negatives >= minNegativeProbes &&
+                   s.observedFpr > tolerance * s.predictedFpr;
+    stats.push_back(s);
+  }
+  return stats;
+}
+
+std::vector<LevelFilterStats> FilterMonitor::levelStats(
+    const BloomTree& tree) const {
+  std::vector<LevelFilterStats> levels;
+  std::vector<const Node*> current;
+  if (tree.root) current.push_back(tree.root);
+
+  for (size_t depth = 0; !current.empty(); ++depth) {
+    LevelFilterStats level{depth, current.size(), 0, 0, 0, 0.0, -1.0, 0.0};
+    uint64_t leafNegatives = 0, leafFalsePositives = 0;
+    std::vector<const Node*> next;
+    for (const Node* node : current) {
+      uint64_t probes = node->probeCount.load(std::memory_order_relaxed);
+      uint64_t passes = node->passCount.load(std::memory_order_relaxed);
+      level.probes += probes;
+      level.passes += passes;
+      level.avgPredictedFpr += node->qfilter ? node->qfilter->estimatedFpr()
+                                             : node->bloom.estimatedFpr();
+      if (node->children.empty()) {
+        uint64_t scans =
+            std::min(node->scanCount.load(std::memory_order_relaxed), passes);
+        uint64_t hits =
+            std::min(node->hitCount.load(std::memory_order_relaxed), scans);
+        level.hits += hits;
+        leafFalsePositives += scans - hits;
+        leafNegatives += (probes - std::min(passes, probes)) + scans - hits;
+      }
+      next.insert(next.end(), node->children.begin(), node->children.end());
+    }
+    level.avgPredictedFpr /= current.size();
+    level.passRate = level.probes > 0
+                         ? static_cast<double>(level.passes) / level.probes
+                         : 0.0;
+    if (leafNegatives > 0) {
+      level.observedFpr =
+          static_cast<double>(leafFalsePositives) / leafNegatives;
+    }
+    levels.push_back(level);
+    current = std::move(next);
+  }
+  return levels;
+}
+
+std::vector<Node*> FilterMonitor::evaluate(const BloomTree& tree) {
+  std::vector<Node*> due;
+  for (const auto& s : leafStats(tree)) {
+    // quotient filters are exact up to fingerprint collisions, no rebuild
+    if (!s.overBudget || s.leaf->qfilter) {
+      strikes.erase(s.leaf);
+      continue;
+    }
+    int& count = strikes[s.leaf];
+    if (++count >= strikesToRebuild) {
+      spdlog::warn(
+          "Leaf {} [{}, {}] over FPR budget: observed {:.5f}, predicted "
+          "{:.5f}, scheduling rebuild.",
+          s.leaf->filename, s.leaf->startKey, s.leaf->endKey, s.observedFpr,
+          s.predictedFpr);
+      due.push_back(const_cast<Node*>(s.leaf));
+      strikes.erase(s.leaf);
+    }
+  }
+  return due;
+}
+
+std::future<std::vector<LeafRebuild>> FilterMonitor::scheduleRebuild(
+    std::vector<Node*> leaves, size_t growthFactor) {
+  auto promise = std::make_shared<std::promise<std::vector<LeafRebuild>>>();
+  auto future = promise->get_future();
+
+  boost::asio::post(globalThreadPool, [leaves = std::move(leaves),
+                                       growthFactor, promise]() {
+    std::vector<LeafRebuild> rebuilt;
+    for (Node* leaf : leaves) {
+      rocksdb::Options options;
+      rocksdb::SstFileReader reader(options);
+      if (!reader.Open(leaf->filename).ok()) {
+        spdlog::error("Rebuild: cannot open SST file: {}", leaf->filename);
+        continue;
+      }
+      rocksdb::ReadOptions readOptions;
+      readOptions.fill_cache = false;
+      std::unique_ptr<rocksdb::Iterator> iter(reader.NewIterator(readOptions));
+
+      // multiple of the old size, so parents can still fold it in on merge
+      BloomFilter bloom(leaf->bloom.bitArraySize * growthFactor,
+                        leaf->bloom.numHashFunctions);
+      for (iter->Seek(leaf->startKey); iter->Valid(); iter->Next()) {
+        if (iter->key().ToString() > leaf->endKey) break;
+        bloom.insert(iter->value().ToString());
+      }
+      rebuilt.push_back({leaf, std::move(bloom)});
+    }
+    promise->set_value(std::move(rebuilt));
+  });
+  return future;
+}
+
+size_t FilterMonitor::installRebuilds(std::vector<LeafRebuild>&& rebuilds) {
+  for (auto& r : rebuilds) {
+    r.bloom.selectKernels(r.leaf->bloom.getProbeMode());
+    r.leaf->bloom = std::move(r.bloom);
+    r.leaf->probeCount = 0;
+    r.leaf->passCount = 0;
+    r.leaf->scanCount = 0;
+    r.leaf->hitCount = 0;
+    r.leaf->bloom.saveToFile(r.leaf->filename + "_" + r.leaf->startKey + "_" +
+                             r.leaf->endKey);
+  }
+  installedTotal += rebuilds.size();
+  spdlog::info("Installed {} rebuilt leaf filters.", rebuilds.size());
+  return rebuilds.size();
+}
+
+size_t FilterMonitor::afterQuery(const std::vector<BloomTree>& trees) {
+  size_t installed = 0;
+  for (auto it = pendingRebuilds.begin(); it != pendingRebuilds.end();) {
+    if (it->wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+      ++it;
+      continue;
+    }
+    std::vector<LeafRebuild> rebuilds = it->get();
+    for (const auto& r : rebuilds) rebuilding.erase(r.leaf);
+    installed += installRebuilds(std::move(rebuilds));
+    it = pendingRebuilds.erase(it);
+  }
+
+  if (++queriesSinceEvaluation < evaluateEvery) return installed;
+  queriesSinceEvaluation = 0;
+  for (const auto& tree : trees) {
+    std::vector<Node*> due;
+    for (Node* leaf : evaluate(tree)) {
+      if (rebuilding.insert(leaf).second) due.push_back(leaf);
+    }
+    if (!due.empty()) pendingRebuilds.push_back(scheduleRebuild(std::move(due)));
+  }
+  return installed;
+}
+
+size_t FilterMonitor::finishRebuilds() {
+  size_t installed = 0;
+  for (auto& pending : pendingRebuilds) {
+    installed += installRebuilds(pending.get());
+  }
+  pendingRebuilds.clear();
+  rebuilding.clear();
+  return installed;
+}
+
+void FilterMonitor::writeLeafStatsCsv(const std::string& filename,
+                                      const std::string& column,
+                                      const BloomTree& tree) const {
+  std::ofstream out(filename, std::ios::app);
+  if (!out) {
+    spdlog::error("FilterMonitor: cannot open '{}' for writing!", filename);
+    return;
+  }
+  for (const auto& s : leafStats(tree)) {
+    out << column << "," << s.leaf->filename << "," << s.leaf->startKey << ","
+        << s.leaf->endKey << "," << s.leaf->itemCount << "," << s.probes << ","
+        << s.passes << "," << s.scans << "," << s.hits << ","
+        << s.observedFpr << ","
+        << s.predictedFpr << "," << (s.overBudget ? 1 : 0) << "\n";
+  }
+}
+
+void FilterMonitor::writeLevelStatsCsv(const std::string& filename,
+                                       const std::string& column,
+                                       const BloomTree& tree) const {
+  std::ofstream out(filename, std::ios::app);
+  if (!out) {
+    spdlog::error("FilterMonitor: cannot open '{}' for writing!", filename);
+    return;
+  }
+  for (const auto& l : levelStats(tree)) {
+    out << column << "," << l.depth << "," << l.nodes << "," << l.probes << ","
+        << l.passes << "," << l.hits << "," << l.passRate << ","
+        << l.observedFpr << "," << l.avgPredictedFpr << "\n";
+  }
+}
@@ -0,0 +1,335 @@
+#include "hierarchy_inspector.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "bloom_manager.hpp"
+#include "db_manager.hpp"
+#include "exp_utils.hpp"
+#include "test_params.hpp"
+
+extern void clearBloomFilterFiles(const std::string& dbDir);
+
+namespace {
+
+const char* filterKindName(FilterKind kind) {
+  return kind == FilterKind::Quotient ? "quotient" : "bloom";
+}
+
+// what fillRatio measures for the kind, written next to it
+const char* fillMeasureName(FilterKind kind) {
+  return kind == FilterKind::Quotient ? "usedFingerprints" : "setBits";
+}
+
+bool filterMayContain(const Node* node, const std::string& value) {
+  return node->qfilter ? node->qfilter->exists(value)
+                       : node->bloom.exists(value);
+}
+
+// Bloom: set bits / bits. Quotient filter: distinct fingerprints stored
+// / 2^fingerprintBits possible ones, the filter's occupancy of its
+// fingerprint space (one "bit" per value, so it is also its FPR).
+double fillRatio(const Node* node) {
+  if (node->qfilter) {
+    const QuotientFilter& qf = *node->qfilter;
+    return std::min(1.0, static_cast<double>(qf.size()) /
+                             std::ldexp(1.0, qf.fingerprintBits));
+  }
+  const BloomFilter& bf = node->bloom;
+  if (bf.bitArraySize == 0) return 1.0;
+  size_t setBits = 0;
+  for (bool bit : bf.bitArray) setBits += bit;
+  return static_cast<double>(setBits) / bf.bitArraySize;
+}
+
+double fillFpr(const Node* node, double fill) {
+  if (node->qfilter) return fill;
+  return std::pow(fill, node->bloom.numHashFunctions);
+}
+
+double theoreticalFpr(const Node* node) {
+  if (node->qfilter) {
+    return std::min(1.0, static_cast<double>(node->itemCount) /
+                             std::ldexp(1.0, node->qfilter->fingerprintBits));
+  }
+  return getProbabilityOfFalsePositive(node->bloom.bitArraySize,
+                                       node->bloom.numHashFunctions,
+                                       node->itemCount);
+}
+
+size_t filterBytes(const Node* node) {
+  size_t bytes = node->qfilter ? node->qfilter->memorySize()
+                               : (node->bloom.bitArraySize + 7) / 8;
+  if (node->textBloom) bytes += (node->textBloom->bitArraySize + 7) / 8;
+  if (node->sketch) bytes += node->sketch->memorySize();
+  return bytes;
+}
+
+bool rangesOverlap(const Node* a, const Node* b) {
+  return a->startKey <= b->endKey && b->startKey <= a->endKey;
+}
+
+// mirrors BloomTree::searchNodes for an unbounded key range, without the
+// global check counters and the per-node probe statistics
+void descendAbsent(const Node* node, const std::string& value,
+                   size_t& nodesProbed, size_t& leavesReached) {
+  ++nodesProbed;
+  if (!filterMayContain(node, value)) return;
+  if (node->children.empty()) {
+    ++leavesReached;
+    return;
+  }
+  for (const Node* child : node->children) {
+    descendAbsent(child, value, nodesProbed, leavesReached);
+  }
+}
+
+}  // namespace
+
+HierarchyInspection inspectHierarchy(const BloomTree& tree,
+                                     const std::string& column,
+                                     size_t absentSamples,
+                                     size_t maxSampledNodes) {
+  HierarchyInspection inspection;
+  inspection.column = column;
+  inspection.filterKind = tree.getFilterKind();
+  inspection.bloomSize = tree.getBloomSize();
+  inspection.numHashFunctions = tree.getNumHashFunctions();
+  inspection.foldTargetFpr = tree.getFoldTargetFpr();
+  inspection.leaves = tree.leafNodes.size();
+  if (!tree.root) return inspection;
+
+  std::vector<std::vector<const Node*>> levels;
+  std::vector<const Node*> current = {tree.root};
+  while (!current.empty()) {
+    levels.push_back(current);
+    std::vector<const Node*> next;
+    for (const Node* node : current) {
+      next.insert(next.end(), node->children.begin(), node->children.end());
+    }
+    current = std::move(next);
+  }
+  inspection.depth = levels.size();
+
+  std::vector<std::string> absentValues;
+  absentValues.reserve(absentSamples);
+  for (size_t i = 0; i < absentSamples; ++i) {
+    absentValues.push_back(column + "_absent" + std::to_string(i));
+  }
+
+  for (size_t depth = 0; depth < levels.size(); ++depth) {
+    const std::vector<const Node*>& nodes = levels[depth];
+    LevelInspection level;
+    level.depth = depth;
+    level.nodes = nodes.size();
+    level.minFillRatio = 1.0;
+
+    for (const Node* node : nodes) {
+      if (node->children.empty()) ++level.leaves;
+      level.items += node->itemCount;
+      level.filterBytes += filterBytes(node);
+      double fill = fillRatio(node);
+      double fpr = fillFpr(node, fill);
+      level.avgFillRatio += fill;
+      level.minFillRatio = std::min(level.minFillRatio, fill);
+      level.maxFillRatio = std::max(level.maxFillRatio, fill);
+      level.avgFillFpr += fpr;
+      level.maxFillFpr = std::max(level.maxFillFpr, fpr);
+      level.avgTheoreticalFpr += theoreticalFpr(node);
+    }
+    level.avgFillRatio /= nodes.size();
+    level.avgFillFpr /= nodes.size();
+    level.avgTheoreticalFpr /= nodes.size();
+
+    if (depth > 0) {
+      for (const Node* parent : levels[depth - 1]) {
+        const auto& children = parent->children;
+        for (size_t i = 0; i < children.size(); ++i) {
+          for (size_t j = i + 1; j < children.size(); ++j) {
+            ++level.siblingPairs;
+            if (rangesOverlap(children[i], children[j])) {
+              ++level.overlappingSiblingPairs;
+            }
+          }
+        }
+      }
+    }
+
+    size_t stride = std::max<size_t>(1, nodes.size() / std::max<size_t>(1, maxSampledNodes));
+    for (size_t i = 0; i < nodes.size(); i += stride) {
+      ++level.sampledNodes;
+      for (const std::string& value : absentValues) {
+        ++level.absentProbes;
+        if (filterMayContain(nodes[i], value)) ++level.absentPasses;
+      }
+    }
+    if (level.absentProbes > 0) {
+      level.empiricalFpr =
+          static_cast<double>(level.absentPasses) / level.absentProbes;
+    }
+    inspection.levels.push_back(level);
+  }
+
+  size_t totalLeaves = 0;
+  size_t totalNodes = 0;
+  for (const std::string& value : absentValues) {
+    size_t nodesProbed = 0;
+    size_t leavesReached = 0;
+    descendAbsent(tree.root, value, nodesProbed, leavesReached);
+    totalNodes += nodesProbed;
+    totalLeaves += leavesReached;
+    if (leavesReached > 0) ++inspection.absentQueriesReachingLeaf;
+  }
+  inspection.absentQueries = absentValues.size();
+  if (!absentValues.empty()) {
+    inspection.avgLeavesPerAbsentQuery =
+        static_cast<double>(totalLeaves) / absentValues.size();
+    inspection.avgNodesProbedPerAbsentQuery =
+        static_cast<double>(totalNodes) / absentValues.size();
+  }
+  return inspection;
+}
+
+void logHierarchyInspection(const HierarchyInspection& inspection) {
+  spdlog::info(
+      "Inspect [{}]: {} filter, fold target FPR {}, {} leaves, depth {}, "
+      "absent queries reaching a leaf {}/{}, {:.2f} nodes probed per absent "
+      "query",
+      inspection.column, filterKindName(inspection.filterKind),
+      inspection.foldTargetFpr, inspection.leaves, inspection.depth,
+      inspection.absentQueriesReachingLeaf, inspection.absentQueries,
+      inspection.avgNodesProbedPerAbsentQuery);
+  for (const auto& level : inspection.levels) {
+    spdlog::info(
+        "  depth {}: {} nodes ({} leaves), fill ({}) {:.3f} [{:.3f}, {:.3f}], "
+        "FPR fill {:.2e} theory {:.2e} sampled {:.2e}, overlapping siblings "
+        "{}/{}, {} B",
+        level.depth, level.nodes, level.leaves,
+        fillMeasureName(inspection.filterKind), level.avgFillRatio,
+        level.minFillRatio, level.maxFillRatio, level.avgFillFpr,
+        level.avgTheoreticalFpr, level.empiricalFpr,
+        level.overlappingSiblingPairs, level.siblingPairs, level.filterBytes);
+  }
+}
+
+void writeInspectionCsv(const std::string& filename,
+                        const std::vector<HierarchyInspection>& inspections) {
+  std::ofstream out(filename, std::ios::trunc);
+  if (!out) {
+    spdlog::error("Inspect: Nie udało się otworzyć pliku '{}'!", filename);
+    return;
+  }
+  out << "column,filterKind,fillMeasure,bloomSize,numHashFunctions,"
+         "foldTargetFpr,depth,"
+         "nodes,leaves,items,filterBytes,avgFillRatio,minFillRatio,maxFillRatio,"
+         "avgFillFpr,maxFillFpr,avgTheoreticalFpr,siblingPairs,"
+         "overlappingSiblingPairs,sampledNodes,absentProbes,absentPasses,"
+         "empiricalFpr\n";
+  for (const auto& inspection : inspections) {
+    for (const auto& level : inspection.levels) {
+      out << inspection.column << "," << filterKindName(inspection.filterKind)
+          << "," << fillMeasureName(inspection.filterKind) << ","
+          << inspection.bloomSize << "," << inspection.numHashFunctions
+          << "," << inspection.foldTargetFpr << "," << level.depth << "," << level.nodes << "," << level.leaves
+          << "," << level.items << "," << level.filterBytes << ","
+          << level.avgFillRatio << "," << level.minFillRatio << ","
+          << level.maxFillRatio << "," << level.avgFillFpr << ","
+          << level.maxFillFpr << "," << level.avgTheoreticalFpr << ","
+          << level.siblingPairs << "," << level.overlappingSiblingPairs << ","
+          << level.sampledNodes << "," << level.absentProbes << ","
+          << level.absentPasses << "," << level.empiricalFpr << "\n";
+    }
+  }
+}
+
+void writeInspectionJson(const std::string& filename,
+                         const std::vector<HierarchyInspection>& inspections) {
+  std::ofstream out(filename, std::ios::trunc);
+  if (!out) {
+    spdlog::error("Inspect: Nie udało się otworzyć pliku '{}'!", filename);
+    return;
+  }
+  out << "[\n";
+  for (size_t h = 0; h < inspections.size(); ++h) {
+    const auto& inspection = inspections[h];
+    // column names are plain identifiers, no escaping needed
+    out << "  {\"column\": \"" << inspection.column << "\", \"filterKind\": \""
+        << filterKindName(inspection.filterKind) << "\", \"fillMeasure\": \""
+        << fillMeasureName(inspection.filterKind)
+        << "\", \"bloomSize\": " << inspection.bloomSize
+        << ", \"numHashFunctions\": " << inspection.numHashFunctions
+        << ", \"foldTargetFpr\": " << inspection.foldTargetFpr
+        << ", \"leaves\": " << inspection.leaves
+        << ", \"depth\": " << inspection.depth
+        << ", \"absentQueries\": " << inspection.absentQueries
+        << ", \"absentQueriesReachingLeaf\": "
+        << inspection.absentQueriesReachingLeaf
+        << ", \"avgLeavesPerAbsentQuery\": "
+        << inspection.avgLeavesPerAbsentQuery
+        << ", \"avgNodesProbedPerAbsentQuery\": "
+        << inspection.avgNodesProbedPerAbsentQuery << ",\n   \"levels\": [\n";
+    for (size_t l = 0; l < inspection.levels.size(); ++l) {
+      const auto& level = inspection.levels[l];
+      out << "    {\"depth\": " << level.depth << ", \"nodes\": " << level.nodes
+          << ", \"leaves\": " << level.leaves << ", \"items\": " << level.items
+          << ", \"filterBytes\": " << level.filterBytes
+          << ", \"avgFillRatio\": " << level.avgFillRatio
+          << ", \"minFillRatio\": " << level.minFillRatio
+          << ", \"maxFillRatio\": " << level.maxFillRatio
+          << ", \"avgFillFpr\": " << level.avgFillFpr
+          << ", \"maxFillFpr\": " << level.maxFillFpr
+          << ", \"avgTheoreticalFpr\": " << level.avgTheoreticalFpr
+          << ", \"siblingPairs\": " << level.siblingPairs
+          << ", \"overlappingSiblingPairs\": " << level.overlappingSiblingPairs
+          << ", \"sampledNodes\": " << level.sampledNodes
+          << ", \"absentProbes\": " << level.absentProbes
+          << ", \"absentPasses\": " << level.absentPasses
+          << ", \"empiricalFpr\": " << level.empiricalFpr << "}"
+          << (l + 1 < inspection.levels.size() ? "," : "") << "\n";
+    }
+    out << "   ]}" << (h + 1 < inspections.size() ? "," : "") << "\n";
+  }
+  out << "]\n";
+}
+
+void runHierarchyInspection(const std::string& dbPath, size_t dbSize,
+                            int ratio, size_t bloomSize,
+                            size_t itemsPerPartition, int numHashFunctions,
+                            size_t absentSamples, double foldTargetFpr) {
+  const std::vector<std::string> columns = {"phone", "mail", "address"};
+  TestParams params = {dbPath,   static_cast<int>(dbSize), ratio, 1,
+                       itemsPerPartition, bloomSize, numHashFunctions};
+  params.foldTargetFpr = foldTargetFpr;
+  spdlog::info(
+      "Inspect: database '{}', ratio {}, bloom size {} bits, {} items per "
+      "partition, {} hash functions, fold target FPR {}",
+      dbPath, ratio, bloomSize, itemsPerPartition, numHashFunctions,
+      foldTargetFpr);
+
+  DBManager dbManager;
+  BloomManager bloomManager;
+  clearBloomFilterFiles(dbPath);
+  dbManager.openDB(dbPath, columns);
+
+  std::map<std::string, std::vector<std::string>> columnSstFiles =
+      scanSstFilesAsync(columns, dbManager, params);
+  std::map<std::string, BloomTree> hierarchies =
+      buildHierarchies(columnSstFiles, bloomManager, params, &dbManager);
+
+  std::vector<HierarchyInspection> inspections;
+  for (const auto& [column, tree] : hierarchies) {
+    inspections.push_back(inspectHierarchy(tree, column, absentSamples));
+    logHierarchyInspection(inspections.back());
+  }
+  writeInspectionCsv("csv/hierarchy_inspect.csv", inspections);
+  writeInspectionJson("csv/hierarchy_inspect.json", inspections);
+  spdlog::info("Inspect: written csv/hierarchy_inspect.csv and .json");
+
+  dbManager.closeDB();
+}
@@ -1,5 +1,6 @@
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
 #include <chrono>
 #include <filesystem>
 #include <future>
@@ -21,10 +22,24 @@
 #include "exp6.hpp"
 #include "exp7.hpp"
 #include "exp8.hpp"
+#include "exp9.hpp"
+#include "exp10.hpp"
+#include "exp11.hpp"
+#include "exp12.hpp"
+#include "exp13.hpp"
+#include "exp14.hpp"
+#include "exp15.hpp"
+#include "hierarchy_inspector.hpp"
+#include "metrics.hpp"
+#include "memory_accounting.hpp"
+#include "perf_counters.hpp"
+#include "query_log.hpp"
 #include "stopwatch.hpp"
 #include "test_params.hpp"
 
-boost::asio::thread_pool globalThreadPool{std::thread::hardware_concurrency()};
+extern const size_t globalThreadPoolSize =
+    std::max(1u, std::thread::hardware_concurrency());
+boost::asio::thread_pool globalThreadPool{globalThreadPoolSize};
 
 void clearBloomFilterFiles(const std::string& dbDir) {
   std::regex bloomFilePattern(R"(^\d+\.sst_[^_]+_[^_]+$)");
@@ -61,11 +76,77 @@ int main(int argc, char* argv[]) {
   }
   bool initMode = false;
   bool skipDbScan = false;
+  bool concurrencyBench = false;
+  bool asyncClients = false;
+  bool mixedBench = false;
+  bool openLoopBench = false;
+  bool replayTimed = false;
+  bool dictionaryBench = false;
+  bool indexBench = false;
+  bool predicateBench = false;
+  std::string captureLogPath;
+  std::string replayLogPath;
+  std::string metricsFile;
+  int metricsPort = 0;
+  int metricsIntervalMs = 5000;
+  long long queryBudgetMicros = 0;
+  bool inspect = false;
+  int inspectRatio = 3;
+  size_t inspectBloomSize = 4'000'000;
+  size_t inspectItems = 100000;
+  int inspectHashFunctions = 3;
+  double inspectFoldFpr = 0.0;
   for (int i = 1; i < argc; ++i) {
     if (std::string(argv[i]) == "--build-db") {
       initMode = true;
     } else if (std::string(argv[i]) == "--skip-scan") {
       skipDbScan = true;
+    } else if (std::string(argv[i]) == "--concurrency") {
+      concurrencyBench = true;
+    } else if (std::string(argv[i]) == "--async-clients") {
+      asyncClients = true;
+    } else if (std::string(argv[i]) == "--mixed-workload") {
+      mixedBench = true;
+    } else if (std::string(argv[i]) == "--open-loop") {
+      openLoopBench = true;
+    } else if (std::string(argv[i]) == "--capture-queries" && i + 1 < argc) {
+      captureLogPath = argv[++i];
+    } else if (std::string(argv[i]) == "--replay" && i + 1 < argc) {
+      replayLogPath = argv[++i];
+    } else if (std::string(argv[i]) == "--replay-timed") {
+      replayTimed = true;
+    } else if (std::string(argv[i]) == "--dictionary") {
+      dictionaryBench = true;
+    } else if (std::string(argv[i]) == "--secondary-index") {
+      indexBench = true;
+    } else if (std::string(argv[i]) == "--predicates") {
+      predicateBench = true;
+    } else if (std::string(argv[i]) == "--perf-counters") {
+      setPerfCountersEnabled(true);
+    } else if (std::string(argv[i]) == "--memory-accounting") {
+      if (!enableMemoryAccounting(true)) {
+        spdlog::warn("--memory-accounting ignored: build with MEMORY_ACCOUNTING=1.");
+      }
+    } else if (std::string(argv[i]) == "--metrics-file" && i + 1 < argc) {
+      metricsFile = argv[++i];
+    } else if (std::string(argv[i]) == "--metrics-port" && i + 1 < argc) {
+      metricsPort = std::stoi(argv[++i]);
+    } else if (std::string(argv[i]) == "--metrics-interval-ms" && i + 1 < argc) {
+      metricsIntervalMs = std::stoi(argv[++i]);
+    } else if (std::string(argv[i]) == "--query-budget-ms" && i + 1 < argc) {
+      queryBudgetMicros = std::stoll(argv[++i]) * 1000;
+    } else if (std::string(argv[i]) == "--inspect") {
+      inspect = true;
+    } else if (std::string(argv[i]) == "--inspect-ratio" && i + 1 < argc) {
+      inspectRatio = std::stoi(argv[++i]);
+    } else if (std::string(argv[i]) == "--inspect-bloom-size" && i + 1 < argc) {
+      inspectBloomSize = std::stoull(argv[++i]);
+    } else if (std::string(argv[i]) == "--inspect-items" && i + 1 < argc) {
+      inspectItems = std::stoull(argv[++i]);
+    } else if (std::string(argv[i]) == "--inspect-hashes" && i + 1 < argc) {
+      inspectHashFunctions = std::stoi(argv[++i]);
+    } else if (std::string(argv[i]) == "--inspect-fold-fpr" && i + 1 < argc) {
+      inspectFoldFpr = std::stod(argv[++i]);
     }
   }
 
@@ -73,7 +154,50 @@ int main(int argc, char* argv[]) {
   const std::vector<std::string> defaultColumns = {"phone", "mail", "address"};
   const int defaultNumRecords = 50000000;
 
+  std::unique_ptr<MetricsExporter> metricsExporter;
+  if (!metricsFile.empty() || metricsPort > 0) {
+    metricsExporter = std::make_unique<MetricsExporter>(
+        metricsFile, metricsPort, std::chrono::milliseconds(metricsIntervalMs));
+  }
+
   try {
+    if (inspect) {
+      runHierarchyInspection(sharedDbName, defaultNumRecords, inspectRatio,
+                             inspectBloomSize, inspectItems,
+                             inspectHashFunctions, 10000, inspectFoldFpr);
+      return EXIT_SUCCESS;
+    }
+    if (!replayLogPath.empty()) {
+      runExp12(sharedDbName, defaultNumRecords, replayLogPath, replayTimed);
+      return EXIT_SUCCESS;
+    }
+    if (dictionaryBench) {
+      runExp13(baseDir, 10000000);
+      return EXIT_SUCCESS;
+    }
+    if (indexBench) {
+      runExp14(baseDir, 10000000);
+      return EXIT_SUCCESS;
+    }
+    if (predicateBench) {
+      runExp15(sharedDbName, defaultNumRecords);
+      return EXIT_SUCCESS;
+    }
+    if (!captureLogPath.empty()) {
+      startQueryCapture(captureLogPath);
+    }
+    if (concurrencyBench) {
+      runExp9(sharedDbName, defaultNumRecords, skipDbScan, asyncClients);
+      return EXIT_SUCCESS;
+    }
+    if (mixedBench) {
+      runExp10(sharedDbName, defaultNumRecords, skipDbScan);
+      return EXIT_SUCCESS;
+    }
+    if (openLoopBench) {
+      runExp11(sharedDbName, defaultNumRecords, skipDbScan, queryBudgetMicros);
+      return EXIT_SUCCESS;
+    }
     // run section- test
     // runExp1(baseDir, initMode, sharedDbName, defaultNumRecords, skipDbScan);
     // EXP 2 included in exp5 run
@@ -83,6 +207,14 @@ int main(int argc, char* argv[]) {
     runExp6(sharedDbName, defaultNumRecords, skipDbScan);
     // runExp7(sharedDbName, defaultNumRecords, skipDbScan);
     // runExp8(baseDir, initMode, skipDbScan);
+    // runExp9(sharedDbName, defaultNumRecords, skipDbScan);
+    // runExp10(sharedDbName, defaultNumRecords, skipDbScan);
+    // runExp11(sharedDbName, defaultNumRecords, skipDbScan);
+    // runExp12(sharedDbName, defaultNumRecords, "csv/queries.hql", false);
+    // runExp13(baseDir, 10000000);
+    // runExp14(baseDir, 10000000);
+    // runExp15(sharedDbName, defaultNumRecords);
+    stopQueryCapture();
   } catch (const std::exception& e) {
     spdlog::error("[Error] {}", e.what());
     return EXIT_FAILURE;
@@ -0,0 +1,360 @@
+#include "metrics.hpp"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <spdlog/spdlog.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#include "algorithm.hpp"
+#include "bloomTree.hpp"
+#include "db_manager.hpp"
+#include "memory_accounting.hpp"
+
+namespace {
+
+std::string escapeLabelValue(const std::string& value) {
+  std::string out;
+  out.reserve(value.size());
+  for (char c : value) {
+    if (c == '\\' || c == '"') out += '\\';
+    if (c == '\n') {
+      out += "\\n";
+      continue;
+    }
+    out += c;
+  }
+  return out;
+}
+
+std::string labelKey(const MetricLabels& labels) {
+  if (labels.empty()) return "";
+  std::string key = "{";
+  for (size_t i = 0; i < labels.size(); ++i) {
+    if (i > 0) key += ",";
+    key += labels[i].first + "=\"" + escapeLabelValue(labels[i].second) + "\"";
+  }
+  return key + "}";
+}
+
+// adds le="bound" to an existing label set
+std::string withLe(const std::string& key, const std::string& le) {
+  std::string entry = "le=\"" + le + "\"";
+  if (key.empty()) return "{" + entry + "}";
+  return key.substr(0, key.size() - 1) + "," + entry + "}";
+}
+
+std::string formatDouble(double v) {
+  std::ostringstream out;
+  out << v;
+  return out.str();
+}
+
+}  // namespace
+
+Histogram::Histogram(std::vector<double> bounds)
+    : bounds_(std::move(bounds)),
+      buckets_(new std::atomic<uint64_t>[bounds_.size() + 1]) {
+  std::sort(bounds_.begin(), bounds_.end());
+  for (size_t i = 0; i <= bounds_.size(); ++i) buckets_[i] = 0;
+}
+
+void Histogram::observe(double v) {
+  size_t bucket =
+      std::lower_bound(bounds_.begin(), bounds_.end(), v) - bounds_.begin();
+  buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+  count_.fetch_add(1, std::memory_order_relaxed);
+  sum_.fetch_add(v, std::memory_order_relaxed);
+}
+
+std::vector<uint64_t> Histogram::bucketCounts() const {
+  std::vector<uint64_t> counts(bounds_.size() + 1);
+  for (size_t i = 0; i < counts.size(); ++i) {
+    counts[i] = buckets_[i].load(std::memory_order_relaxed);
+  }
+  return counts;
+}
+
+MetricsRegistry& MetricsRegistry::instance() {
+  static MetricsRegistry registry;
+  return registry;
+}
+
+const std::vector<double>& MetricsRegistry::latencyBucketsMicros() {
+  static const std::vector<double> bounds = {
+      50,     100,    250,     500,     1000,    2500,    5000,
+      10000,  25000,  50000,   100000,  250000,  500000,  1000000,
+      2500000, 5000000, 10000000};
+  return bounds;
+}
+
+MetricsRegistry::Family& MetricsRegistry::family(const std::string& name,
+                                                 const std::string& help,
+                                                 Type type) {
+  auto [it, added] = families.try_emplace(name);
+  if (added) {
+    it->second.type = type;
+    it->second.help = help;
+  } else if (it->second.type != type) {
+    throw std::runtime_error("Metric '" + name + "' registered with another type");
+  }
+  return it->second;
+}
+
+Counter& MetricsRegistry::counter(const std::string& name,
+                                  const std::string& help,
+                                  const MetricLabels& labels) {
+  std::lock_guard<std::mutex> lock(mtx);
+  auto& series = family(name, help, Type::Counter).counters[labelKey(labels)];
+  if (!series) series = std::make_unique<Counter>();
+  return *series;
+}
+
+Gauge& MetricsRegistry::gauge(const std::string& name, const std::string& help,
+                              const MetricLabels& labels) {
+  std::lock_guard<std::mutex> lock(mtx);
+  auto& series = family(name, help, Type::Gauge).gauges[labelKey(labels)];
+  if (!series) series = std::make_unique<Gauge>();
+  return *series;
+}
+
+Histogram& MetricsRegistry::histogram(const std::string& name,
+                                      const std::string& help,
+                                      const MetricLabels& labels,
+                                      const std::vector<double>& bounds) {
+  std::lock_guard<std::mutex> lock(mtx);
+  auto& series = family(name, help, Type::Histogram).histograms[labelKey(labels)];
+  if (!series) series = std::make_unique<Histogram>(bounds);
+  return *series;
+}
+
+void MetricsRegistry::addCollector(std::function<void()> collector) {
+  std::lock_guard<std::mutex> lock(mtx);
+  collectors.push_back(std::move(collector));
+}
+
+void MetricsRegistry::collect() {
+  std::vector<std::function<void()>> pending;
+  {
+    std::lock_guard<std::mutex> lock(mtx);
+    pending = collectors;
+  }
+  // collectors register series themselves, so they run unlocked
+  for (const auto& collector : pending) collector();
+}
+
+std::string MetricsRegistry::renderPrometheus() const {
+  std::lock_guard<std::mutex> lock(mtx);
+  std::ostringstream out;
+  for (const auto& [name, fam] : families) {
+    const char* type = fam.type == Type::Counter ? "counter"
+                       : fam.type == Type::Gauge ? "gauge"
+                                                 : "histogram";
+    out << "# HELP " << name << " " << fam.help << "\n";
+    out << "# TYPE " << name << " " << type << "\n";
+    for (const auto& [key, series] : fam.counters) {
+      out << name << key << " " << series->value() << "\n";
+    }
+    for (const auto& [key, series] : fam.gauges) {
+      out << name << key << " " << formatDouble(series->value()) << "\n";
+    }
+    for (const auto& [key, series] : fam.histograms) {
+      std::vector<uint64_t> counts = series->bucketCounts();
+      uint64_t cumulative = 0;
+      for (size_t i = 0; i < series->bounds().size(); ++i) {
+        cumulative += counts[i];
+        out << name << "_bucket" << withLe(key, formatDouble(series->bounds()[i]))
+            << " " << cumulative << "\n";
+      }
+      cumulative += counts.back();
+      out << name << "_bucket" << withLe(key, "+Inf") << " " << cumulative << "\n";
+      out << name << "_sum" << key << " " << formatDouble(series->sum()) << "\n";
+      out << name << "_count" << key << " " << series->count() << "\n";
+    }
+  }
+  return out.str();
+}
+
+QueryPlanMetrics::QueryPlanMetrics(const char* plan)
+    : queries(metrics().counter("hdb_queries_total", "Queries executed",
+                                {{"plan", plan}})),
+      latency(metrics().histogram("hdb_query_latency_micros",
+                                  "Query latency in microseconds",
+                                  {{"plan", plan}})),
+      bloomChecks(metrics().counter("hdb_bloom_checks_total",
+                                    "Bloom filter probes", {{"plan", plan}})),
+      leafBloomChecks(metrics().counter("hdb_leaf_bloom_checks_total",
+                                        "Leaf bloom filter probes",
+                                        {{"plan", plan}})),
+      sstChecks(metrics().counter("hdb_sst_checks_total",
+                                  "SST partitions scanned", {{"plan", plan}})) {}
+
+QueryMetricsScope::QueryMetricsScope(QueryPlanMetrics& series)
+    : series(series), begin(std::chrono::steady_clock::now()), countScope(counters) {}
+
+QueryMetricsScope::~QueryMetricsScope() {
+  long long micros = std::chrono::duration_cast<std::chrono::microseconds>(
+                         std::chrono::steady_clock::now() - begin)
+                         .count();
+  series.queries.inc();
+  series.latency.observe(static_cast<double>(micros));
+  series.bloomChecks.inc(counters.bloomChecks.load());
+  series.leafBloomChecks.inc(counters.leafBloomChecks.load());
+  series.sstChecks.inc(counters.sstChecks.load());
+}
+
+void exportHierarchyMetrics(const std::string& column, const BloomTree& tree) {
+  MetricsRegistry& registry = metrics();
+  std::vector<size_t> byDepth = tree.memorySizeByDepth();
+  for (size_t depth = 0; depth < byDepth.size(); ++depth) {
+    registry
+        .gauge("hdb_hierarchy_memory_bytes",
+               "Internal filter bytes per column and depth below the root",
+               {{"column", column}, {"level", std::to_string(depth)}})
+        .set(static_cast<double>(byDepth[depth]));
+  }
+  registry
+      .gauge("hdb_hierarchy_leaf_bytes", "Leaf filter bytes per column",
+             {{"column", column}})
+      .set(static_cast<double>(tree.diskSize()));
+  registry
+      .gauge("hdb_hierarchy_leaves", "Leaf partitions per column",
+             {{"column", column}})
+      .set(static_cast<double>(tree.leafNodes.size()));
+}
+
+MetricsExporter::MetricsExporter(std::string filePath, int port,
+                                 std::chrono::milliseconds interval)
+    : filePath(std::move(filePath)), port(port), interval(interval) {
+  MetricsRegistry& registry = metrics();
+  registry.addCollector([]() {
+    metrics()
+        .gauge("hdb_pool_queued_tasks",
+               "Query tasks posted to the thread pool and not started")
+        .set(static_cast<double>(gPoolQueuedTasks.load()));
+    if (!memoryAccountingEnabled()) return;
+    for (size_t i = 0; i < kMemoryTags; ++i) {
+      MemoryTag tag = static_cast<MemoryTag>(i);
+      MemoryTagStats stats = memoryStats(tag);
+      MetricLabels labels = {{"tag", memoryTagName(tag)}};
+      metrics()
+          .gauge("hdb_memory_live_bytes", "Live heap bytes per subsystem", labels)
+          .set(static_cast<double>(stats.liveBytes));
+      metrics()
+          .gauge("hdb_memory_peak_bytes", "Peak heap bytes per subsystem", labels)
+          .set(static_cast<double>(stats.peakBytes));
+      metrics()
+          .gauge("hdb_memory_allocations", "Heap allocations per subsystem",
+                 labels)
+          .set(static_cast<double>(stats.allocations));
+    }
+  });
+
+  if (port > 0) {
+    listenFd = socket(AF_INET, SOCK_STREAM, 0);
+    int reuse = 1;
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (listenFd < 0 ||
+        bind(listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        listen(listenFd, 8) != 0) {
+      spdlog::error("Metrics: cannot listen on 127.0.0.1:{}, socket export disabled.",
+                    port);
+      if (listenFd >= 0) close(listenFd);
+      listenFd = -1;
+    } else {
+      spdlog::info("Metrics: serving on http://127.0.0.1:{}/metrics", port);
+    }
+  }
+  worker = std::thread([this]() { run(); });
+}
+
+MetricsExporter::~MetricsExporter() { stop(); }
+
+void MetricsExporter::stop() {
+  if (!running.exchange(false)) return;
+  if (worker.joinable()) worker.join();
+  if (listenFd >= 0) close(listenFd);
+  listenFd = -1;
+}
+
+void MetricsExporter::run() {
+  while (running) {
+    auto deadline = std::chrono::steady_clock::now() + interval;
+    MetricsRegistry& registry = metrics();
+    registry.collect();
+    std::string text = registry.renderPrometheus();
+    if (!filePath.empty()) writeFile(text);
+    serveUntil(deadline, text);
+  }
+  // final snapshot so short runs leave their totals behind
+  metrics().collect();
+  if (!filePath.empty()) writeFile(metrics().renderPrometheus());
+}
+
+void MetricsExporter::writeFile(const std::string& text) const {
+  std::string tmp = filePath + ".tmp";
+  {
+    std::ofstream out(tmp, std::ios::trunc);
+    if (!out) {
+      spdlog::error("Metrics: cannot write '{}'.", tmp);
+      return;
+    }
+    out << text;
+  }
+  std::error_code ec;
+  std::filesystem::rename(tmp, filePath, ec);
+  if (ec) spdlog::error("Metrics: cannot replace '{}': {}", filePath, ec.message());
+}
+
+// Answers every connection with the last snapshot until the deadline; the
+// request itself is not parsed.
+void MetricsExporter::serveUntil(std::chrono::steady_clock::time_point deadline,
+                                 const std::string& text) {
+  // wake up at least every 100 ms to notice stop()
+  constexpr auto kPollSlice = std::chrono::milliseconds(100);
+  while (running) {
+    auto now = std::chrono::steady_clock::now();
+    if (now >= deadline) return;
+    auto wait = std::min<std::chrono::milliseconds>(
+        kPollSlice,
+        std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now));
+    if (listenFd < 0) {
+      std::this_thread::sleep_for(wait);
+      continue;
+    }
+    pollfd pfd{listenFd, POLLIN, 0};
+    if (poll(&pfd, 1, static_cast<int>(wait.count())) <= 0) continue;
+    int client = accept(listenFd, nullptr, nullptr);
+    if (client < 0) continue;
+    // a client that connects and never sends must not stall the exporter
+    timeval timeout{1, 0};
+    setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    char request[1024];
+    [[maybe_unused]] ssize_t ignored = recv(client, request, sizeof(request), 0);
+    std::string response =
+        "HTTP/1.0 200 OK\r\n"
+        "Content-Type: text/plain; version=0.0.4\r\n"
+        "Content-Length: " + std::to_string(text.size()) + "\r\n\r\n" + text;
+    size_t sent = 0;
+    while (sent < response.size()) {
+      ssize_t n = send(client, response.data() + sent, response.size() - sent,
+                       MSG_NOSIGNAL);
+      if (n <= 0) break;
+      sent += static_cast<size_t>(n);
+    }
+    close(client);
+  }
+}
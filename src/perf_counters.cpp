@@ -0,0 +1,195 @@
+#include "perf_counters.hpp"
+
+#include <linux/perf_event.h>
+#include <spdlog/spdlog.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+
+namespace {
+
+std::atomic<bool> gPerfEnabled{false};
+std::atomic<unsigned> gPerfAvailable{0};
+std::atomic<bool> gPerfMultiplexed{false};
+std::array<std::array<std::atomic<uint64_t>, kPerfEvents>, kPerfPhases>
+    gPerfTotals{};
+
+struct EventSpec {
+  uint32_t type;
+  uint64_t config;
+};
+
+constexpr std::array<EventSpec, kPerfEvents> kEventSpecs = {{
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {PERF_TYPE_HW_CACHE,
+     PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+         (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+}};
+
+// Counters of one thread, opened on first use and kept for its lifetime
+// (pool threads live as long as the process).
+class ThreadCounters {
+ public:
+  ThreadCounters() {
+    for (size_t i = 0; i < kPerfEvents; ++i) {
+      perf_event_attr attr;
+      std::memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.type = kEventSpecs[i].type;
+      attr.config = kEventSpecs[i].config;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      attr.read_format =
+          PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+      fds[i] = static_cast<int>(
+          syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC));
+      if (fds[i] >= 0) {
+        gPerfAvailable.fetch_or(1u << i, std::memory_order_relaxed);
+      } else if (i == 0) {
+        spdlog::warn("perf_event_open unavailable ({}), hardware counters read as 0.",
+                     std::strerror(errno));
+      }
+    }
+  }
+
+  ~ThreadCounters() {
+    for (int fd : fds) {
+      if (fd >= 0) close(fd);
+    }
+  }
+
+  void read(PerfReading& out) const {
+    for (size_t i = 0; i < kPerfEvents; ++i) {
+      uint64_t raw[3] = {0, 0, 0};  // value, time enabled, time running
+      if (fds[i] >= 0 && ::read(fds[i], raw, sizeof(raw)) != sizeof(raw)) {
+        raw[0] = raw[1] = raw[2] = 0;
+      }
+      out.value[i] = raw[0];
+      out.enabled[i] = raw[1];
+      out.running[i] = raw[2];
+    }
+  }
+
+ private:
+  std::array<int, kPerfEvents> fds{};
+};
+
+const ThreadCounters& threadCounters() {
+  thread_local ThreadCounters counters;
+  return counters;
+}
+
+}  // namespace
+
+void setPerfCountersEnabled(bool enabled) {
+  gPerfEnabled.store(enabled, std::memory_order_relaxed);
+  if (enabled) threadCounters();  // report availability up front
+}
+
+bool perfCountersEnabled() { return gPerfEnabled.load(std::memory_order_relaxed); }
+
+unsigned perfEventsAvailable() { return gPerfAvailable.load(std::memory_order_relaxed); }
+
+void resetPerfCounters() {
+  for (auto& phase : gPerfTotals) {
+    for (auto& total : phase) total.store(0, std::memory_order_relaxed);
+  }
+  gPerfMultiplexed.store(false, std::memory_order_relaxed);
+}
+
+PerfCounts perfCounters(PerfPhase phase) {
+  PerfCounts counts{};
+  const auto& totals = gPerfTotals[static_cast<size_t>(phase)];
+  for (size_t i = 0; i < kPerfEvents; ++i) {
+    counts[i] = totals[i].load(std::memory_order_relaxed);
+  }
+  return counts;
+}
+
+PhasePerfCounts perfCountersByPhase() {
+  PhasePerfCounts counts{};
+  for (size_t phase = 0; phase < kPerfPhases; ++phase) {
+    counts[phase] = perfCounters(static_cast<PerfPhase>(phase));
+  }
+  return counts;
+}
+
+bool perfCountersMultiplexed() {
+  return gPerfMultiplexed.load(std::memory_order_relaxed);
+}
+
+const char* perfEventName(PerfEvent event) {
+  switch (event) {
+    case PerfEvent::Cycles: return "cycles";
+    case PerfEvent::Instructions: return "instructions";
+    case PerfEvent::LLCMisses: return "llcMisses";
+    case PerfEvent::DTLBMisses: return "dtlbMisses";
+    case PerfEvent::BranchMisses: return "branchMisses";
+    default: return "unknown";
+  }
+}
+
+const char* perfPhaseName(PerfPhase phase) {
+  switch (phase) {
+    case PerfPhase::Filter: return "filter";
+    case PerfPhase::Scan: return "scan";
+    case PerfPhase::Verify: return "verify";
+    default: return "unknown";
+  }
+}
+
+std::string perfCsvHeader(const std::string& prefix) {
+  std::string header;
+  for (size_t i = 0; i < kPerfEvents; ++i) {
+    std::string name = perfEventName(static_cast<PerfEvent>(i));
+    if (!prefix.empty()) name[0] = static_cast<char>(std::toupper(name[0]));
+    if (i > 0) header += ",";
+    header += prefix + name;
+  }
+  return header;
+}
+
+std::string perfCsvValues(const PerfCounts& counts) {
+  std::string values;
+  for (size_t i = 0; i < kPerfEvents; ++i) {
+    if (i > 0) values += ",";
+    values += std::to_string(counts[i]);
+  }
+  return values;
+}
+
+PerfScope::PerfScope(PerfPhase phase) : phase(phase) {
+  if (!perfCountersEnabled()) return;
+  active = true;
+  threadCounters().read(start);
+}
+
+PerfScope::~PerfScope() {
+  if (!active) return;
+  PerfReading end;
+  threadCounters().read(end);
+  auto& totals = gPerfTotals[static_cast<size_t>(phase)];
+  for (size_t i = 0; i < kPerfEvents; ++i) {
+    uint64_t count = end.value[i] - start.value[i];
+    uint64_t enabled = end.enabled[i] - start.enabled[i];
+    uint64_t running = end.running[i] - start.running[i];
+    if (running < enabled) {
+      // the event shared the PMU; extrapolate to the whole scope
+      count = running > 0 ? static_cast<uint64_t>(static_cast<double>(count) *
+                                                  enabled / running)
+                          : 0;
+      if (!gPerfMultiplexed.exchange(true, std::memory_order_relaxed)) {
+        spdlog::debug("perf event '{}' multiplexed, counts are scaled.",
+                      perfEventName(static_cast<PerfEvent>(i)));
+      }
+    }
+    totals[i].fetch_add(count, std::memory_order_relaxed);
+  }
+}
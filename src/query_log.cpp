@@ -0,0 +1,169 @@
+#include "query_log.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+
+constexpr char kMagic[4] = {'H', 'Q', 'L', '1'};
+// longer lengths only come from a corrupt log; refused before allocating
+constexpr uint64_t kMaxStringLength = 16u << 20;
+
+void writeVarint(std::ostream& out, uint64_t v) {
+  while (v >= 0x80) {
+    out.put(static_cast<char>((v & 0x7f) | 0x80));
+    v >>= 7;
+  }
+  out.put(static_cast<char>(v));
+}
+
+void writeString(std::ostream& out, const std::string& s) {
+  writeVarint(out, s.size());
+  out.write(s.data(), static_cast<std::streamsize>(s.size()));
+}
+
+bool readVarint(std::istream& in, uint64_t& v) {
+  v = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    int c = in.get();
+    if (c == EOF) return false;
+    v |= static_cast<uint64_t>(c & 0x7f) << shift;
+    if ((c & 0x80) == 0) return true;
+  }
+  return false;
+}
+
+bool readString(std::istream& in, std::string& s) {
+  uint64_t len = 0;
+  if (!readVarint(in, len) || len > kMaxStringLength) return false;
+  s.resize(len);
+  return static_cast<bool>(in.read(s.data(), static_cast<std::streamsize>(len)));
+}
+
+struct Capture {
+  std::mutex mtx;
+  std::ofstream out;
+  bool active = false;
+  std::chrono::steady_clock::time_point begin;
+  uint64_t lastArrival = 0;
+  size_t records = 0;
+  std::unordered_map<std::string, uint64_t> columnIds;
+};
+
+Capture& capture() {
+  static Capture instance;
+  return instance;
+}
+
+}  // namespace
+
+void startQueryCapture(const std::string& path) {
+  Capture& c = capture();
+  std::lock_guard<std::mutex> lock(c.mtx);
+  if (c.active) c.out.close();
+  c.out.open(path, std::ios::binary | std::ios::trunc);
+  if (!c.out) {
+    c.active = false;
+    throw std::runtime_error("Cannot open query log for writing: " + path);
+  }
+  c.out.write(kMagic, sizeof(kMagic));
+  c.begin = std::chrono::steady_clock::now();
+  c.lastArrival = 0;
+  c.records = 0;
+  c.columnIds.clear();
+  c.active = true;
+  spdlog::info("Capturing queries to '{}'.", path);
+}
+
+void stopQueryCapture() {
+  Capture& c = capture();
+  std::lock_guard<std::mutex> lock(c.mtx);
+  if (!c.active) return;
+  c.out.close();
+  c.active = false;
+  spdlog::info("Query capture stopped after {} queries.", c.records);
+}
+
+bool queryCaptureActive() {
+  Capture& c = capture();
+  std::lock_guard<std::mutex> lock(c.mtx);
+  return c.active;
+}
+
+void captureQuery(const std::vector<std::string>& columns,
+                  const std::vector<std::string>& values,
+                  const std::string& startKey, const std::string& endKey) {
+  Capture& c = capture();
+  std::lock_guard<std::mutex> lock(c.mtx);
+  if (!c.active) return;
+
+  uint64_t arrival = std::chrono::duration_cast<std::chrono::microseconds>(
+                         std::chrono::steady_clock::now() - c.begin)
+                         .count();
+  writeVarint(c.out, arrival - c.lastArrival);
+  c.lastArrival = arrival;
+
+  size_t n = std::min(columns.size(), values.size());
+  writeVarint(c.out, n);
+  for (size_t i = 0; i < n; ++i) {
+    auto [it, added] = c.columnIds.try_emplace(columns[i], c.columnIds.size());
+    writeVarint(c.out, it->second);
+    if (added) writeString(c.out, columns[i]);
+    writeString(c.out, values[i]);
+  }
+  writeString(c.out, startKey);
+  writeString(c.out, endKey);
+  ++c.records;
+}
+
+std::vector<QueryLogRecord> readQueryLog(const std::string& path) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) throw std::runtime_error("Cannot open query log: " + path);
+  char magic[sizeof(kMagic)];
+  if (!in.read(magic, sizeof(magic)) ||
+      !std::equal(magic, magic + sizeof(magic), kMagic)) {
+    throw std::runtime_error("Not a query log: " + path);
+  }
+
+  std::vector<QueryLogRecord> records;
+  std::vector<std::string> columnNames;
+  uint64_t arrival = 0;
+  uint64_t delta = 0;
+  while (readVarint(in, delta)) {
+    QueryLogRecord record;
+    arrival += delta;
+    record.arrivalMicros = arrival;
+    uint64_t n = 0;
+    bool ok = readVarint(in, n);
+    for (uint64_t i = 0; ok && i < n; ++i) {
+      uint64_t id = 0;
+      ok = readVarint(in, id);
+      if (ok && id == columnNames.size()) {
+        columnNames.emplace_back();
+        ok = readString(in, columnNames.back());
+      }
+      ok = ok && id < columnNames.size();
+      std::string value;
+      ok = ok && readString(in, value);
+      if (ok) {
+        record.columns.push_back(columnNames[id]);
+        record.values.push_back(std::move(value));
+      }
+    }
+    ok = ok && readString(in, record.startKey) && readString(in, record.endKey);
+    if (!ok) {
+      spdlog::warn("Query log '{}' truncated or corrupt after {} records.",
+                   path, records.size());
+      break;
+    }
+    records.push_back(std::move(record));
+  }
+  spdlog::info("Read {} queries from '{}'.", records.size(), path);
+  return records;
+}
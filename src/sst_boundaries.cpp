@@ -0,0 +1,96 @@
+#include "sst_boundaries.hpp"
+
+#include <numeric>
+
+namespace {
+
+const char* const kSamplesProperty = "hdb.boundary.samples";
+const char* const kStrideProperty = "hdb.boundary.stride";
+
+void appendSample(std::string& out, const rocksdb::Slice& key) {
+  uint32_t size = static_cast<uint32_t>(key.size());
+  for (int shift = 24; shift >= 0; shift -= 8) {
+    out.push_back(static_cast<char>((size >> shift) & 0xffu));
+  }
+  out.append(key.data(), key.size());
+}
+
+}  // namespace
+
+rocksdb::Status BoundarySampleCollector::AddUserKey(
+    const rocksdb::Slice& key, const rocksdb::Slice& /*value*/,
+    rocksdb::EntryType type, rocksdb::SequenceNumber /*seq*/,
+    uint64_t /*fileSize*/) {
+  // SstFileReader iterators only show puts, so only puts are counted
+  if (type != rocksdb::kEntryPut) return rocksdb::Status::OK();
+  if (puts > 0 && puts % kBoundarySampleStride == 0) {
+    appendSample(samples, key);
+  }
+  ++puts;
+  return rocksdb::Status::OK();
+}
+
+rocksdb::Status BoundarySampleCollector::Finish(
+    rocksdb::UserCollectedProperties* properties) {
+  properties->emplace(kStrideProperty, std::to_string(kBoundarySampleStride));
+  properties->emplace(kSamplesProperty, samples);
+  return rocksdb::Status::OK();
+}
+
+rocksdb::UserCollectedProperties BoundarySampleCollector::GetReadableProperties()
+    const {
+  return {{kStrideProperty, std::to_string(kBoundarySampleStride)},
+          {"hdb.boundary.count",
+           std::to_string(puts / kBoundarySampleStride)}};
+}
+
+rocksdb::TablePropertiesCollector*
+BoundarySampleCollectorFactory::CreateTablePropertiesCollector(
+    rocksdb::TablePropertiesCollectorFactory::Context /*context*/) {
+  return new BoundarySampleCollector();
+}
+
+std::vector<std::string> readBoundarySamples(
+    const rocksdb::TableProperties& properties, size_t* stride) {
+  std::vector<std::string> samples;
+  const auto& user = properties.user_collected_properties;
+  auto strideIt = user.find(kStrideProperty);
+  auto samplesIt = user.find(kSamplesProperty);
+  if (strideIt == user.end() || samplesIt == user.end()) return samples;
+  if (stride) *stride = std::stoull(strideIt->second);
+
+  const std::string& data = samplesIt->second;
+  size_t pos = 0;
+  while (pos + 4 <= data.size()) {
+    uint32_t size = 0;
+    for (int i = 0; i < 4; ++i) {
+      size = (size << 8) | static_cast<unsigned char>(data[pos + i]);
+    }
+    pos += 4;
+    if (pos + size > data.size()) break;  // truncated, keep what parsed
+    samples.emplace_back(data, pos, size);
+    pos += size;
+  }
+  return samples;
+}
+
+std::vector<std::string> splitKeysForPartitions(
+    const std::vector<std::string>& samples, size_t stride,
+    uint64_t numEntries, size_t partitionSize, size_t maxRanges) {
+  std::vector<std::string> starts = {""};
+  if (samples.empty() || stride == 0 || partitionSize == 0 || maxRanges < 2) {
+    return starts;
+  }
+  // a range start must be a sampled key and a partition start
+  const uint64_t unit = std::lcm<uint64_t>(stride, partitionSize);
+  const uint64_t units = numEntries / unit;
+  if (units == 0) return starts;
+  const uint64_t unitsPerRange = (units + maxRanges - 1) / maxRanges;
+  const uint64_t step = unitsPerRange * unit;
+  for (uint64_t offset = step; offset < numEntries; offset += step) {
+    size_t sample = offset / stride - 1;
+    if (sample >= samples.size()) break;
+    starts.push_back(samples[sample]);
+  }
+  return starts;
+}